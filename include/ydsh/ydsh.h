@@ -115,6 +115,7 @@ typedef enum {
     DS_DUMP_KIND_UAST,  /* dump untyped abstract syntax tree */
     DS_DUMP_KIND_AST,   /* dump typed abstract syntax tree */
     DS_DUMP_KIND_CODE,  /* dump byte code */
+    DS_DUMP_KIND_OPT_STATS, /* dump statistics of byte code optimization */
 } DSDumpKind;
 
 /**
@@ -131,11 +132,50 @@ typedef enum {
 int DSState_setDumpTarget(DSState *st, DSDumpKind kind, const char *target);
 
 
+/* for profiling */
+typedef enum {
+    DS_PROFILE_SAMPLE,  /* periodically sample call stack by SIGPROF (low overhead) */
+    DS_PROFILE_EXACT,   /* count all of executed instructions and function calls (with cycle timing) */
+} DSProfileMode;
+
+/**
+ * start profiling of VM.
+ * @param st
+ * not null.
+ * @param mode
+ * @param interval
+ * sampling interval (micro seconds). if 0, use default interval (1000).
+ * only affect DS_PROFILE_SAMPLE.
+ * @return
+ * if success, return 0.
+ * if already started or cannot start interval timer, do nothing and return -1.
+ */
+int DSState_startProfile(DSState *st, DSProfileMode mode, unsigned int interval);
+
+/**
+ * stop profiling and write result.
+ * if DS_PROFILE_SAMPLE, write folded stacks (for flamegraph).
+ * if DS_PROFILE_EXACT, write per-opcode and per-function counters.
+ * @param st
+ * not null.
+ * @param target
+ * if null, discard result.
+ * if empty string, treat as stdout.
+ * @return
+ * if success, return 0.
+ * if not started, return -1.
+ * if cannot open target, stop profiling and return -1.
+ */
+int DSState_stopProfile(DSState *st, const char *target);
+
 /* for option */
 #define DS_OPTION_ASSERT       ((unsigned short) (1u << 0u))
 #define DS_OPTION_INTERACTIVE  ((unsigned short) (1u << 1u))
 #define DS_OPTION_TRACE_EXIT   ((unsigned short) (1u << 2u))
 #define DS_OPTION_JOB_CONTROL  ((unsigned short) (1u << 3u))
+#define DS_OPTION_MODULE_CACHE ((unsigned short) (1u << 4u))
+#define DS_OPTION_PEEPHOLE     ((unsigned short) (1u << 5u))
+#define DS_OPTION_PARALLEL_LOAD ((unsigned short) (1u << 6u))
 
 unsigned short DSState_option(const DSState *st);
 
@@ -309,6 +349,8 @@ const char *DSState_configDir();
 /* for feature detection */
 #define DS_FEATURE_LOGGING    ((unsigned int) (1u << 0u))
 #define DS_FEATURE_SAFE_CAST  ((unsigned int) (1u << 1u))
+#define DS_FEATURE_THREADED_CODE ((unsigned int) (1u << 2u))
+#define DS_FEATURE_OBJECT_POOL ((unsigned int) (1u << 3u))
 
 unsigned int DSState_featureBit();
 
@@ -320,6 +362,8 @@ typedef enum {
     DS_COMP_GET,    // get completion result at index
     DS_COMP_SIZE,   // get size of completion result
     DS_COMP_CLEAR,  // clear completion result
+    DS_COMP_TIME,   // get elapsed time of last completion (micro seconds)
+    DS_COMP_BUDGET, // set time budget of directory scan (milli seconds, 0 means unlimited)
 } DSCompletionOp;
 
 /**
@@ -328,10 +372,11 @@ typedef enum {
  * not null.
  * @param op
  * @param index
- * indicates index of completion result or cursor of completing line
+ * indicates index of completion result, cursor of completing line or time budget
  * @param value
  * @return
  * if op is 'DS_COMP_SIZE', return size of completion result.
+ * if op is 'DS_COMP_TIME', return elapsed time.
  * otherwise, return always 0.
  */
 unsigned int DSState_completionOp(DSState *st, DSCompletionOp op, unsigned int index, const char **value);
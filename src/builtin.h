@@ -602,8 +602,19 @@ static auto sliceImpl(const ArrayObject &obj, size_t begin, size_t end) {
     return DSValue::create<ArrayObject>(obj.getTypeID(), std::vector<DSValue>(b, e));
 }
 
-static auto sliceImpl(const StringRef &ref, size_t begin, size_t end) {
-    return DSValue::createStr(ref.slice(begin, end));
+/**
+ * for String slice
+ */
+struct StrSliceTarget {
+    const DSValue &value;
+
+    size_t size() const {
+        return this->value.asStrRef().size();
+    }
+};
+
+static auto sliceImpl(const StrSliceTarget &target, size_t begin, size_t end) {
+    return DSValue::createStrSlice(target.value, begin, end);
 }
 
 /**
@@ -644,21 +655,20 @@ static auto slice(RuntimeContext &ctx, const T &obj, long startIndex, long stopI
 //!bind: function slice($this : String, $start : Int, $stop : Int) : String
 YDSH_METHOD string_slice(RuntimeContext &ctx) {
     SUPPRESS_WARNING(string_slice);
-    RET(slice(ctx, LOCAL(0).asStrRef(), LOCAL(1).asInt(), LOCAL(2).asInt()));
+    RET(slice(ctx, StrSliceTarget{LOCAL(0)}, LOCAL(1).asInt(), LOCAL(2).asInt()));
 }
 
 //!bind: function from($this : String, $start : Int) : String
 YDSH_METHOD string_sliceFrom(RuntimeContext &ctx) {
     SUPPRESS_WARNING(string_sliceFrom);
-    auto strObj = LOCAL(0).asStrRef();
-    RET(slice(ctx, strObj, LOCAL(1).asInt(), strObj.size()));
+    StrSliceTarget target{LOCAL(0)};
+    RET(slice(ctx, target, LOCAL(1).asInt(), target.size()));
 }
 
 //!bind: function to($this : String, $stop : Int) : String
 YDSH_METHOD string_sliceTo(RuntimeContext &ctx) {
     SUPPRESS_WARNING(string_sliceTo);
-    auto strObj = LOCAL(0).asStrRef();
-    RET(slice(ctx, strObj, 0, LOCAL(1).asInt()));
+    RET(slice(ctx, StrSliceTarget{LOCAL(0)}, 0, LOCAL(1).asInt()));
 }
 
 //!bind: function startsWith($this : String, $target : String) : Boolean
@@ -711,7 +721,7 @@ YDSH_METHOD string_split(RuntimeContext &ctx) {
     } else {
         for(StringRef::size_type pos = 0; pos != StringRef::npos; ) {
             auto ret = thisStr.find(delimStr, pos);
-            ptr.append(DSValue::createStr(thisStr.slice(pos, ret)));
+            ptr.append(DSValue::createStrSlice(LOCAL(0), pos, ret != StringRef::npos ? ret : thisStr.size()));
             pos = ret != StringRef::npos ? ret + delimStr.size() : ret;
         }
     }
@@ -770,9 +780,9 @@ YDSH_METHOD string_toInt(RuntimeContext &ctx) {
 //!bind: function toFloat($this : String) : Option<Float>
 YDSH_METHOD string_toFloat(RuntimeContext &ctx) {
     SUPPRESS_WARNING(string_toFloat);
-    auto ref = LOCAL(0).asStrRef();
     int status = 0;
-    double value = convertToDouble(ref.data(), status, false);
+    auto strObj = LOCAL(0).materialize();
+    double value = convertToDouble(strObj.asCStr(), status, false);
 
     RET(status == 0 ? DSValue::createFloat(value) : DSValue::createInvalid());
 }
@@ -887,14 +897,15 @@ YDSH_METHOD stringIter_hasNext(RuntimeContext &ctx) {
 //!bind: function $OP_INIT($this : Regex, $str : String) : Regex
 YDSH_METHOD regex_init(RuntimeContext &ctx) {
     SUPPRESS_WARNING(regex_init);
-    auto ref = LOCAL(1).asStrRef();
+    auto strObj = LOCAL(1).materialize();
+    const char *str = strObj.asCStr();
     const char *errorStr;
-    auto re = compileRegex(ref.data(), errorStr, 0);
+    auto re = compileRegex(str, errorStr, 0);
     if(!re) {
         raiseError(ctx, TYPE::RegexSyntaxError, std::string(errorStr));
         RET_ERROR;
     }
-    RET(DSValue::create<RegexObject>(ref.data(), std::move(re)));
+    RET(DSValue::create<RegexObject>(str, std::move(re)));
 }
 
 //!bind: function $OP_MATCH($this : Regex, $target : String) : Boolean
@@ -937,7 +948,7 @@ YDSH_METHOD regex_match(RuntimeContext &ctx) {
         int begin = ovec[i * 2];
         int end = ovec[i * 2 + 1];
         bool hasGroup = begin > -1 && end > -1;
-        auto v = hasGroup ? DSValue::createStr(ref.slice(begin, end)) : DSValue::createInvalid();
+        auto v = hasGroup ? DSValue::createStrSlice(LOCAL(1), begin, end) : DSValue::createInvalid();
         array.refValues().push_back(std::move(v));
     }
 
@@ -1025,7 +1036,8 @@ YDSH_METHOD signals_set(RuntimeContext &ctx) {
 //!bind: function signal($this : Signals, $key : String) : Option<Signal>
 YDSH_METHOD signals_signal(RuntimeContext &ctx) {
     SUPPRESS_WARNING(signals_signal);
-    const char *key = LOCAL(1).asStrRef().data();
+    auto keyObj = LOCAL(1).materialize();
+    const char *key = keyObj.asCStr();
     int sigNum = getSignalNum(key);
     if(sigNum < 0) {
         RET(DSValue::createInvalid());
@@ -1616,7 +1628,8 @@ YDSH_METHOD error_name(RuntimeContext &ctx) {
 //!bind: function $OP_INIT($this : UnixFD, $path : String) : UnixFD
 YDSH_METHOD fd_init(RuntimeContext &ctx) {
     SUPPRESS_WARNING(fd_init);
-    const char *path = LOCAL(1).asStrRef().data();
+    auto pathObj = LOCAL(1).materialize();
+    const char *path = pathObj.asCStr();
     int fd = open(path, O_CREAT | O_RDWR | O_CLOEXEC, 0666);
     if(fd != -1) {
         RET(DSValue::create<UnixFdObject>(fd));
@@ -1633,6 +1646,7 @@ YDSH_METHOD fd_close(RuntimeContext &ctx) {
     SUPPRESS_WARNING(fd_close);
     auto &fdObj = typeAs<UnixFdObject>(LOCAL(0));
     int fd = fdObj.getValue();
+    ctx.readBuffers.discard(fd);
     if(fdObj.tryToClose(true) < 0) {
         int e = errno;
         raiseSystemError(ctx, e, std::to_string(fd));
@@ -24,6 +24,7 @@
 #include <ydsh/ydsh.h>
 
 #include "vm.h"
+#include "redir.h"
 #include "misc/num_util.hpp"
 #include "misc/files.h"
 
@@ -44,8 +45,10 @@ static int builtin_fg_bg(DSState &state, ArrayObject &argvObj);
 static int builtin_hash(DSState &state, ArrayObject &argvObj);
 static int builtin_help(DSState &state, ArrayObject &argvObj);
 static int builtin_kill(DSState &state, ArrayObject &argvObj);
+static int builtin_pexec(DSState &state, ArrayObject &argvObj);
 static int builtin_pwd(DSState &state, ArrayObject &argvObj);
 static int builtin_read(DSState &state, ArrayObject &argvObj);
+static int builtin_readarray(DSState &state, ArrayObject &argvObj);
 static int builtin_setenv(DSState &state, ArrayObject &argvObj);
 static int builtin_shctl(DSState &state, ArrayObject &argvObj);
 static int builtin_test(DSState &state, ArrayObject &argvObj);
@@ -53,6 +56,7 @@ static int builtin_true(DSState &state, ArrayObject &argvObj);
 static int builtin_ulimit(DSState &state, ArrayObject &argvObj);
 static int builtin_umask(DSState &state, ArrayObject &argvObj);
 static int builtin_unsetenv(DSState &state, ArrayObject &argvObj);
+static int builtin_wait(DSState &state, ArrayObject &argvObj);
 
 static constexpr struct {
     const char *commandName;
@@ -124,9 +128,11 @@ static constexpr struct {
         {"fg", builtin_fg_bg, "[job_spec]",
                 "    Move job to the foreground.\n"
                 "    If JOB_SPEC is not present, latest job is used."},
-        {"hash", builtin_hash, "[-r] [command ...]",
+        {"hash", builtin_hash, "[-r] [-s] [command ...]",
                 "    Cache file path of specified commands.  If -r option is supplied,\n"
                 "    removes specified command path (if not specified, remove all cache).\n"
+                "    If -s option is supplied, display number of cache hits, misses and\n"
+                "    PATH directory rescans.\n"
                 "    If option is not supplied, display all cached path."},
         {"help", builtin_help, "[-s] [pattern ...]",
                 "    Display helpful information about builtin commands."},
@@ -136,6 +142,15 @@ static constexpr struct {
                 "    Options:\n"
                 "        -s sig    send a signal.  SIG is a signal name or signal number\n"
                 "        -l        list the signal names"},
+        {"pexec", builtin_pexec, "[-P max-procs] command [arg ...] [::: input ...]",
+                "    Run COMMAND for each INPUT in parallel.  INPUT is passed to COMMAND\n"
+                "    as last argument.  COMMAND may be builtin, user-defined or external\n"
+                "    command.  Each COMMAND is evaluated in child process.\n"
+                "    If `:::' is not present, read INPUT from standard input (one per line).\n"
+                "    Exit status is the last non-zero exit status of COMMAND (0 if all succeed).\n"
+                "    Options:\n"
+                "        -P max-procs    run at most MAX-PROCS processes at a time\n"
+                "                        (default is number of online processors)"},
         {"pwd", builtin_pwd, "[-LP]",
                 "    Print the current working directory(absolute path).\n"
                 "    If -L specified, print logical working directory.\n"
@@ -150,6 +165,12 @@ static constexpr struct {
                 "        -s         disable echo back\n"
                 "        -u         specify file descriptor\n"
                 "        -t timeout set timeout second (only available if input fd is a tty)"},
+        {"readarray", builtin_readarray, "[-n count] [-u fd]",
+                "    Read lines from standard input and store them to MAPFILE (Array<String>).\n"
+                "    Trailing newline of each line is removed.\n"
+                "    Options:\n"
+                "        -n count   read at most COUNT lines (if not, read until end of file)\n"
+                "        -u fd      specify file descriptor"},
         {"setenv", builtin_setenv, "[name=env ...]",
                 "    Set environmental variables."},
         {"shctl", builtin_shctl, "[subcommand]",
@@ -159,6 +180,7 @@ static constexpr struct {
                 "        is-sourced          return 0 if current script is sourced.\n"
                 "        backtrace           print stack trace.\n"
                 "        function            print current function/command name.\n"
+                "        alloc-stat          print object allocator statistics.\n"
                 "        show  [OPTION ...]  print runtime option setting.\n"
                 "        set   OPTION ...    set/enable/on runtime option.\n"
                 "        unset OPTION ...    unset/disable/off runtime option"},
@@ -243,6 +265,11 @@ static constexpr struct {
                 "        -S    print current mask in a symbolic form"},
         {"unsetenv", builtin_unsetenv, "[name ...]",
                 "    Unset environmental variables."},
+        {"wait", builtin_wait, "[-n] [job_spec ...]",
+                "    Wait for termination of specified jobs and return exit status of\n"
+                "    last job.  If JOB_SPEC is not present, wait for all jobs.\n"
+                "    Options:\n"
+                "        -n    wait for termination of any single job and return its exit status"},
 };
 
 unsigned int getBuiltinCommandSize() {
@@ -278,6 +305,10 @@ builtin_command_t lookupBuiltinCommand(const char *commandName) {
     return builtinCommands[iter->second].cmd_ptr;
 }
 
+bool isBufferedBuiltin(builtin_command_t cmd) {
+    return cmd == builtin_echo;
+}
+
 static void printAllUsage(FILE *fp) {
     for(const auto &e : builtinCommands) {
         fprintf(fp, "%s %s\n", e.commandName, e.usage);
@@ -414,7 +445,8 @@ static int builtin_check_env(DSState &, ArrayObject &argvObj) {
     return 0;
 }
 
-static int builtin_echo(DSState &, ArrayObject &argvObj) {
+static int builtin_echo(DSState &state, ArrayObject &argvObj) {
+    auto &out = state.outBuffer;
     bool newline = true;
     bool interpEscape = false;
 
@@ -448,10 +480,11 @@ static int builtin_echo(DSState &, ArrayObject &argvObj) {
         if(firstArg) {
             firstArg = false;
         } else {
-            fputc(' ', stdout);
+            out.append(' ');
         }
         if(!interpEscape) {
-            fputs(str(argvObj.getValues()[index]), stdout);
+            const char *arg = str(argvObj.getValues()[index]);
+            out.append(arg, strlen(arg));
             continue;
         }
         const char *arg = str(argvObj.getValues()[index]);
@@ -520,12 +553,12 @@ static int builtin_echo(DSState &, ArrayObject &argvObj) {
                     break;
                 }
             }
-            fputc(ch, stdout);
+            out.append(static_cast<char>(ch));
         }
     }
 
     if(newline) {
-        fputc('\n', stdout);
+        out.append('\n');
     }
     return 0;
 }
@@ -709,16 +742,16 @@ static bool operator<(const timespec &left, const timespec &right) {
 }
 
 static bool compareFile(const DSValue &left, BinaryOp op, const DSValue &right) {
-    auto x = left.asStrRef();
-    auto y = right.asStrRef();
+    const char *x = left.asCStr();
+    const char *y = right.asCStr();
 
     struct stat st1;
     struct stat st2;
 
-    if(stat(x.data(), &st1) != 0) {
+    if(stat(x, &st1) != 0) {
         return false;
     }
-    if(stat(y.data(), &st2) != 0) {
+    if(stat(y, &st2) != 0) {
         return false;
     }
 
@@ -912,7 +945,7 @@ static int builtin_test(DSState &, ArrayObject &argvObj) {
         }
 #undef GEN_CASE
         case BinaryOp::INVALID:
-            ERROR(argvObj, "%s: invalid binary operator", op.data());   //FIXME:
+            ERROR(argvObj, "%s: invalid binary operator", str(argvObj.getValues()[2]));   //FIXME:
             return 2;
         }
         break;
@@ -925,27 +958,6 @@ static int builtin_test(DSState &, ArrayObject &argvObj) {
     return result ? 0 : 1;
 }
 
-static int xfgetc(int fd, int timeout) {
-    signed char ch;
-    do {
-        errno = 0;
-
-        if(timeout > -2) {
-            struct pollfd pollfd[1];
-            pollfd[0].fd = fd;
-            pollfd[0].events = POLLIN;
-            if(poll(pollfd, 1, timeout) != 1) {
-                return EOF;
-            }
-        }
-
-        if(read(fd, &ch, 1) <= 0) {
-            ch = EOF;
-        }
-    } while(static_cast<int>(ch) == EOF && (errno == EAGAIN || errno == EINTR));
-    return ch;
-}
-
 static int builtin_read(DSState &state, ArrayObject &argvObj) {  //FIXME: timeout, UTF-8
     const char *prompt = "";
     const char *ifs = nullptr;
@@ -1040,12 +1052,10 @@ static int builtin_read(DSState &state, ArrayObject &argvObj) {  //FIXME: timeou
     }
 
     // read line
-    if(!isTTY) {
-        timeout = -2;
-    }
+    FDReader reader(state.readBuffers, fd, timeout);
     unsigned int skipCount = 1;
     int ch;
-    for(bool prevIsBackslash = false; (ch = xfgetc(fd, timeout)) != EOF;
+    for(bool prevIsBackslash = false; (ch = reader.nextChar()) != EOF;
             prevIsBackslash = backslash && ch == '\\' && !prevIsBackslash) {
         if(ch == '\n') {
             if(prevIsBackslash) {
@@ -1057,7 +1067,7 @@ static int builtin_read(DSState &state, ArrayObject &argvObj) {  //FIXME: timeou
             continue;
         }
 
-        bool fieldSep = isFieldSep(ifsSize, ifs, ch) && !prevIsBackslash;
+        bool fieldSep = isFieldSep(ifsSize, ifs, static_cast<char>(ch)) && !prevIsBackslash;
         if(fieldSep && skipCount > 0) {
             if(isSpace(ch)) {
                 continue;
@@ -1124,8 +1134,58 @@ static int builtin_read(DSState &state, ArrayObject &argvObj) {  //FIXME: timeou
     return ret;
 }
 
+static int builtin_readarray(DSState &state, ArrayObject &argvObj) {
+    int fd = STDIN_FILENO;
+    int64_t count = -1;
+    GetOptState optState;
+    for(int opt; (opt = optState(argvObj, ":n:u:")) != -1;) {
+        switch(opt) {
+        case 'n': {
+            auto ret = convertToNum<int64_t>(optState.optArg);
+            if(!ret.second || ret.first < 0) {
+                ERROR(argvObj, "%s: invalid line count", optState.optArg);
+                return 1;
+            }
+            count = ret.first;
+            break;
+        }
+        case 'u': {
+            const char *value = optState.optArg;
+            fd = parseFD(value);
+            if(fd < 0) {
+                ERROR(argvObj, "%s: invalid file descriptor", value);
+                return 1;
+            }
+            break;
+        }
+        case ':':
+            ERROR(argvObj, "-%c: option require argument", optState.optOpt);
+            return 2;
+        default:
+            return invalidOptionError(argvObj, optState);
+        }
+    }
+
+    auto value = DSValue::create<ArrayObject>(state.symbolTable.get(TYPE::StringArray));
+    auto &values = typeAs<ArrayObject>(value).refValues();
+    FDReader reader(state.readBuffers, fd, -1, count < 0);
+    std::string line;
+    for(; count != 0 && reader.readLine(line); count--) {
+        values.push_back(DSValue::createStr(std::move(line)));
+        line = "";
+    }
+    state.setGlobal(toIndex(BuiltinVarOffset::MAPFILE), std::move(value));
+
+    if(reader.hasError()) {
+        PERROR(argvObj, "%d", fd);
+        return 1;
+    }
+    return 0;
+}
+
 static int builtin_hash(DSState &state, ArrayObject &argvObj) {
     bool remove = false;
+    bool showStats = false;
 
     // check option
     const unsigned int argc = argvObj.getValues().size();
@@ -1137,11 +1197,21 @@ static int builtin_hash(DSState &state, ArrayObject &argvObj) {
         }
         if(strcmp(arg, "-r") == 0) {
             remove = true;
+        } else if(strcmp(arg, "-s") == 0) {
+            showStats = true;
         } else {
             return invalidOptionError(argvObj, arg);
         }
     }
 
+    if(showStats) {
+        auto &stats = state.pathCache.getStats();
+        printf("hit: %u\n", stats.hit);
+        printf("miss: %u\n", stats.miss);
+        printf("rescan: %u\n", stats.rescan);
+        return 0;
+    }
+
     const bool hasNames = index < argc;
     if(hasNames) {
         for(; index < argc; index++) {
@@ -1437,6 +1507,170 @@ static int builtin_fg_bg(DSState &state, ArrayObject &argvObj) {
     return ret;
 }
 
+static int builtin_wait(DSState &state, ArrayObject &argvObj) {
+    bool anyJob = false;
+    GetOptState optState;
+    for(int opt; (opt = optState(argvObj, "n")) != -1;) {
+        if(opt == 'n') {
+            anyJob = true;
+        } else {
+            return invalidOptionError(argvObj, optState);
+        }
+    }
+
+    std::vector<Job> jobs;
+    const unsigned int argc = argvObj.getValues().size();
+    if(optState.index == argc) {
+        const auto &table = state.jobTable;
+        for(auto begin = table.beginJob(); begin != table.endJob(); ++begin) {
+            if((*begin)->hasOwnership()) {
+                jobs.push_back(*begin);
+            }
+        }
+    }
+    for(unsigned int i = optState.index; i < argc; i++) {
+        const char *arg = str(argvObj.getValues()[i]);
+        auto job = tryToGetJob(state.jobTable, arg);
+        if(!job || !job->hasOwnership()) {
+            ERROR(argvObj, "%s: no such job", arg);
+            return 127;
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    int ret = 0;
+    if(anyJob) {
+        JobReaper reaper;
+        for(auto &job : jobs) {
+            reaper.add(job);
+        }
+        auto job = reaper.waitAny();
+        if(job) {
+            ret = state.jobTable.waitAndDetach(job, state.isJobControl());
+        } else if(!reaper.empty()) {
+            int e = errno;
+            ERROR(argvObj, "wait failed: %s", strerror(e));
+            ret = 1;
+        } else {
+            ret = 127;
+        }
+    } else {
+        for(auto &job : jobs) {
+            ret = state.jobTable.waitAndDetach(job, state.isJobControl());
+        }
+    }
+    state.jobTable.updateStatus();
+    return ret;
+}
+
+static int builtin_pexec(DSState &state, ArrayObject &argvObj) {
+    long maxProcs = sysconf(_SC_NPROCESSORS_ONLN);
+    GetOptState optState;
+    for(int opt; (opt = optState(argvObj, ":P:")) != -1;) {
+        switch(opt) {
+        case 'P': {
+            auto ret = convertToNum<int32_t>(optState.optArg);
+            if(!ret.second || ret.first < 1) {
+                ERROR(argvObj, "%s: invalid number of processes", optState.optArg);
+                return 1;
+            }
+            maxProcs = ret.first;
+            break;
+        }
+        case ':':
+            ERROR(argvObj, "-%c: option require argument", optState.optOpt);
+            return 2;
+        default:
+            return invalidOptionError(argvObj, optState);
+        }
+    }
+    if(maxProcs < 1) {
+        maxProcs = 1;
+    }
+
+    // split command and inputs
+    auto &values = argvObj.getValues();
+    std::vector<DSValue> cmd;
+    unsigned int index = optState.index;
+    for(; index < values.size() && strcmp(str(values[index]), ":::") != 0; index++) {
+        cmd.push_back(values[index]);
+    }
+    if(cmd.empty()) {
+        return showUsage(argvObj);
+    }
+
+    std::vector<DSValue> inputs;
+    const bool readStdin = index == values.size();
+    if(readStdin) {
+        FDReader reader(state.readBuffers, STDIN_FILENO, -1, true);
+        std::string line;
+        while(reader.readLine(line)) {
+            inputs.push_back(DSValue::createStr(std::move(line)));
+            line = "";
+        }
+        if(reader.hasError()) {
+            PERROR(argvObj, "%d", STDIN_FILENO);
+            return 1;
+        }
+    } else {
+        inputs.insert(inputs.end(), values.begin() + index + 1, values.end());
+    }
+
+    int status = 0;
+    bool waitFailed = false;
+    JobReaper reaper;
+    auto reapOne = [&] {
+        auto job = reaper.waitAny();
+        if(!job) {  // fallback to blocking wait of oldest job (always reap started process)
+            int e = errno;
+            if(!waitFailed) {
+                ERROR(argvObj, "wait failed: %s", strerror(e));
+                waitFailed = true;
+            }
+            status = 1;
+            job = reaper.takeFirst();
+        }
+        int s = job->wait(Proc::BLOCKING);
+        if(s != 0) {
+            status = s;
+        }
+    };
+
+    const pid_t pgid = getpgid(0);
+    for(auto &input : inputs) {
+        while(!waitFailed && reaper.size() >= static_cast<unsigned long>(maxProcs)) {
+            reapOne();
+        }
+        if(waitFailed) {    // not start remain commands
+            break;
+        }
+
+        auto argv = cmd;
+        argv.push_back(std::move(input));
+
+        flushStdFD();
+        auto proc = Proc::fork(state, pgid, false);
+        if(proc.pid() == 0) {   // child process
+            if(readStdin) {
+                redirInToNull();
+            }
+            execCommand(state, std::move(argv), false);
+            flushStdFD();
+            _exit(state.getMaskedExitStatus());
+        }
+        if(proc.pid() < 0) {
+            PERROR(argvObj, "fork failed");
+            status = 1;
+            break;
+        }
+        reaper.add(JobTable::create(proc, DSValue(state.emptyFDObj), DSValue(state.emptyFDObj)));
+    }
+    while(!reaper.empty()) {
+        reapOne();
+    }
+    return status;
+}
+
 // for ulimit command
 
 static constexpr flag8_t RLIM_HARD = 1u << 0;
@@ -1987,6 +2221,15 @@ static int setOption(DSState &state, const ArrayObject &argvObj, const bool set)
     return 0;
 }
 
+static int printAllocStat() {
+    auto &stats = ObjectPool::getStats();
+    fprintf(stdout, "alloc: %lu\n", stats.alloc);
+    fprintf(stdout, "reuse: %lu\n", stats.reuse);
+    fprintf(stdout, "free: %lu\n", stats.free);
+    fprintf(stdout, "cached: %lu (%lu bytes)\n", stats.cached, stats.cachedBytes);
+    return 0;
+}
+
 static int builtin_shctl(DSState &state, ArrayObject &argvObj) {
     if(argvObj.size() > 1) {
         auto ref = argvObj.getValues()[1].asStrRef();
@@ -1998,6 +2241,8 @@ static int builtin_shctl(DSState &state, ArrayObject &argvObj) {
             return hasFlag(state.compileOption, CompileOption::INTERACTIVE) ? 0 : 1;
         } else if(ref == "function") {
             return printFuncName(state.getCallStack());
+        } else if(ref == "alloc-stat") {
+            return printAllocStat();
         } else if(ref == "show") {
             return showOption(state, argvObj);
         } else if(ref == "set") {
@@ -2005,7 +2250,7 @@ static int builtin_shctl(DSState &state, ArrayObject &argvObj) {
         } else if(ref == "unset") {
             return setOption(state, argvObj, false);
         } else {
-            ERROR(argvObj, "undefined subcommand: %s", ref.data());
+            ERROR(argvObj, "undefined subcommand: %s", str(argvObj.getValues()[1]));
             return 2;
         }
     }
@@ -41,6 +41,14 @@ const char *getBuiltinCommandName(unsigned int index);
 
 builtin_command_t lookupBuiltinCommand(const char *commandName);
 
+/**
+ *
+ * @param cmd
+ * @return
+ * if true, builtin command writes standard output via DSState::outBuffer (not stdio).
+ */
+bool isBufferedBuiltin(builtin_command_t cmd);
+
 // common function for field splitting
 inline bool isSpace(int ch) {
     return ch == ' ' || ch == '\t' || ch == '\n';
@@ -17,6 +17,7 @@
 #include "codegen.h"
 #include "symbol_table.h"
 #include "redir.h"
+#include "misc/num_util.hpp"
 
 namespace ydsh {
 
@@ -42,9 +43,20 @@ bool isTypeOp(OpCode code) {
     }
 }
 
-CompiledCode CodeBuilder::build(const std::string &name) {
+CompiledCode CodeBuilder::build(const std::string &name, PeepholeStats *optStats) {
     this->finalize();
 
+    // create exception entry
+    std::vector<ExceptionEntry> exceptEntries;
+    for(auto &e : this->catchBuilders) {
+        exceptEntries.push_back(e.toEntry());
+    }
+
+    if(optStats != nullptr) {
+        PeepholeOptimizer optimizer(*optStats);
+        optimizer(this->codeBuffer, this->constBuffer, this->jumpTables, this->lineNumEntries, exceptEntries);
+    }
+
     const unsigned int codeSize = this->codeBuffer.size();
     DSCode code {
         .codeKind = this->kind,
@@ -66,11 +78,10 @@ CompiledCode CodeBuilder::build(const std::string &name) {
     this->lineNumEntries.push_back({CODE_MAX_LEN, 0});
     auto *entries = this->lineNumEntries.take();
 
-    // create exception entry
-    const unsigned int exceptEntrySize = this->catchBuilders.size();
+    const unsigned int exceptEntrySize = exceptEntries.size();
     auto *except = new ExceptionEntry[exceptEntrySize + 1];
     for(unsigned int i = 0; i < exceptEntrySize; i++) {
-        except[i] = this->catchBuilders[i].toEntry();
+        except[i] = exceptEntries[i];
     }
     except[exceptEntrySize] = {
             .type = nullptr,
@@ -242,31 +253,28 @@ static bool isBinaryStrConcat(const Node &node) {
 }
 
 void ByteCodeGenerator::generateConcat(Node &node, const bool fragment) {
+    unsigned int count = fragment ? 1 : 0;
+    this->generateStrFragments(node, count);
+    this->emitConcatIns(count);
+}
+
+void ByteCodeGenerator::generateStrFragments(Node &node, unsigned int &count) {
     switch(node.getNodeKind()) {
     case NodeKind::String:
-        if(cast<StringNode>(node).getValue().empty() && fragment) {
+        if(cast<StringNode>(node).getValue().empty()) {
             return;
         }
         break;
-    case NodeKind::StringExpr: {
-        auto &strExprNode = cast<StringExprNode>(node);
-        const unsigned int size = strExprNode.getExprNodes().size();
-        if(size == 0) {
-            if(!fragment) {
-                this->emit0byteIns(OpCode::PUSH_STR0);
-            }
-            return;
-        }
-        for(unsigned int i = 0; i < size; i++) {
-            this->generateConcat(*strExprNode.getExprNodes()[i], fragment || i > 0);
+    case NodeKind::StringExpr:
+        for(auto &e : cast<StringExprNode>(node).getExprNodes()) {
+            this->generateStrFragments(*e, count);
         }
         return;
-    }
     case NodeKind::BinaryOp:
         if(isBinaryStrConcat(node)) {
             auto &binaryNode = cast<BinaryOpNode>(node);
-            this->generateConcat(*binaryNode.getLeftNode(), fragment);
-            this->generateConcat(*binaryNode.getRightNode(), true);
+            this->generateStrFragments(*binaryNode.getLeftNode(), count);
+            this->generateStrFragments(*binaryNode.getRightNode(), count);
             return;
         }
         break;
@@ -274,7 +282,7 @@ void ByteCodeGenerator::generateConcat(Node &node, const bool fragment) {
         auto &exprNode = cast<EmbedNode>(node).getExprNode();
         if(isBinaryStrConcat(exprNode) ||
                 isa<StringExprNode>(exprNode) || isa<StringNode>(exprNode)) {
-            this->generateConcat(exprNode, fragment);
+            this->generateStrFragments(exprNode, count);
             return;
         }
         break;
@@ -285,8 +293,26 @@ void ByteCodeGenerator::generateConcat(Node &node, const bool fragment) {
 
     // default
     this->visit(node);
-    if(fragment) {
+    if(++count == UINT8_MAX) {
+        this->emitConcatIns(count);
+        count = 1;
+    }
+}
+
+void ByteCodeGenerator::emitConcatIns(unsigned int count) {
+    switch(count) {
+    case 0:
+        this->emit0byteIns(OpCode::PUSH_STR0);
+        break;
+    case 1:
+        break;
+    case 2:
         this->emit0byteIns(OpCode::CONCAT);
+        break;
+    default:
+        assert(count <= UINT8_MAX);
+        this->emitValIns(OpCode::INTERP_N, count, -1);
+        break;
     }
 }
 
@@ -498,10 +524,204 @@ void ByteCodeGenerator::visitTypeOpNode(TypeOpNode &node) {
     }
 }
 
+/**
+ *
+ * @param op
+ * @param type
+ * operand type
+ * @return
+ * if not found corresponding typed instruction, return OpCode::HALT
+ */
+static OpCode resolveTypedBinaryOp(TokenKind op, const DSType &type) {
+    if(type.is(TYPE::Int)) {
+        switch(op) {
+        case ADD: return OpCode::ADD_INT;
+        case SUB: return OpCode::SUB_INT;
+        case MUL: return OpCode::MUL_INT;
+        case DIV: return OpCode::DIV_INT;
+        case MOD: return OpCode::MOD_INT;
+        case AND: return OpCode::AND_INT;
+        case OR:  return OpCode::OR_INT;
+        case XOR: return OpCode::XOR_INT;
+        case EQ:  return OpCode::EQ_INT;
+        case NE:  return OpCode::NE_INT;
+        case LT:  return OpCode::LT_INT;
+        case GT:  return OpCode::GT_INT;
+        case LE:  return OpCode::LE_INT;
+        case GE:  return OpCode::GE_INT;
+        default: break;
+        }
+    } else if(type.is(TYPE::Float)) {
+        switch(op) {
+        case ADD: return OpCode::ADD_FLOAT;
+        case SUB: return OpCode::SUB_FLOAT;
+        case MUL: return OpCode::MUL_FLOAT;
+        case DIV: return OpCode::DIV_FLOAT;
+        case EQ:  return OpCode::EQ_FLOAT;
+        case NE:  return OpCode::NE_FLOAT;
+        case LT:  return OpCode::LT_FLOAT;
+        case GT:  return OpCode::GT_FLOAT;
+        case LE:  return OpCode::LE_FLOAT;
+        case GE:  return OpCode::GE_FLOAT;
+        default: break;
+        }
+    } else if(type.is(TYPE::String)) {
+        switch(op) {
+        case EQ:  return OpCode::EQ_STR;
+        case NE:  return OpCode::NE_STR;
+        case LT:  return OpCode::LT_STR;
+        case GT:  return OpCode::GT_STR;
+        case LE:  return OpCode::LE_STR;
+        case GE:  return OpCode::GE_STR;
+        default: break;
+        }
+    }
+    return OpCode::HALT;
+}
+
+static DSValue foldIntBinaryOp(TokenKind op, int64_t left, int64_t right) {
+    int64_t ret;
+    switch(op) {
+    case ADD:
+        return sadd_overflow(left, right, ret) ? DSValue() : DSValue::createInt(ret);
+    case SUB:
+        return ssub_overflow(left, right, ret) ? DSValue() : DSValue::createInt(ret);
+    case MUL:
+        return smul_overflow(left, right, ret) ? DSValue() : DSValue::createInt(ret);
+    case DIV:
+    case MOD:
+        if(right == 0 || (left == INT64_MIN && right == -1)) {
+            return DSValue();
+        }
+        return DSValue::createInt(op == DIV ? left / right : left % right);
+    case AND:
+        return DSValue::createInt(static_cast<uint64_t>(left) & static_cast<uint64_t>(right));
+    case OR:
+        return DSValue::createInt(static_cast<uint64_t>(left) | static_cast<uint64_t>(right));
+    case XOR:
+        return DSValue::createInt(static_cast<uint64_t>(left) ^ static_cast<uint64_t>(right));
+    case EQ: return DSValue::createBool(left == right);
+    case NE: return DSValue::createBool(left != right);
+    case LT: return DSValue::createBool(left < right);
+    case GT: return DSValue::createBool(left > right);
+    case LE: return DSValue::createBool(left <= right);
+    case GE: return DSValue::createBool(left >= right);
+    default:
+        return DSValue();
+    }
+}
+
+static DSValue foldFloatBinaryOp(TokenKind op, double left, double right) {
+    switch(op) {
+    case ADD: return DSValue::createFloat(left + right);
+    case SUB: return DSValue::createFloat(left - right);
+    case MUL: return DSValue::createFloat(left * right);
+    case DIV: return DSValue::createFloat(left / right);
+    case EQ: return DSValue::createBool(left == right);
+    case NE: return DSValue::createBool(left != right);
+    case LT: return DSValue::createBool(left < right);
+    case GT: return DSValue::createBool(left > right);
+    case LE: return DSValue::createBool(left <= right);
+    case GE: return DSValue::createBool(left >= right);
+    default:
+        return DSValue();
+    }
+}
+
+/**
+ * evaluate Int/Float literal expression at compile time.
+ * @param node
+ * must be typed
+ * @return
+ * if node is not constant expression or evaluation raises error (ex. overflow, zero division),
+ * return empty value
+ */
+static DSValue foldConstant(const Node &node) {
+    if(isa<NumberNode>(node)) {
+        auto &numNode = cast<NumberNode>(node);
+        switch(numNode.kind) {
+        case NumberNode::Int:
+            return DSValue::createInt(numNode.getIntValue());
+        case NumberNode::Float:
+            return DSValue::createFloat(numNode.getFloatValue());
+        case NumberNode::Signal:
+            break;
+        }
+    } else if(isa<UnaryOpNode>(node)) {
+        auto &unaryNode = cast<UnaryOpNode>(node);
+        if(unaryNode.isUnwrapOp() || !unaryNode.getApplyNode()) {
+            return DSValue();
+        }
+        auto value = foldConstant(unaryNode.getApplyNode()->getRecvNode());
+        if(value.kind() == DSValueKind::INT) {
+            int64_t v = value.asInt();
+            switch(unaryNode.getOp()) {
+            case PLUS:
+                return value;
+            case MINUS:
+                return v == INT64_MIN ? DSValue() : DSValue::createInt(-v);
+            case NOT:
+                return DSValue::createInt(static_cast<int64_t>(~static_cast<uint64_t>(v)));
+            default:
+                break;
+            }
+        } else if(value.kind() == DSValueKind::FLOAT) {
+            switch(unaryNode.getOp()) {
+            case PLUS:
+                return value;
+            case MINUS:
+                return DSValue::createFloat(-value.asFloat());
+            default:
+                break;
+            }
+        }
+    } else if(isa<BinaryOpNode>(node)) {
+        auto &binaryNode = cast<BinaryOpNode>(node);
+        auto *optNode = binaryNode.getOptNode();
+        if(optNode == nullptr || !isa<ApplyNode>(*optNode) || !cast<ApplyNode>(*optNode).isMethodCall()
+            || cast<ApplyNode>(*optNode).getArgNodes().size() != 1) {
+            return DSValue();
+        }
+        auto &applyNode = cast<ApplyNode>(*optNode);
+        auto left = foldConstant(applyNode.getRecvNode());
+        if(!left) {
+            return DSValue();
+        }
+        auto right = foldConstant(*applyNode.getArgNodes()[0]);
+        if(left.kind() == DSValueKind::INT && right.kind() == DSValueKind::INT) {
+            return foldIntBinaryOp(binaryNode.getOp(), left.asInt(), right.asInt());
+        }
+        if(left.kind() == DSValueKind::FLOAT && right.kind() == DSValueKind::FLOAT) {
+            return foldFloatBinaryOp(binaryNode.getOp(), left.asFloat(), right.asFloat());
+        }
+    }
+    return DSValue();
+}
+
+void ByteCodeGenerator::emitFoldedValue(DSValue &&value) {
+    switch(value.kind()) {
+    case DSValueKind::BOOL:
+        this->emit0byteIns(value.asBool() ? OpCode::PUSH_TRUE : OpCode::PUSH_FALSE);
+        break;
+    case DSValueKind::INT:
+        if(value.asInt() >= 0 && value.asInt() <= UINT8_MAX) {
+            this->emit1byteIns(OpCode::PUSH_INT, static_cast<unsigned char>(value.asInt()));
+            break;
+        }
+        this->emitLdcIns(std::move(value));
+        break;
+    default:
+        this->emitLdcIns(std::move(value));
+        break;
+    }
+}
+
 void ByteCodeGenerator::visitUnaryOpNode(UnaryOpNode &node) {
     if(node.isUnwrapOp()) {
         this->visit(*node.getExprNode());
         this->emit0byteIns(OpCode::UNWRAP);
+    } else if(auto value = foldConstant(node)) {
+        this->emitFoldedValue(std::move(value));
     } else {
         this->visit(*node.getApplyNode());
     }
@@ -573,9 +793,40 @@ void ByteCodeGenerator::visitBinaryOpNode(BinaryOpNode &node) {
         } else {
             this->generateConcat(node);
         }
+    } else if(auto value = foldConstant(node)) {
+        this->emitFoldedValue(std::move(value));
     } else {
-        this->visit(*node.getOptNode());
+        this->generateBinaryOp(node);
+    }
+}
+
+void ByteCodeGenerator::generateBinaryOp(BinaryOpNode &node) {
+    auto &applyNode = cast<ApplyNode>(*node.getOptNode());
+    assert(applyNode.isMethodCall());
+    auto &recvType = applyNode.getRecvNode().getType();
+    OpCode op = OpCode::HALT;
+    if(applyNode.getArgNodes().size() == 1 && applyNode.getArgNodes()[0]->getType() == recvType) {
+        op = resolveTypedBinaryOp(node.getOp(), recvType);
+    }
+    if(op == OpCode::HALT) {
+        this->visit(applyNode);
+        return;
     }
+
+    this->visit(applyNode.getRecvNode());
+    this->visit(*applyNode.getArgNodes()[0]);
+    switch(op) {
+    case OpCode::ADD_INT:
+    case OpCode::SUB_INT:
+    case OpCode::MUL_INT:
+    case OpCode::DIV_INT:
+    case OpCode::MOD_INT:
+        this->emitSourcePos(applyNode.getPos());  // may raise ArithmeticError
+        break;
+    default:
+        break;
+    }
+    this->emit0byteIns(op);
 }
 
 void ByteCodeGenerator::visitApplyNode(ApplyNode &node) {
@@ -884,6 +1135,7 @@ void ByteCodeGenerator::generateMapCase(CaseNode &node) {
     auto &map = typeAs<MapObject>(value);
 
     this->emitLdcIns(value);
+    this->curBuilder().jumpTables.push_back(this->curBuilder().constBuffer.size() - 1);
     this->visit(node.getExprNode());
     this->emit0byteIns(OpCode::LOOKUP_HASH);
 
@@ -1262,13 +1514,18 @@ CompiledCode ByteCodeGenerator::finalize() {
     return this->finalizeCodeBuilder("");
 }
 
-void ByteCodeGenerator::exitModule(const SourceNode &node) {
+DSValue ByteCodeGenerator::exitModule(const SourceNode &node) {
     this->curBuilder().localVarNum = node.getMaxVarNum();
     this->emitIns(OpCode::RETURN);
     auto func = DSValue::create<FuncObject>(node.getModType(), this->finalizeCodeBuilder(node.getModType().toName()));
     this->commons.pop_back();
 
-    this->emitLdcIns(func);
+    this->loadModule(node, DSValue(func));
+    return func;
+}
+
+void ByteCodeGenerator::loadModule(const SourceNode &node, DSValue &&func) {
+    this->emitLdcIns(std::move(func));
     this->emitSourcePos(node.getPathToken().pos);
     this->emit0byteIns(OpCode::DUP);
     this->emit1byteIns(OpCode::CALL_FUNC, 0);
@@ -1381,7 +1638,8 @@ void ByteCodeDumper::dumpCode(const ydsh::CompiledCode &c) {
                 const int byteSize = getByteSize(code);
                 if(code == OpCode::CALL_METHOD || code == OpCode::FORK) {
                     fprintf(this->fp, "  %d  %d", read8(c.getCode(), i + 1), read16(c.getCode(), i + 2));
-                } else if(code == OpCode::RECLAIM_LOCAL || code == OpCode::ADD_GLOBBING) {
+                } else if(code == OpCode::RECLAIM_LOCAL || code == OpCode::ADD_GLOBBING ||
+                          code == OpCode::LOAD_LOCAL2 || code == OpCode::INC_LOCAL || code == OpCode::DEC_LOCAL) {
                     fprintf(this->fp, "  %d  %d", read8(c.getCode(), i + 1), read8(c.getCode(), i + 2));
                 } else if(code == OpCode::CALL_NATIVE2) {
                     unsigned int paramSize = read8(c.getCode(), i + 1);
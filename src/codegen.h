@@ -24,6 +24,7 @@
 #include "node.h"
 #include "object.h"
 #include "opcode.h"
+#include "peephole.h"
 #include "misc/resource.hpp"
 
 #define ASSERT_BYTE_SIZE(op, size) assert(getByteSize(op) == (size))
@@ -272,6 +273,11 @@ struct CodeBuilder : public CodeEmitter<true> {
     FlexBuffer<LineNumEntry> lineNumEntries;
     std::vector<CatchBuilder> catchBuilders;
 
+    /**
+     * indexes of constant pool which hold jump table of case expression
+     */
+    std::vector<unsigned int> jumpTables;
+
     /**
      * first is local offset, second is local size
      */
@@ -296,8 +302,12 @@ struct CodeBuilder : public CodeEmitter<true> {
 
     /**
      * after build, remove allocated buffer.
+     * @param name
+     * @param optStats
+     * if not null, apply peephole optimization
+     * @return
      */
-    CompiledCode build(const std::string &name);
+    CompiledCode build(const std::string &name, PeepholeStats *optStats);
 };
 
 class ModuleCommon {
@@ -332,6 +342,10 @@ private:
 
     bool assertion;
 
+    bool peephole;
+
+    PeepholeStats optStats;
+
     const MethodHandle *handle_STR{nullptr};
 
     std::vector<CodeBuilder> builders;
@@ -339,8 +353,8 @@ private:
     std::vector<ModuleCommon> commons;
 
 public:
-    ByteCodeGenerator(SymbolTable &symbolTable, bool assertion) :
-            symbolTable(symbolTable), assertion(assertion) { }
+    ByteCodeGenerator(SymbolTable &symbolTable, bool assertion, bool peephole) :
+            symbolTable(symbolTable), assertion(assertion), peephole(peephole) { }
 
     ~ByteCodeGenerator() override = default;
 
@@ -421,7 +435,7 @@ private:
      */
     void emitValIns(OpCode op, unsigned char paramSize, short restSize) {
         assert(op == OpCode::CALL_FUNC || op == OpCode::CALL_METHOD ||
-                op == OpCode::CALL_NATIVE2 || op == OpCode::ADD_GLOBBING);
+                op == OpCode::CALL_NATIVE2 || op == OpCode::ADD_GLOBBING || op == OpCode::INTERP_N);
         this->curBuilder().append8(static_cast<unsigned char>(op));
         this->curBuilder().append8(paramSize);
 
@@ -545,8 +559,44 @@ private:
     void generateCmdArg(CmdArgNode &node);
     void emitPipelineIns(const std::vector<Label> &labels, bool lastPipe);
 
+    /**
+     * concatenate string fragments of node
+     * @param node
+     * @param fragment
+     * if true, concatenate with string value at stack top
+     */
     void generateConcat(Node &node, bool fragment = false);
 
+    /**
+     * push string fragments of node (empty string literals are skipped).
+     * if number of pushed values reaches UINT8_MAX, concatenate them in place
+     * @param node
+     * @param count
+     * number of string values waiting for concatenation
+     */
+    void generateStrFragments(Node &node, unsigned int &count);
+
+    /**
+     * concatenate top count string values.
+     * if count is 0, push empty string
+     * @param count
+     */
+    void emitConcatIns(unsigned int count);
+
+    /**
+     * if operand type is Int, Float or String, emit typed instruction instead of method call
+     * @param node
+     * must be typed
+     */
+    void generateBinaryOp(BinaryOpNode &node);
+
+    /**
+     * push result of constant folding
+     * @param value
+     * Int, Float or Boolean
+     */
+    void emitFoldedValue(DSValue &&value);
+
     void generateBreakContinue(JumpNode &node);
 
     void generateMapCase(CaseNode &node);
@@ -573,7 +623,7 @@ private:
     }
 
     CompiledCode finalizeCodeBuilder(const std::string &name) {
-        auto code = this->curBuilder().build(name);
+        auto code = this->curBuilder().build(name, this->peephole ? &this->optStats : nullptr);
         this->builders.pop_back();
         return code;
     }
@@ -634,11 +684,29 @@ public:
 
     CompiledCode finalize();
 
+    const PeepholeStats &getOptStats() const {
+        return this->optStats;
+    }
+
     void enterModule(const Lexer &lexer) {
         this->initToplevelCodeBuilder(lexer, 0);
     }
 
-    void exitModule(const SourceNode &node);
+    /**
+     *
+     * @param node
+     * @return
+     * compiled module code (FuncObject)
+     */
+    DSValue exitModule(const SourceNode &node);
+
+    /**
+     * emit module loading instructions with already compiled module code.
+     * @param node
+     * @param func
+     * must be FuncObject of module
+     */
+    void loadModule(const SourceNode &node, DSValue &&func);
 };
 
 class ByteCodeDumper {
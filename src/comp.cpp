@@ -127,6 +127,15 @@ protected:
 public:
     virtual void operator()(ArrayObject &ret) = 0;
 
+    /**
+     * if true, all candidates start with current word
+     * and candidates of longer word are subset of them (see. CompletionCache)
+     * @return
+     */
+    virtual bool narrowable() const {
+        return false;
+    }
+
     /**
      * for debugging.
      * @return
@@ -207,6 +216,10 @@ public:
     KeywordCompleter(std::string &&value, bool expr) :
             Completer("Keyword"), token(std::move(value)), onlyExpr(expr) {}
 
+    bool narrowable() const override {
+        return true;
+    }
+
     void operator()(ArrayObject &results) override {
         TokenKind table[] = {
 #define GEN_ITEM(T) T,
@@ -232,6 +245,10 @@ private:
 public:
     explicit EnvNameCompleter(std::string &&name) : Completer("Env"), envName(std::move(name)) {}
 
+    bool narrowable() const override {
+        return true;
+    }
+
     void operator()(ArrayObject &results) override {
         for(unsigned int i = 0; environ[i] != nullptr; i++) {
             const char *env = environ[i];
@@ -247,49 +264,34 @@ public:
 class CmdNameCompleter : public Completer {
 private:
     const SymbolTable &symbolTable;
+    FilePathCache &pathCache;
     const std::string token;
 
 public:
     /**
      *
      * @param symbolTable
+     * @param pathCache
+     * for searching external command (use PATH index)
      * @param token
      * may be empty string
      */
-    CmdNameCompleter(const SymbolTable &symbolTable, std::string &&token) :
-            Completer("Command"), symbolTable(symbolTable), token(std::move(token)) {}
+    CmdNameCompleter(const SymbolTable &symbolTable, FilePathCache &pathCache, std::string &&token) :
+            Completer("Command"), symbolTable(symbolTable), pathCache(pathCache), token(std::move(token)) {}
 
     void operator()(ArrayObject &results) override;
-};
-
-static std::vector<std::string> computePathList(const char *pathVal) {
-    std::vector<std::string> result;
-    result.emplace_back();
-    assert(pathVal != nullptr);
 
-    for(unsigned int i = 0; pathVal[i] != '\0'; i++) {
-        int ch = pathVal[i];
-        if(ch == ':') {
-            result.emplace_back();
-        } else {
-            result.back() += static_cast<char>(ch);
-        }
-    }
-
-    // expand tilde
-    for(auto &s : result) {
-        expandTilde(s);
+    bool narrowable() const override {
+        return true;
     }
-
-    return result;
-}
+};
 
 void CmdNameCompleter::operator()(ArrayObject &results) {
     // search user defined command
     for(const auto &iter : this->symbolTable.globalScope()) {
-        const char *name = iter.first.c_str();
-        if(startsWith(name, CMD_SYMBOL_PREFIX)) {
-            name += strlen(CMD_SYMBOL_PREFIX);
+        SymbolKey key(iter.first);
+        if(key.kind() == SymbolKind::UDC) {
+            const char *name = this->symbolTable.getSymbolName(key);
             if(startsWith(name, this->token.c_str())) {
                 append(results, name, EscapeOp::COMMAND_NAME);
             }
@@ -307,30 +309,10 @@ void CmdNameCompleter::operator()(ArrayObject &results) {
 
 
     // search external command
-    const char *path = getenv(ENV_PATH);
-    if(path == nullptr) {
-        return;
-    }
-
-    auto pathList(computePathList(path));
-    for(const auto &p : pathList) {
-        DIR *dir = opendir(p.c_str());
-        if(dir == nullptr) {
-            continue;
-        }
-
-        for(dirent *entry; (entry = readdir(dir)) != nullptr;) {
-            const char *name = entry->d_name;
-            if(startsWith(name, this->token.c_str())) {
-                std::string fullpath(p);
-                fullpath += '/';
-                fullpath += name;
-                if(S_ISREG(getStMode(fullpath.c_str())) && access(fullpath.c_str(), X_OK) == 0) {
-                    append(results, name, EscapeOp::COMMAND_NAME);
-                }
-            }
-        }
-        closedir(dir);
+    std::vector<std::string> names;
+    this->pathCache.getExecutableNames(this->token.c_str(), names);
+    for(auto &name : names) {
+        append(results, name, EscapeOp::COMMAND_NAME);
     }
 }
 
@@ -344,13 +326,19 @@ public:
     GlobalVarNameCompleter(const SymbolTable &symbolTable, std::string &&token) :
             Completer("GlobalVar"), symbolTable(symbolTable), token(std::move(token)) {}
 
+    bool narrowable() const override {
+        return true;
+    }
+
     void operator()(ArrayObject &results) override {
         for(const auto &iter : this->symbolTable.globalScope()) {
-            const char *varName = iter.first.c_str();
-            if(!this->token.empty() && !startsWith(varName, CMD_SYMBOL_PREFIX)
-               && !startsWith(varName, MOD_SYMBOL_PREFIX)
-               && startsWith(varName, this->token.c_str() + 1)) {
-                append(results, iter.first, EscapeOp::NOP);
+            SymbolKey key(iter.first);
+            if(this->token.empty() || key.kind() != SymbolKind::VAR) {
+                continue;
+            }
+            const char *varName = this->symbolTable.getSymbolName(key);
+            if(startsWith(varName, this->token.c_str() + 1)) {
+                append(results, varName, EscapeOp::NOP);
             }
         }
     }
@@ -365,6 +353,11 @@ template <> struct allow_enum_bitop<FileNameCompOp> : std::true_type {};
 
 class FileNameCompleter : public Completer {
 protected:
+    /**
+     * for checking time budget of directory scan
+     */
+    CompletionCache &cache;
+
     const char *baseDir;
 
     const std::string token;
@@ -372,11 +365,16 @@ protected:
     const FileNameCompOp op;
 
 public:
-    FileNameCompleter(const char *baseDir, std::string &&token, FileNameCompOp op = FileNameCompOp()) :
-            Completer(""), baseDir(baseDir), token(std::move(token)), op(op) {
+    FileNameCompleter(CompletionCache &cache, const char *baseDir,
+                      std::string &&token, FileNameCompOp op = FileNameCompOp()) :
+            Completer(""), cache(cache), baseDir(baseDir), token(std::move(token)), op(op) {
         this->setName(this->onlyExec() ? "QualifiedCommand" : "FileName");
     }
 
+    bool narrowable() const override {
+        return true;
+    }
+
 protected:
     bool onlyExec() const {
         return hasFlag(this->op, FileNameCompOp::ONLY_EXEC);
@@ -442,7 +440,12 @@ void FileNameCompleter::operator()(ArrayObject &results) {
         return;
     }
 
+    unsigned int count = 0;
     for(dirent *entry; (entry = readdir(dir)) != nullptr;) {
+        if(++count % 64 == 0 && this->cache.checkTimeout()) {   // abort scan of slow directory
+            LOG(DUMP_CONSOLE, "exceed time budget: %s", targetDir.c_str());
+            break;
+        }
         if(startsWith(entry->d_name, name.c_str())) {
             if(name.empty() && (strcmp(entry->d_name, "..") == 0 || strcmp(entry->d_name, ".") == 0)) {
                 continue;
@@ -452,12 +455,29 @@ void FileNameCompleter::operator()(ArrayObject &results) {
             fullpath += '/';
             fullpath += entry->d_name;
 
-            if(this->onlyExec() && S_ISREG(getStMode(fullpath.c_str())) && access(fullpath.c_str(), X_OK) != 0) {
+            // if file type is unknown or symbolic link, resolve by stat
+            mode_t mode = 0;
+            switch(entry->d_type) {
+            case DT_DIR:
+                mode = S_IFDIR;
+                break;
+            case DT_REG:
+                mode = S_IFREG;
+                break;
+            case DT_UNKNOWN:
+            case DT_LNK:
+                mode = getStMode(fullpath.c_str());
+                break;
+            default:
+                break;
+            }
+
+            if(this->onlyExec() && S_ISREG(mode) && access(fullpath.c_str(), X_OK) != 0) {
                 continue;
             }
 
             std::string fileName = entry->d_name;
-            if(S_ISDIR(getStMode(fullpath.c_str()))) {
+            if(S_ISDIR(mode)) {
                 fileName += '/';
             }
             append(results, fileName, this->onlyExec() ? EscapeOp::COMMAND_NAME_PART : EscapeOp::COMMAND_ARG);
@@ -467,8 +487,8 @@ void FileNameCompleter::operator()(ArrayObject &results) {
 }
 
 struct ModNameCompleter : public FileNameCompleter {
-    ModNameCompleter(const char *scriptDir, std::string &&token, bool tilde) :
-            FileNameCompleter(scriptDir, std::move(token), tilde ? FileNameCompOp::TIDLE : FileNameCompOp{}) {
+    ModNameCompleter(CompletionCache &cache, const char *scriptDir, std::string &&token, bool tilde) :
+            FileNameCompleter(cache, scriptDir, std::move(token), tilde ? FileNameCompOp::TIDLE : FileNameCompOp{}) {
         this->setName("Module");
     }
 
@@ -498,6 +518,10 @@ public:
     AndCompleter(std::unique_ptr<Completer> &&first, std::unique_ptr<Completer> &&second) :
             Completer("And"), first(std::move(first)), second(std::move(second)) {}
 
+    bool narrowable() const override {
+        return this->first->narrowable() && this->second->narrowable();
+    }
+
     void operator()(ArrayObject &results) override {
         (*this->first)(results);
         (*this->second)(results);
@@ -545,7 +569,7 @@ public:
         }
 
         for(auto &e : typeAs<ArrayObject>(result).getValues()) {
-            append(ret, str(e), EscapeOp::COMMAND_ARG);
+            append(ret, str(e.materialize()), EscapeOp::COMMAND_ARG);
         }
     }
 };
@@ -625,16 +649,19 @@ public:
 private:
     std::unique_ptr<Completer> createModNameCompleter(CompType type) const {
         if(type == CompType::NONE) {
-            return std::make_unique<ModNameCompleter>(this->lexer.getScriptDir(), "", false);
+            return std::make_unique<ModNameCompleter>(this->state.compCache,
+                                                      this->lexer.getScriptDir(), "", false);
         }
         auto token = this->curToken();
         bool tilde = this->lexer.startsWith(token, '~');
-        return std::make_unique<ModNameCompleter>(this->lexer.getScriptDir(), this->lexer.toCmdArg(token), tilde);
+        return std::make_unique<ModNameCompleter>(this->state.compCache,
+                                                  this->lexer.getScriptDir(), this->lexer.toCmdArg(token), tilde);
     }
 
     std::unique_ptr<Completer> createFileNameCompleter(CompType type) const {
         if(type == CompType::NONE) {
-            return std::make_unique<FileNameCompleter>(this->state.logicalWorkingDir.c_str(), "");
+            return std::make_unique<FileNameCompleter>(this->state.compCache,
+                                                       this->state.logicalWorkingDir.c_str(), "");
         }
 
         FileNameCompOp op{};
@@ -642,12 +669,13 @@ private:
         if(this->lexer.startsWith(token, '~')) {
             setFlag(op, FileNameCompOp::TIDLE);
         }
-        return std::make_unique<FileNameCompleter>(this->state.logicalWorkingDir.c_str(), this->lexer.toCmdArg(token), op);
+        return std::make_unique<FileNameCompleter>(this->state.compCache,
+                                                   this->state.logicalWorkingDir.c_str(), this->lexer.toCmdArg(token), op);
     }
 
     std::unique_ptr<Completer> createCmdNameCompleter(CompType type) const {
         if(type == CompType::NONE) {
-            return std::make_unique<CmdNameCompleter>(this->state.symbolTable, "");
+            return std::make_unique<CmdNameCompleter>(this->state.symbolTable, this->state.pathCache, "");
         }
 
         auto token = this->curToken();
@@ -659,9 +687,10 @@ private:
             if(tilde) {
                 setFlag(op, FileNameCompOp::TIDLE);
             }
-            return std::make_unique<FileNameCompleter>(this->state.logicalWorkingDir.c_str(), std::move(arg), op);
+            return std::make_unique<FileNameCompleter>(this->state.compCache,
+                                                       this->state.logicalWorkingDir.c_str(), std::move(arg), op);
         }
-        return std::make_unique<CmdNameCompleter>(this->state.symbolTable, std::move(arg));
+        return std::make_unique<CmdNameCompleter>(this->state.symbolTable, this->state.pathCache, std::move(arg));
     }
 
     std::unique_ptr<Completer> createGlobalVarNameCompleter(Token token) const {
@@ -1021,12 +1050,91 @@ std::unique_ptr<Completer> CompleterFactory::selectCompleter() const {
     return nullptr;
 }
 
-void completeLine(DSState &st, const char *data, unsigned int size) {
-    CompleterFactory factory(st, data, size);
-    auto comp = factory();
-    if(comp) {
-        auto result = DSValue::create<ArrayObject>(st.symbolTable.get(TYPE::StringArray));
-        auto &compreply = typeAs<ArrayObject>(result);
+/**
+ * characters of word which are not escaped and not change completer
+ */
+static bool isWordChar(char ch) {
+    return isDecimal(ch) || (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')
+           || ch == '_' || ch == '-' || ch == '.';
+}
+
+static unsigned int trailingWordSize(StringRef line) {
+    unsigned int size = 0;
+    for(; size < line.size() && isWordChar(line[line.size() - 1 - size]); size++);
+    return size;
+}
+
+static bool isSamePath(const std::string &cached, const char *path) {
+    return cached == (path == nullptr ? "" : path);
+}
+
+// #############################
+// ##     CompletionCache     ##
+// #############################
+
+bool CompletionCache::narrow(StringRef line, const std::string &cwd, const char *path,
+                             std::vector<DSValue> &results) {
+    if(this->wordSize == 0 || line.size() <= this->line.size() || !line.startsWith(this->line)
+       || this->cwd != cwd || !isSamePath(this->path, path)) {
+        return false;
+    }
+    for(unsigned int i = this->line.size(); i < line.size(); i++) {
+        if(!isWordChar(line[i])) {
+            return false;
+        }
+    }
+
+    const unsigned int wordSize = this->wordSize + (line.size() - this->line.size());
+    auto word = line.substr(line.size() - wordSize);
+    for(auto &e : this->candidates) {
+        if(e.asStrRef().startsWith(word)) {
+            results.push_back(e);
+        }
+    }
+    this->line = line.toString();
+    this->candidates = results;
+    this->wordSize = wordSize;
+    return true;
+}
+
+void CompletionCache::update(StringRef line, const std::string &cwd, const char *path,
+                             const std::vector<DSValue> &results) {
+    this->clear();
+    const unsigned int wordSize = trailingWordSize(line);
+    if(wordSize == 0) {
+        return;
+    }
+    auto word = line.substr(line.size() - wordSize);
+    for(auto &e : results) {
+        if(!e.asStrRef().startsWith(word)) {
+            return;
+        }
+    }
+    this->line = line.toString();
+    this->cwd = cwd;
+    this->path = path == nullptr ? "" : path;
+    this->candidates = results;
+    this->wordSize = wordSize;
+}
+
+void completeLine(DSState &st, const char *data, unsigned int size, bool useCache) {
+    auto &cache = st.compCache;
+    cache.start();
+    const StringRef line(data, size);
+    const char *path = getenv(ENV_PATH);
+
+    auto result = DSValue::create<ArrayObject>(st.symbolTable.get(TYPE::StringArray));
+    auto &compreply = typeAs<ArrayObject>(result);
+    if(useCache && cache.narrow(line, st.logicalWorkingDir, path, compreply.refValues())) {
+        LOG(DUMP_CONSOLE, "narrow cached candidates: %zu", compreply.getValues().size());
+    } else {
+        CompleterFactory factory(st, data, size);
+        auto comp = factory();
+        if(!comp) {
+            cache.clear();
+            cache.finish();
+            return;
+        }
 
         (*comp)(compreply);
         auto &values = compreply.refValues();
@@ -1036,9 +1144,16 @@ void completeLine(DSState &st, const char *data, unsigned int size) {
         });
         values.erase(iter, values.end());
 
-        // override COMPREPLY
-        st.setGlobal(toIndex(BuiltinVarOffset::COMPREPLY), std::move(result));
+        if(useCache && comp->narrowable() && !cache.isTimeout() && !st.hasError()) {
+            cache.update(line, st.logicalWorkingDir, path, values);
+        } else {
+            cache.clear();
+        }
     }
+
+    // override COMPREPLY
+    st.setGlobal(toIndex(BuiltinVarOffset::COMPREPLY), std::move(result));
+    cache.finish();
 }
 
-} // namespace ydsh
\ No newline at end of file
+} // namespace ydsh
@@ -123,6 +123,7 @@ constexpr const char *ENV_OLDPWD = "OLDPWD";
 constexpr const char *ENV_PATH = "PATH";
 constexpr const char *ENV_SHLVL = "SHLVL";
 constexpr const char *ENV_TERM = "TERM";
+constexpr const char *ENV_MOD_CACHE_DIR = "YDSH_MODULE_CACHE_DIR";
 
 // =====  default value  =====
 
@@ -155,7 +156,6 @@ constexpr unsigned int TERM_ON_ERR    = 1u << 1u;
 constexpr unsigned int TERM_ON_ASSERT = 1u << 2u;
 
 // =====  for symbol lookup =====
-constexpr const char *CMD_SYMBOL_PREFIX = "%c";
 constexpr const char *MOD_SYMBOL_PREFIX = "%mod";
 
 // =====  for user-defined command  =====
@@ -194,6 +194,7 @@ inline const char *toString(GlobMeta meta) {
 // ===== for configuration =====
 constexpr const char *LOCAL_CONFIG_DIR = "~/.ydsh";
 constexpr const char *LOCAL_MOD_DIR = "~/.ydsh/module";
+constexpr const char *LOCAL_MOD_CACHE_DIR = "~/.ydsh/cache";
 
 constexpr const char *SYSTEM_CONFIG_DIR = X_INSTALL_PREFIX "/etc/ydsh";
 constexpr const char *SYSTEM_MOD_DIR = X_INSTALL_PREFIX "/etc/ydsh/module";
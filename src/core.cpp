@@ -16,8 +16,10 @@
 
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
 #include <pwd.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include <algorithm>
 #include <cassert>
@@ -27,6 +29,7 @@
 #include "logger.h"
 #include "misc/num_util.hpp"
 #include "misc/files.h"
+#include "misc/glob.hpp"
 
 extern char **environ;  //NOLINT
 
@@ -52,8 +55,10 @@ const char *FilePathCache::searchPath(const char *cmdName, FilePathCache::Search
     if(!hasFlag(op, DIRECT_SEARCH)) {
         auto iter = this->map.find(cmdName);
         if(iter != this->map.end()) {
+            this->stats.hit++;
             return iter->second.c_str();
         }
+        this->stats.miss++;
     }
 
     // get PATH
@@ -62,8 +67,24 @@ const char *FilePathCache::searchPath(const char *cmdName, FilePathCache::Search
         pathPrefix = VAL_DEFAULT_PATH;
     }
 
-    // resolve path
+    // search PATH index
     std::string resolvedPath;
+    if(!hasFlag(op, DIRECT_SEARCH)) {
+        switch(this->lookupIndex(pathPrefix, cmdName, resolvedPath)) {
+        case IndexResult::FOUND: {
+            auto pair = this->map.insert(std::make_pair(strdup(cmdName), std::move(resolvedPath)));
+            assert(pair.second);
+            return pair.first->second.c_str();
+        }
+        case IndexResult::NOT_FOUND:
+            return nullptr;
+        case IndexResult::UNKNOWN:
+            resolvedPath.clear();
+            break;
+        }
+    }
+
+    // resolve path
     for(unsigned int i = 0; !resolvedPath.empty() || pathPrefix[i] != '\0'; i++) {
         int ch = pathPrefix[i];
         bool stop = false;
@@ -91,10 +112,6 @@ const char *FilePathCache::searchPath(const char *cmdName, FilePathCache::Search
                 return this->prevPath.c_str();
             }
             // set to cache
-            if(this->map.size() == MAX_CACHE_SIZE) {
-                free(const_cast<char *>(this->map.begin()->first));
-                this->map.erase(this->map.begin());
-            }
             auto pair = this->map.insert(std::make_pair(strdup(cmdName), std::move(resolvedPath)));
             assert(pair.second);
             return pair.first->second.c_str();
@@ -129,6 +146,136 @@ void FilePathCache::clear() {
         free(const_cast<char *>(pair.first));
     }
     this->map.clear();
+    this->indexedPath.clear();
+    this->indexedDirs.clear();
+    this->nameIndex.clear();
+}
+
+void FilePathCache::getExecutableNames(const char *prefix, std::vector<std::string> &names) {
+    const char *pathValue = getenv(ENV_PATH);
+    if(pathValue == nullptr) {
+        return;
+    }
+    this->updateIndex(pathValue);
+    for(auto &dir : this->indexedDirs) {
+        for(auto &name : dir.names) {
+            if(StringRef(name).startsWith(prefix)) {
+                std::string fullpath(dir.path);
+                fullpath += '/';
+                fullpath += name;
+                if(S_ISREG(getStMode(fullpath.c_str())) && access(fullpath.c_str(), X_OK) == 0) {
+                    names.push_back(name);
+                }
+            }
+        }
+    }
+}
+
+static const struct timespec &getMtime(const struct stat &st) {
+#ifdef __APPLE__
+    return st.st_mtimespec;
+#else
+    return st.st_mtim;
+#endif
+}
+
+static bool isSameMtime(const struct timespec &x, const struct timespec &y) {
+    return x.tv_sec == y.tv_sec && x.tv_nsec == y.tv_nsec;
+}
+
+void FilePathCache::updateIndex(const char *pathValue) {
+    // if PATH is changed, rebuild directory list
+    if(this->indexedPath != pathValue || this->indexedDirs.empty()) {
+        this->indexedPath = pathValue;
+        this->indexedDirs.clear();
+        this->nameIndex.clear();
+
+        std::string dir;
+        for(unsigned int i = 0; ; i++) {
+            char ch = pathValue[i];
+            if(ch != ':' && ch != '\0') {
+                dir += ch;
+                continue;
+            }
+            if(!dir.empty()) {
+                while(dir.size() > 1 && dir.back() == '/') {
+                    dir.pop_back();
+                }
+                expandTilde(dir);
+                this->indexedDirs.push_back({std::move(dir), {}, 0, false, {}});
+                dir = "";
+            }
+            if(ch == '\0') {
+                break;
+            }
+        }
+    }
+
+    // rescan modified directory
+    bool modified = false;
+    for(auto &dir : this->indexedDirs) {
+        struct stat st{};
+        if(stat(dir.path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+            if(dir.scanned || !dir.names.empty()) {
+                dir.scanned = false;
+                dir.names.clear();
+                modified = true;
+            }
+            continue;
+        }
+        if(dir.scanned && dir.ino == st.st_ino && isSameMtime(dir.mtime, getMtime(st))) {
+            continue;
+        }
+
+        this->stats.rescan++;
+        modified = true;
+        dir.mtime = getMtime(st);
+        dir.ino = st.st_ino;
+        dir.names.clear();
+        DirEntries entries;
+        dir.scanned = readDirEntries(dir.path.c_str(), entries);
+        for(auto &e : entries) {
+            if(e.type != DT_DIR) {
+                dir.names.push_back(std::move(e.name));
+            }
+        }
+    }
+
+    if(modified || this->nameIndex.empty()) {
+        this->nameIndex.clear();
+        const unsigned int size = this->indexedDirs.size();
+        for(unsigned int i = 0; i < size; i++) {
+            for(auto &name : this->indexedDirs[i].names) {
+                this->nameIndex.emplace(name, i);
+            }
+        }
+    }
+}
+
+FilePathCache::IndexResult FilePathCache::lookupIndex(const char *pathValue, const char *cmdName,
+                                                      std::string &resolvedPath) {
+    this->updateIndex(pathValue);
+
+    auto iter = this->nameIndex.find(cmdName);
+    if(iter != this->nameIndex.end()) {
+        resolvedPath = this->indexedDirs[iter->second].path;
+        if(resolvedPath.back() != '/') {
+            resolvedPath += '/';
+        }
+        resolvedPath += cmdName;
+        struct stat st{};
+        if(stat(resolvedPath.c_str(), &st) == 0 && (st.st_mode & S_IXUSR) == S_IXUSR) {
+            return IndexResult::FOUND;
+        }
+        return IndexResult::UNKNOWN;    // not executable, search remain directories
+    }
+
+    for(auto &dir : this->indexedDirs) {
+        if(!dir.scanned) {
+            return IndexResult::UNKNOWN;
+        }
+    }
+    return IndexResult::NOT_FOUND;
 }
 
 struct StrArrayIter {
@@ -162,6 +309,193 @@ int GetOptState::operator()(const ArrayObject &obj, const char *optStr) {
     return ret;
 }
 
+// ##########################
+// ##     StdoutBuffer     ##
+// ##########################
+
+bool StdoutBuffer::write(const char *ptr, unsigned int size) {
+    this->tty = -1;
+
+    struct iovec iov[2];
+    iov[0].iov_base = const_cast<char *>(this->data.data());
+    iov[0].iov_len = this->data.size();
+    iov[1].iov_base = const_cast<char *>(ptr);
+    iov[1].iov_len = size;
+
+    bool success = true;
+    for(unsigned int index = 0; index < 2;) {
+        if(iov[index].iov_len == 0) {
+            index++;
+            continue;
+        }
+        ssize_t writeSize = writev(STDOUT_FILENO, iov + index, 2 - index);
+        if(writeSize < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            success = false;
+            break;
+        }
+        for(auto remain = static_cast<size_t>(writeSize); remain > 0;) {   // skip written data
+            if(remain >= iov[index].iov_len) {
+                remain -= iov[index].iov_len;
+                iov[index].iov_len = 0;
+                index++;
+            } else {
+                iov[index].iov_base = static_cast<char *>(iov[index].iov_base) + remain;
+                iov[index].iov_len -= remain;
+                remain = 0;
+            }
+        }
+    }
+    this->data.clear();
+    return success;
+}
+
+// ######################
+// ##     FDReader     ##
+// ######################
+
+FDReader::FDReader(FDReadBuffers &buffers, int fd, int timeout, bool consumeAll) :
+        fd(fd), timeout(isatty(fd) ? timeout : -2) {
+    struct stat st{};
+    if(this->timeout != -2 || fstat(fd, &st) != 0) {
+        return;
+    }
+
+    auto &e = buffers.get(fd);
+    if(e.dev != st.st_dev || e.ino != st.st_ino) {  // fd is reused
+        e = FDReadBuffers::Entry();
+        e.dev = st.st_dev;
+        e.ino = st.st_ino;
+    }
+
+    if(S_ISREG(st.st_mode)) {
+        off_t cur = lseek(fd, 0, SEEK_CUR);
+        if(cur != -1) {
+            if(e.offset + static_cast<off_t>(e.pos) != cur || e.fileSize != st.st_size
+               || !isSameMtime(e.mtime, getMtime(st))) {
+                e.clear();
+                e.offset = cur;
+                e.fileSize = st.st_size;
+                e.mtime = getMtime(st);
+            }
+            this->mode = Mode::SEEKABLE;
+            this->entry = &e;
+            this->baseOffset = cur;
+            return;
+        }
+    }
+
+    // not seekable (pipe, socket). fd may be passed to other process (even if has close-on-exec flag),
+    // so read ahead only if read until end of file
+    e.offset = -1;
+    e.clear();
+    if(consumeAll) {
+        this->mode = Mode::CONSUME_ALL;
+        this->entry = &e;
+    }
+}
+
+FDReader::~FDReader() {
+    if(this->mode == Mode::SEEKABLE) {
+        off_t cur = this->entry->offset + static_cast<off_t>(this->entry->pos);
+        if(cur != this->baseOffset) {
+            lseek(this->fd, cur, SEEK_SET);
+        }
+    } else if(this->mode == Mode::CONSUME_ALL) {
+        this->entry->clear();
+    }
+}
+
+bool FDReader::readLine(std::string &line, char delim) {
+    if(this->mode == Mode::UNBUFFERED) {
+        bool read = false;
+        for(int ch; (ch = this->nextChar()) != EOF; ) {
+            read = true;
+            if(ch == static_cast<unsigned char>(delim)) {
+                return true;
+            }
+            line += static_cast<char>(ch);
+        }
+        return read;
+    }
+
+    for(bool read = false; ; read = true) {
+        if(this->entry->remain() == 0 && !this->fill()) {
+            return read;
+        }
+        const char *begin = this->entry->data.c_str() + this->entry->pos;
+        const unsigned int size = this->entry->remain();
+        auto *ptr = static_cast<const char *>(memchr(begin, delim, size));
+        if(ptr != nullptr) {
+            line.append(begin, ptr - begin);
+            this->entry->pos += ptr - begin + 1;
+            return true;
+        }
+        line.append(begin, size);
+        this->entry->pos += size;
+    }
+}
+
+int FDReader::nextCharSlow() {
+    if(this->mode != Mode::UNBUFFERED) {
+        if(!this->fill()) {
+            return EOF;
+        }
+        return static_cast<unsigned char>(this->entry->data[this->entry->pos++]);
+    }
+
+    unsigned char ch;
+    ssize_t readSize;
+    do {
+        errno = 0;
+        if(this->timeout > -2) {
+            struct pollfd pollfd[1];
+            pollfd[0].fd = this->fd;
+            pollfd[0].events = POLLIN;
+            if(poll(pollfd, 1, this->timeout) != 1) {
+                return EOF;
+            }
+        }
+        readSize = read(this->fd, &ch, 1);
+    } while(readSize < 0 && (errno == EAGAIN || errno == EINTR));
+    if(readSize < 0) {
+        this->error = true;
+    }
+    return readSize <= 0 ? EOF : ch;
+}
+
+bool FDReader::fill() {
+    auto &e = *this->entry;
+
+    // remove consumed data
+    if(e.pos > 0) {
+        if(this->mode == Mode::SEEKABLE) {
+            e.offset += e.pos;
+        }
+        e.data.erase(0, e.pos);
+        e.pos = 0;
+    }
+
+    const unsigned int oldSize = e.data.size();
+    e.data.resize(oldSize + CHUNK_SIZE);
+    ssize_t readSize;
+    do {
+        errno = 0;
+        if(this->mode == Mode::SEEKABLE) {
+            readSize = pread(this->fd, &e.data[oldSize], CHUNK_SIZE, e.offset + oldSize);
+        } else {
+            readSize = read(this->fd, &e.data[oldSize], CHUNK_SIZE);
+        }
+    } while(readSize < 0 && (errno == EAGAIN || errno == EINTR));
+    e.data.resize(oldSize + (readSize > 0 ? readSize : 0));
+    if(readSize < 0) {
+        this->error = true;
+    }
+    return readSize > 0;
+}
+
 // core api definition
 const DSValue &getGlobal(const DSState &st, const char *varName) {
     auto *handle = st.symbolTable.lookupHandle(varName);
@@ -18,11 +18,15 @@
 #define YDSH_CORE_H
 
 #include <unistd.h>
+#include <sys/types.h>
 
 #include <csignal>
+#include <ctime>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <array>
+#include <unordered_map>
 
 #include "opcode.h"
 #include "object.h"
@@ -44,6 +48,7 @@ enum class BuiltinVarOffset : unsigned int {
     SCRIPT_DIR,     // SCRIPT_DIR
     REPLY,          // REPLY (for read command)
     REPLY_VAR,      // reply (fo read command)
+    MAPFILE,        // MAPFILE (for readarray command)
     PID,            // PID (current process)
     PPID,           // PPID
     SECONDS,        // SECONDS
@@ -72,7 +77,62 @@ private:
 
     CStringHashMap<std::string> map;
 
-    static constexpr unsigned int MAX_CACHE_SIZE = 100;
+    /**
+     * directory entries of PATH directory
+     */
+    struct IndexedDir {
+        std::string path;
+
+        /**
+         * for invalidation
+         */
+        struct timespec mtime;
+
+        ino_t ino;
+
+        /**
+         * if false, cannot read directory entries (not exist or not permitted)
+         */
+        bool scanned;
+
+        /**
+         * file names (except for directory)
+         */
+        std::vector<std::string> names;
+    };
+
+    /**
+     * PATH value of current index
+     */
+    std::string indexedPath;
+
+    std::vector<IndexedDir> indexedDirs;
+
+    /**
+     * command name to index of indexedDirs (first found directory in PATH order)
+     */
+    std::unordered_map<std::string, unsigned int> nameIndex;
+
+public:
+    struct Stats {
+        /**
+         * number of cache hits
+         */
+        unsigned int hit{0};
+
+        /**
+         * number of cache misses (resolved by PATH index or PATH search)
+         */
+        unsigned int miss{0};
+
+        /**
+         * number of PATH directory scans
+         */
+        unsigned int rescan{0};
+    };
+
+private:
+    Stats stats;
 
 public:
     NON_COPYABLE(FilePathCache);
@@ -98,10 +158,22 @@ public:
     bool isCached(const char *cmdName) const;
 
     /**
-     * clear all cache
+     * clear all cache and PATH index
      */
     void clear();
 
+    /**
+     * get names of executable file in PATH (use PATH index)
+     * @param prefix
+     * @param names
+     * append matched names
+     */
+    void getExecutableNames(const char *prefix, std::vector<std::string> &names);
+
+    const Stats &getStats() const {
+        return this->stats;
+    }
+
     /**
      * get begin iterator of map
      */
@@ -115,10 +187,253 @@ public:
     auto end() const {
         return this->map.cend();
     }
+
+private:
+    /**
+     * update PATH index if PATH value or modification time of PATH directory is changed
+     * @param pathValue
+     */
+    void updateIndex(const char *pathValue);
+
+    enum class IndexResult {
+        FOUND,
+        NOT_FOUND,
+        UNKNOWN,    // some directories cannot be indexed
+    };
+
+    IndexResult lookupIndex(const char *pathValue, const char *cmdName, std::string &resolvedPath);
 };
 
 template <> struct allow_enum_bitop<FilePathCache::SearchOp> : std::true_type {};
 
+/**
+ * read-ahead buffers of input file descriptors (for read/readarray builtin).
+ *
+ * read-ahead is performed only when not lose data for other readers.
+ * if fd is seekable, after reading, rewind file offset to just after consumed data
+ * (and keep buffered data for next read if file offset and file is not changed).
+ * if fd is not seekable (pipe, socket), fd may be passed to other process, so read one byte at a time
+ * (unless read until end of file). unconsumed data is never kept in buffer.
+ */
+class FDReadBuffers {
+public:
+    struct Entry {
+        dev_t dev{0};
+        ino_t ino{0};
+
+        /**
+         * for seekable fd. file offset corresponding to data[pos]
+         */
+        off_t offset{-1};
+
+        /**
+         * for seekable fd. for detecting modification
+         */
+        off_t fileSize{0};
+        struct timespec mtime{};
+
+        std::string data;
+
+        /**
+         * consumed size of data
+         */
+        unsigned int pos{0};
+
+        unsigned int remain() const {
+            return this->data.size() - this->pos;
+        }
+
+        void clear() {
+            this->data.clear();
+            this->pos = 0;
+        }
+    };
+
+private:
+    std::unordered_map<int, Entry> entries;
+
+public:
+    Entry &get(int fd) {
+        return this->entries[fd];
+    }
+
+    void discard(int fd) {
+        this->entries.erase(fd);
+    }
+
+    void clear() {
+        this->entries.clear();
+    }
+};
+
+/**
+ * buffered standard output of builtin commands (for echo builtin).
+ *
+ * buffered data is written by single writev when reach buffer capacity,
+ * or before fork/exec, redirection change, other builtin command call and end of evaluation.
+ * if standard output is tty, written after each builtin command call.
+ */
+class StdoutBuffer {
+private:
+    enum : unsigned int {
+        CAPACITY = 64 * 1024,
+    };
+
+    std::string data;
+
+    /**
+     * cached result of isatty(STDOUT_FILENO). if -1, not checked yet.
+     * reset at flush (standard output may be changed after that)
+     */
+    int tty{-1};
+
+public:
+    void append(const char *ptr, unsigned int size) {
+        if(this->data.size() + size > CAPACITY) {
+            this->write(ptr, size);
+        } else {
+            this->data.append(ptr, size);
+        }
+    }
+
+    void append(char ch) {
+        if(this->data.size() == CAPACITY) {
+            this->write(nullptr, 0);
+        }
+        this->data += ch;
+    }
+
+    /**
+     * write buffered data to standard output.
+     * @return
+     * if write failed, return false (buffered data is discarded)
+     */
+    bool flush() {
+        return this->write(nullptr, 0);
+    }
+
+    /**
+     * call after builtin command. if standard output is tty, flush buffered data
+     * @return
+     */
+    bool sync() {
+        if(this->data.empty()) {
+            return true;
+        }
+        if(this->tty == -1) {
+            this->tty = isatty(STDOUT_FILENO) ? 1 : 0;
+        }
+        return this->tty == 0 || this->flush();
+    }
+
+private:
+    /**
+     * write buffered data and additional data
+     * @param ptr
+     * may be null
+     * @param size
+     * @return
+     */
+    bool write(const char *ptr, unsigned int size);
+};
+
+class FDReader {
+public:
+    enum class Mode : unsigned char {
+        UNBUFFERED,
+        SEEKABLE,
+        CONSUME_ALL,
+    };
+
+private:
+    enum : unsigned int {
+        CHUNK_SIZE = 64 * 1024,
+    };
+
+    const int fd;
+
+    /**
+     * for poll. if -2, not poll
+     */
+    const int timeout;
+
+    Mode mode{Mode::UNBUFFERED};
+
+    /**
+     * if mode is UNBUFFERED, null
+     */
+    FDReadBuffers::Entry *entry{nullptr};
+
+    /**
+     * for seekable fd. file offset of data[0] of entry
+     */
+    off_t baseOffset{0};
+
+    /**
+     * if true, error happened
+     */
+    bool error{false};
+
+public:
+    NON_COPYABLE(FDReader);
+
+    /**
+     *
+     * @param buffers
+     * @param fd
+     * @param timeout
+     * if fd is tty, timeout msec (-1 indicates no timeout). if fd is not tty, ignored
+     * @param consumeAll
+     * if true, read all data until end of file (so, always read ahead even if fd is shared)
+     */
+    FDReader(FDReadBuffers &buffers, int fd, int timeout, bool consumeAll = false);
+
+    /**
+     * rewind file offset of seekable fd
+     */
+    ~FDReader();
+
+    Mode getMode() const {
+        return this->mode;
+    }
+
+    bool hasError() const {
+        return this->error;
+    }
+
+    /**
+     *
+     * @return
+     * if reach end of file or error, return EOF
+     */
+    int nextChar() {
+        if(this->entry && this->entry->remain() > 0) {
+            return static_cast<unsigned char>(this->entry->data[this->entry->pos++]);
+        }
+        return this->nextCharSlow();
+    }
+
+    /**
+     * read data until delimiter. delimiter is not included.
+     * @param line
+     * append read data.
+     * @param delim
+     * @return
+     * if reach end of file without reading any data, return false.
+     */
+    bool readLine(std::string &line, char delim = '\n');
+
+private:
+    int nextCharSlow();
+
+    /**
+     * read next chunk into entry
+     * @return
+     * if reach end of file or error, return false
+     */
+    bool fill();
+};
+
 struct GetOptState : public opt::GetOptState {
     /**
      * index of next processing argument
@@ -145,7 +460,7 @@ struct VMHook {
 };
 
 struct DumpTarget {
-    FilePtr files[3];
+    FilePtr files[4];
 };
 
 const DSValue &getGlobal(const DSState &st, const char *varName);
@@ -214,6 +529,121 @@ std::string expandDots(const char *basePath, const char *path);
 
 void expandTilde(std::string &str);
 
+/**
+ * maintains candidates of last completion during line editing.
+ * if completing line is extended by typing word characters, narrow cached candidates
+ * instead of recomputing (only if candidates are filtered by prefix of current word).
+ * cache is keyed by line, working directory and PATH, and cleared at evaluation.
+ */
+class CompletionCache {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * default time budget of directory scan (msec)
+     */
+    static constexpr unsigned int DEFAULT_BUDGET = 200;
+
+private:
+    std::string line;
+
+    std::string cwd;
+
+    std::string path;
+
+    /**
+     * sorted. each candidate starts with trailing word of line
+     */
+    std::vector<DSValue> candidates;
+
+    /**
+     * size of trailing word of line (not 0 if available)
+     */
+    unsigned int wordSize{0};
+
+    /**
+     * time budget of directory scan (msec). if 0, not limit
+     */
+    unsigned int budget{DEFAULT_BUDGET};
+
+    clock::time_point startTime;
+
+    /**
+     * if true, directory scan exceeds time budget
+     */
+    bool timeout{false};
+
+    /**
+     * elapsed time of last completion (usec)
+     */
+    unsigned int elapsed{0};
+
+public:
+    void clear() {
+        this->line.clear();
+        this->candidates.clear();
+        this->wordSize = 0;
+    }
+
+    void setBudget(unsigned int msec) {
+        this->budget = msec;
+    }
+
+    unsigned int getElapsed() const {
+        return this->elapsed;
+    }
+
+    void start() {
+        this->startTime = clock::now();
+        this->timeout = false;
+    }
+
+    void finish() {
+        auto diff = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - this->startTime);
+        this->elapsed = static_cast<unsigned int>(diff.count());
+    }
+
+    /**
+     * check time budget. call periodically during directory scan
+     * @return
+     * if exceed time budget, return true
+     */
+    bool checkTimeout() {
+        if(!this->timeout && this->budget > 0
+           && clock::now() - this->startTime > std::chrono::milliseconds(this->budget)) {
+            this->timeout = true;
+        }
+        return this->timeout;
+    }
+
+    bool isTimeout() const {
+        return this->timeout;
+    }
+
+    /**
+     * narrow cached candidates.
+     * @param line
+     * @param cwd
+     * @param path
+     * value of PATH. may be null
+     * @param results
+     * @return
+     * if cache is not available for line, return false
+     */
+    bool narrow(StringRef line, const std::string &cwd, const char *path, std::vector<DSValue> &results);
+
+    /**
+     * update cache. if candidates are not narrowable, clear cache
+     * @param line
+     * @param cwd
+     * @param path
+     * may be null
+     * @param results
+     * must be sorted
+     */
+    void update(StringRef line, const std::string &cwd, const char *path, const std::vector<DSValue> &results);
+};
+
 /**
  * complete line.
  * after completion success, set results to COMPREPLY.
@@ -221,8 +651,10 @@ void expandTilde(std::string &str);
  * @param data
  * @param size
  * size of data
+ * @param useCache
+ * if true, use and update DSState::compCache (for interactive completion)
  */
-void completeLine(DSState &st, const char *data, unsigned int size);
+void completeLine(DSState &st, const char *data, unsigned int size, bool useCache = false);
 
 class SignalGuard {
 private:
@@ -16,6 +16,11 @@
 
 #include <cstdlib>
 #include <cerrno>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#include <system_error>
+#include <unordered_set>
 
 #include <unistd.h>
 
@@ -152,17 +157,26 @@ void FrontEnd::handleError(DSErrorKind type, const char *errorKind,
     }
 }
 
-std::unique_ptr<Node> FrontEnd::tryToParse(DSError *dsError) {
-    std::unique_ptr<Node> node;
-    if(this->parser) {
+bool FrontEnd::tryToParse(std::unique_ptr<Node> &node, DSError *dsError) {
+    if(!this->contexts.empty() && this->contexts.back()->parsed) {
+        auto &parsed = *this->contexts.back()->parsed;
+        if(parsed.index < parsed.nodes.size()) {
+            node = std::move(parsed.nodes[parsed.index++]);
+        } else if(parsed.error) {
+            this->handleParseError(*parsed.error, dsError);
+            return false;
+        }
+    } else if(this->parser) {
         node = this->parser();
         if(this->parser.hasError()) {
             this->handleParseError(dsError);
-        } else if(this->uastDumper) {
-            this->uastDumper(*node);
+            return false;
         }
     }
-    return node;
+    if(node && this->uastDumper) {
+        this->uastDumper(*node);
+    }
+    return true;
 }
 
 bool FrontEnd::tryToCheckType(std::unique_ptr<Node> &node, DSError *dsError) {
@@ -185,6 +199,7 @@ bool FrontEnd::tryToCheckType(std::unique_ptr<Node> &node, DSError *dsError) {
 }
 
 FrontEnd::Ret FrontEnd::operator()(DSError *dsError) {
+    NodeArenaScope scope(*this->nodeArena);
     do {
         // load module
         Ret ret = this->loadModule(dsError);
@@ -194,8 +209,7 @@ FrontEnd::Ret FrontEnd::operator()(DSError *dsError) {
 
         // parse
         if(!ret.node) {
-            ret.node = this->tryToParse(dsError);
-            if(this->parser.hasError()) {
+            if(!this->tryToParse(ret.node, dsError)) {
                 return {nullptr, FAILED};
             }
         }
@@ -251,6 +265,185 @@ static auto createModLoadingError(const Node &node, const char *path, ModLoading
     }
 }
 
+static Lexer createLexer(const char *fullPath, SourceBuffer &&buf) {
+    assert(*fullPath == '/');
+    char *path = strdup(fullPath);
+    const char *ptr = strrchr(path, '/');
+    path[ptr == path ? 1 : ptr - path] = '\0';
+    return Lexer(fullPath, std::move(buf), CStrPtr(path));
+}
+
+/**
+ * get source path without type checking.
+ * only support string literal and $SCRIPT_DIR
+ * @param node
+ * @param scriptDir
+ * @param path
+ * @return
+ * if source path is not statically known, return false
+ */
+static bool getStaticSourcePath(const SourceListNode &node, const char *scriptDir, std::string &path) {
+    for(auto &e : node.getPathNode().getSegmentNodes()) {
+        if(isa<StringNode>(*e) && !cast<StringNode>(*e).isTilde()) {
+            path += cast<StringNode>(*e).getValue();
+        } else if(isa<VarNode>(*e) && cast<VarNode>(*e).getVarName() == CVAR_SCRIPT_DIR) {
+            path += scriptDir;
+        } else {
+            return false;
+        }
+    }
+    return !path.empty();
+}
+
+struct PrefetchTask {
+    /**
+     * if empty, only collect source paths (for root script)
+     */
+    std::string fullPath;
+
+    std::unique_ptr<Lexer> lexer;
+    std::unique_ptr<ParsedModule> parsed;
+};
+
+/**
+ * read and parse module. may be called from worker thread,
+ * so not touch SymbolTable and TypePool.
+ * @param task
+ * if cannot read module, task.parsed is null
+ */
+static void parseModule(PrefetchTask &task) {
+    if(!task.lexer) {
+        auto filePtr = createFilePtr(fopen, task.fullPath.c_str(), "rb");
+        if(!filePtr || S_ISDIR(getStMode(fileno(filePtr.get())))) {
+            return;
+        }
+        SourceBuffer buf;
+        if(!readAll(filePtr, buf)) {
+            return;
+        }
+        task.lexer = std::make_unique<Lexer>(createLexer(task.fullPath.c_str(), std::move(buf)));
+    }
+
+    /**
+     * nodes are allocated in per-module arena.
+     * after owner is destroyed, arena is freed when all of nodes are released
+     */
+    Arena::Owner arena;
+    NodeArenaScope scope(*arena);
+    auto parsed = std::make_unique<ParsedModule>();
+    Parser parser(*task.lexer);
+    while(parser) {
+        auto node = parser();
+        if(parser.hasError()) {
+            parsed->error = std::make_unique<ParseError>(parser.getError());
+            break;
+        }
+        if(!node) {
+            break;
+        }
+        std::string path;
+        if(isa<SourceListNode>(*node) &&
+           getStaticSourcePath(cast<SourceListNode>(*node), task.lexer->getScriptDir(), path)) {
+            parsed->sourcePaths.push_back(std::move(path));
+        }
+        parsed->nodes.push_back(std::move(node));
+    }
+    task.parsed = std::move(parsed);
+}
+
+constexpr unsigned int PREFETCH_MAX_WORKERS = 4;
+
+/**
+ * parse modules on small worker pool. calling thread also works as worker.
+ * @param tasks
+ */
+static void parseModulesInParallel(std::vector<PrefetchTask> &tasks) {
+    unsigned int workerSize = std::thread::hardware_concurrency();
+    if(workerSize > PREFETCH_MAX_WORKERS) {
+        workerSize = PREFETCH_MAX_WORKERS;
+    }
+    if(workerSize > tasks.size()) {
+        workerSize = tasks.size();
+    }
+
+    std::atomic<size_t> index{0};
+    auto worker = [&] {
+        for(size_t i; (i = index.fetch_add(1, std::memory_order_relaxed)) < tasks.size(); ) {
+            parseModule(tasks[i]);
+        }
+    };
+
+    // block all signals in worker threads (signal handler always run on main thread)
+    sigset_t maskSet;
+    sigset_t oldSet;
+    sigfillset(&maskSet);
+    pthread_sigmask(SIG_BLOCK, &maskSet, &oldSet);
+    std::vector<std::thread> threads;
+    for(unsigned int i = 1; i < workerSize; i++) {
+        try {
+            threads.emplace_back(worker);
+        } catch(const std::system_error &) {
+            break;  // if cannot create thread, remaining tasks are processed by calling thread
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+
+    worker();
+    for(auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void FrontEnd::prefetchModules(const char *fullPath) {
+    std::unordered_set<std::string> visited;
+    visited.emplace(fullPath);
+    std::vector<PrefetchTask> tasks;
+    tasks.push_back({fullPath, nullptr, nullptr});
+    if(!this->rootScanned) {
+        /**
+         * root script is parsed incrementally, so source paths of remaining statements are unknown.
+         * parse copy of root script concurrently for collecting them
+         */
+        this->rootScanned = true;
+        StringRef ref = this->lexer.toStrRef(Token{0, this->lexer.getUsedSize()});
+        ByteBuffer buf;
+        buf.append(ref.data(), ref.size());
+        tasks.push_back({"", std::make_unique<Lexer>(this->lexer.getSourceName().c_str(), SourceBuffer(std::move(buf)),
+                                                     CStrPtr(strdup(this->lexer.getScriptDir()))), nullptr});
+    }
+    while(!tasks.empty()) {
+        if(tasks.size() == 1) {
+            parseModule(tasks[0]);
+        } else {
+            parseModulesInParallel(tasks);
+        }
+
+        // commit results in task order (resolve next level on main thread)
+        std::vector<PrefetchTask> nextTasks;
+        for(auto &task : tasks) {
+            if(!task.parsed) {
+                continue;   // report error at actual module loading
+            }
+            for(auto &e : task.parsed->sourcePaths) {
+                std::string path = this->getSymbolTable().resolveModulePath(task.lexer->getScriptDir(), e.c_str());
+                if(path.empty() || this->parsedModules.find(path) != this->parsedModules.end()
+                    || !visited.insert(path).second) {
+                    continue;
+                }
+                if(this->modCache && this->modCache->isFresh(this->getSymbolTable(), path.c_str())) {
+                    continue;   // will be restored from cache (if failed, prefetch at actual module loading)
+                }
+                nextTasks.push_back({std::move(path), nullptr, nullptr});
+            }
+            if(!task.fullPath.empty()) {
+                this->parsedModules.emplace(std::move(task.fullPath),
+                                            std::make_pair(std::move(*task.lexer), std::move(task.parsed)));
+            }
+        }
+        tasks = std::move(nextTasks);
+    }
+}
+
 FrontEnd::Ret FrontEnd::loadModule(DSError *dsError) {
     if(!this->getCurSrcListNode()) {
         return {nullptr, IN_MODULE};
@@ -276,13 +469,42 @@ FrontEnd::Ret FrontEnd::loadModule(DSError *dsError) {
         this->handleTypeError(error, dsError);
         return {nullptr, FAILED};
     } else if(is<const char *>(ret)) {
-        ByteBuffer buf;
+        const char *fullPath = get<const char *>(ret);
+        if(this->modCache) {
+            unsigned int varNum = 0;
+            bool nothing = false;
+            auto *modType = this->modCache->load(this->getSymbolTable(), get<const char *>(ret),
+                                                 fileno(filePtr.get()), varNum, nothing);
+            if(modType != nullptr) {
+                this->parsedModules.erase(fullPath);
+                this->restoreModuleScope();
+                auto srcNode = node.create(*modType, true);
+                srcNode->setMaxVarNum(varNum);
+                srcNode->setNothing(nothing);
+                return {std::move(srcNode), IN_MODULE};
+            }
+        }
+
+        // prefetch after cache miss (not waste parsing of cached module)
+        auto iter = this->parsedModules.find(fullPath);
+        if(this->parallelLoad && iter == this->parsedModules.end()) {
+            this->prefetchModules(fullPath);
+            iter = this->parsedModules.find(fullPath);
+        }
+        if(iter != this->parsedModules.end()) {
+            Lexer lex = std::move(iter->second.first);
+            auto parsed = std::move(iter->second.second);
+            this->parsedModules.erase(iter);
+            this->enterModule(std::move(lex), std::move(parsed));
+            return {nullptr, ENTER_MODULE};
+        }
+        SourceBuffer buf;
         if(!readAll(filePtr, buf)) {
             auto e = createTCError<NotOpenMod>(node.getPathNode(), modPath, strerror(errno));
             this->handleTypeError(e, dsError);
             return {nullptr, FAILED};
         }
-        this->enterModule(get<const char*>(ret), std::move(buf));
+        this->enterModule(createLexer(fullPath, std::move(buf)), nullptr);
         return {nullptr, ENTER_MODULE};
     } else if(is<ModType *>(ret)) {
         return {node.create(*get<ModType *>(ret), false), IN_MODULE};
@@ -290,29 +512,26 @@ FrontEnd::Ret FrontEnd::loadModule(DSError *dsError) {
     return {nullptr, FAILED};
 }
 
-static Lexer createLexer(const char *fullPath, ByteBuffer &&buf) {
-    assert(*fullPath == '/');
-    char *path = strdup(fullPath);
-    const char *ptr = strrchr(path, '/');
-    path[ptr == path ? 1 : ptr - path] = '\0';
-    return Lexer(fullPath, std::move(buf), CStrPtr(path));
-}
-
-void FrontEnd::enterModule(const char *fullPath, ByteBuffer &&buf) {
+void FrontEnd::enterModule(Lexer &&lexer, std::unique_ptr<ParsedModule> &&parsed) {
     {
-        auto lex = createLexer(fullPath, std::move(buf));
         auto state = this->parser.saveLexicalState();
         auto scope = this->getSymbolTable().createModuleScope();
         this->contexts.push_back(
-                std::make_unique<Context>(std::move(lex), std::move(scope), std::move(state)));
+                std::make_unique<Context>(std::move(lexer), std::move(scope), std::move(state)));
+        this->contexts.back()->parsed = std::move(parsed);
         this->getSymbolTable().setModuleScope(this->contexts.back()->scope);
     }
     Token token{};
-    TokenKind kind = this->contexts.back()->lexer.nextToken(token);
+    TokenKind kind = EOS;   // if already parsed, not parse anymore
+    if(!this->contexts.back()->parsed) {
+        kind = this->contexts.back()->lexer.nextToken(token);
+    }
     TokenKind ckind{};
     this->parser.restoreLexicalState(this->contexts.back()->lexer, kind, token, ckind);
     this->checker.setLexer(this->contexts.back()->lexer);
 
+    const char *fullPath = this->contexts.back()->lexer.getSourceName().c_str();
+
     if(this->uastDumper) {
         this->uastDumper->enterModule(fullPath);
     }
@@ -332,11 +551,7 @@ std::unique_ptr<SourceNode> FrontEnd::exitModule() {
 
     auto &lex = this->contexts.empty() ? this->lexer : this->contexts.back()->lexer;
     this->parser.restoreLexicalState(lex, kind, token, consumedKind);
-    if(this->contexts.empty()) {
-        this->getSymbolTable().resetCurModule();
-    } else {
-        this->getSymbolTable().setModuleScope(this->contexts.back()->scope);
-    }
+    this->restoreModuleScope();
 
     auto node = this->getCurSrcListNode()->create(modType, true);
     if(this->mode != DS_EXEC_MODE_PARSE_ONLY) {
@@ -356,4 +571,12 @@ std::unique_ptr<SourceNode> FrontEnd::exitModule() {
     return node;
 }
 
+void FrontEnd::restoreModuleScope() {
+    if(this->contexts.empty()) {
+        this->getSymbolTable().resetCurModule();
+    } else {
+        this->getSymbolTable().setModuleScope(this->contexts.back()->scope);
+    }
+}
+
 } // namespace ydsh
@@ -20,6 +20,7 @@
 #include <ydsh/ydsh.h>
 #include "parser.h"
 #include "type_checker.h"
+#include "module_cache.h"
 
 namespace ydsh {
 
@@ -60,6 +61,28 @@ private:
     void printErrorLine(const Lexer &lexer, Token token) const;
 };
 
+/**
+ * top-level nodes of module parsed ahead of type checking (for parallel module loading)
+ */
+struct ParsedModule {
+    std::vector<std::unique_ptr<Node>> nodes;
+
+    /**
+     * index of next node
+     */
+    unsigned int index{0};
+
+    /**
+     * if not null, parse error is occurred after last node
+     */
+    std::unique_ptr<ParseError> error;
+
+    /**
+     * statically known source paths (not resolved)
+     */
+    std::vector<std::string> sourcePaths;
+};
+
 class FrontEnd {
 public:
     enum Status : unsigned char {
@@ -89,12 +112,23 @@ private:
         TokenKind consumedKind;
         std::unique_ptr<SourceListNode> srcListNode;
 
+        /**
+         * if not null, module is already parsed
+         */
+        std::unique_ptr<ParsedModule> parsed;
+
         Context(Lexer &&lexer, ModuleScope &&scope, std::tuple<TokenKind, Token, TokenKind > &&state) :
                 lexer(std::move(lexer)), scope(std::move(scope)),
                 kind(std::get<0>(state)), token(std::get<1>(state)),
                 consumedKind(std::get<2>(state)){}
     };
 
+    /**
+     * owns all nodes of this compilation unit (including sourced modules).
+     * nodes are released at once after codegen
+     */
+    Arena::Owner nodeArena;
+
     // root lexer state
     Lexer lexer;
 
@@ -110,6 +144,22 @@ private:
     ObserverPtr<ErrorReporter> reporter;
     ObserverPtr<NodeDumper> uastDumper;
     ObserverPtr<NodeDumper> astDumper;
+    ObserverPtr<ModuleCache> modCache;
+
+    /**
+     * if true, parse modules reachable from loading module in parallel before type checking
+     */
+    bool parallelLoad{false};
+
+    /**
+     * if true, source paths of root script are already collected
+     */
+    bool rootScanned{false};
+
+    /**
+     * modules parsed ahead. key is full path of module
+     */
+    std::unordered_map<std::string, std::pair<Lexer, std::unique_ptr<ParsedModule>>> parsedModules;
 
 public:
     FrontEnd(Lexer &&lexer, SymbolTable &symbolTable, DSExecMode mode, bool toplevel);
@@ -132,6 +182,14 @@ public:
         this->astDumper.reset(&dumper);
     }
 
+    void setModuleCache(ModuleCache &cache) {
+        this->modCache.reset(&cache);
+    }
+
+    void setParallelLoad(bool set) {
+        this->parallelLoad = set;
+    }
+
     SymbolTable &getSymbolTable() {
         return this->checker.getSymbolTable();
     }
@@ -171,22 +229,49 @@ private:
         return this->contexts.empty() ? this->srcListNode : this->contexts.back()->srcListNode;
     }
 
-    std::unique_ptr<Node> tryToParse(DSError *dsError);
+    /**
+     *
+     * @param node
+     * if reach end of module, set null
+     * @param dsError
+     * @return
+     * if has parse error, return false
+     */
+    bool tryToParse(std::unique_ptr<Node> &node, DSError *dsError);
 
     bool tryToCheckType(std::unique_ptr<Node> &node, DSError *dsError);
 
     Ret loadModule(DSError *dsError);
 
-    void enterModule(const char *fullPath, ByteBuffer &&buf);
+    void enterModule(Lexer &&lexer, std::unique_ptr<ParsedModule> &&parsed);
+
+    /**
+     * parse specified module and modules reachable from it (via statically known source path)
+     * level by level. each level is parsed in parallel.
+     * modules having fresh cache are skipped.
+     * parsed modules are stored in parsedModules.
+     * type checking and code generation are not parallelized
+     * (TypePool and SymbolTable are not thread-safe)
+     * @param fullPath
+     */
+    void prefetchModules(const char *fullPath);
 
     std::unique_ptr<SourceNode> exitModule();
 
+    /**
+     * restore module scope of current context
+     */
+    void restoreModuleScope();
+
     // for error reporting
     void handleError(DSErrorKind type, const char *errorKind,
             Token errorToken, const std::string &message, DSError *dsError) const;
 
     void handleParseError(DSError *dsError) const {
-        auto &e = this->parser.getError();
+        this->handleParseError(this->parser.getError(), dsError);
+    }
+
+    void handleParseError(const ParseError &e, DSError *dsError) const {
         Token errorToken = this->parser.getLexer()->shiftEOS(e.getErrorToken());
         return this->handleError(DS_ERROR_KIND_PARSE_ERROR, e.getErrorKind(), errorToken, e.getMessage(), dsError);
     }
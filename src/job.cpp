@@ -15,9 +15,13 @@
  */
 
 #include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <spawn.h>
 
 #include <algorithm>
 #include <cerrno>
+#include <csignal>
 
 #include "vm.h"
 #include "logger.h"
@@ -27,6 +31,12 @@ namespace ydsh {
 Proc Proc::fork(DSState &st, pid_t pgid, bool foreground) {
     SignalGuard guard;
 
+    // directory entries may be changed by child process
+    st.globCache.clear();
+
+    // prevent duplicated output of buffered data
+    st.outBuffer.flush();
+
     pid_t pid = ::fork();
     if(pid == 0) {  // child process
         if(st.isJobControl()) {
@@ -47,6 +57,12 @@ Proc Proc::fork(DSState &st, pid_t pgid, bool foreground) {
         // clear signal handler
         st.sigVector.clear();
 
+        // discard profiling result of parent
+        st.profiler.reset();
+
+        // discard read-ahead data of parent (file offset may be changed by parent)
+        st.readBuffers.clear();
+
         // clear termination hook
         st.setGlobal(st.symbolTable.getTermHookIndex(), DSValue::createInvalid());
 
@@ -66,6 +82,56 @@ Proc Proc::fork(DSState &st, pid_t pgid, bool foreground) {
     return Proc(pid);
 }
 
+Proc Proc::spawn(const char *filePath, char *const *argv) {
+    if(filePath == nullptr) {
+        errno = ENOENT;
+        return Proc(-1);
+    }
+
+    LOG_EXPR(DUMP_EXEC, [&]{
+        std::string str = "spawn: ";
+        str += filePath;
+        str += ", [";
+        for(unsigned int i = 0; argv[i] != nullptr; i++) {
+            if(i > 0) {
+                str += ", ";
+            }
+            str += argv[i];
+        }
+        str += "]";
+        return str;
+    });
+
+    // set env '_' (only spawned process)
+    std::string underscore = "_=";
+    underscore += filePath;
+    std::vector<char *> envp;
+    for(char **ptr = environ; *ptr != nullptr; ptr++) {
+        if(strncmp(*ptr, "_=", 2) != 0) {
+            envp.push_back(*ptr);
+        }
+    }
+    envp.push_back(&underscore[0]);
+    envp.push_back(nullptr);
+
+    pid_t pid = -1;
+    int ret = posix_spawn(&pid, filePath, nullptr, nullptr, argv, envp.data());
+    if(ret == ENOEXEC) {  // fallback to /bin/sh
+        unsigned int size = 0;
+        for(; argv[size]; size++);
+        size++;
+        char *newArgv[size + 1];
+        newArgv[0] = const_cast<char *>("/bin/sh");
+        memcpy(newArgv + 1, argv, sizeof(char *) * size);
+        ret = posix_spawn(&pid, newArgv[0], nullptr, nullptr, newArgv, envp.data());
+    }
+    if(ret != 0) {
+        errno = ret;
+        return Proc(-1);
+    }
+    return Proc(pid);
+}
+
 int tryToBeForeground(const DSState &st) {
     errno = 0;
     if(st.isForeground()) {
@@ -349,4 +415,146 @@ JobTable::ConstEntryIter JobTable::findEntryIter(unsigned int jobId) const {
     return this->endJob();
 }
 
-} // namespace ydsh
\ No newline at end of file
+// #######################
+// ##     JobReaper     ##
+// #######################
+
+static int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));   // always close-on-exec
+#else
+    (void) pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+JobReaper::JobReaper() {
+    // check pidfd support (pidfd_open is available since Linux 5.3)
+    int fd = openPidFd(getpid());
+    if(fd > -1) {
+        close(fd);
+        this->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+}
+
+JobReaper::~JobReaper() {
+    this->closePidFds();
+}
+
+void JobReaper::closePidFds() {
+    for(auto &e : this->entries) {
+        for(auto &fd : e.pidfds) {
+            if(fd > -1) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    if(this->epollFd > -1) {
+        close(this->epollFd);
+        this->epollFd = -1;
+    }
+}
+
+void JobReaper::add(Job job) {
+    assert(job->hasOwnership());
+    Entry entry{std::move(job), {}};
+    if(this->epollFd > -1) {
+        for(unsigned int i = 0; i < entry.job->getProcSize(); i++) {
+            int fd = -1;
+            pid_t pid = entry.job->getPid(i);
+            if(pid > 0) {
+                fd = openPidFd(pid);
+                epoll_event event{};
+                event.events = EPOLLIN;
+                event.data.fd = fd;
+                if(fd < 0 || epoll_ctl(this->epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                    // fallback to waitid
+                    if(fd > -1) {
+                        close(fd);
+                    }
+                    this->entries.push_back(std::move(entry));
+                    this->closePidFds();
+                    return;
+                }
+            }
+            entry.pidfds.push_back(fd);
+        }
+    }
+    this->entries.push_back(std::move(entry));
+}
+
+Job JobReaper::waitAny() {
+    /**
+     * block SIGCHLD before checking status of jobs.
+     * if child state is changed after checking, SIGCHLD is kept pending (even if SIG_DFL),
+     * so sigwaitinfo immediately returns
+     */
+    sigset_t set;
+    sigset_t oldSet;
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, &oldSet);
+
+    Job job;
+    while(!this->entries.empty()) {
+        unsigned int index = this->findTerminated();
+        if(index < this->size()) {
+            job = this->remove(index);
+            break;
+        }
+
+        if(this->epollFd > -1) {
+            epoll_event event{};
+            if(epoll_wait(this->epollFd, &event, 1, -1) < 0 && errno != EINTR) {
+                this->closePidFds();
+            }
+            continue;
+        }
+
+        // not reap child (reap in findTerminated). state change of other child only causes re-check
+        siginfo_t info{};
+        if(sigwaitinfo(&set, &info) < 0 && errno != EINTR) {
+            break;
+        }
+    }
+
+    int old = errno;
+    sigprocmask(SIG_SETMASK, &oldSet, nullptr);
+    errno = old;
+    return job;
+}
+
+unsigned int JobReaper::findTerminated() {
+    for(unsigned int i = 0; i < this->entries.size(); i++) {
+        auto &e = this->entries[i];
+        e.job->wait(Proc::NONBLOCKING);
+
+        // close pidfd of terminated process (pidfd of reaped process is always readable)
+        for(unsigned int j = 0; j < e.pidfds.size(); j++) {
+            if(e.pidfds[j] > -1 && e.job->getProcs()[j].state() == Proc::TERMINATED) {
+                close(e.pidfds[j]);
+                e.pidfds[j] = -1;
+            }
+        }
+        if(!e.job->available()) {
+            return i;
+        }
+    }
+    return this->size();
+}
+
+Job JobReaper::remove(unsigned int index) {
+    auto &e = this->entries[index];
+    for(auto &fd : e.pidfds) {
+        if(fd > -1) {
+            close(fd);
+        }
+    }
+    auto job = std::move(e.job);
+    this->entries.erase(this->entries.begin() + index);
+    return job;
+}
+
+} // namespace ydsh
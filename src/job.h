@@ -111,6 +111,18 @@ public:
      * @return
      */
     static Proc fork(DSState &st, pid_t pgid, bool foreground);
+
+    /**
+     * spawn external command without copying shell process (via posix_spawn).
+     * not change process group and signal setting, so only available when job control is disabled.
+     * if Proc#pid() is -1, spawn failed and set errno.
+     * @param filePath
+     * if null, not spawn and set ENOENT.
+     * @param argv
+     * not null
+     * @return
+     */
+    static Proc spawn(const char *filePath, char *const *argv);
 };
 
 class JobTable;
@@ -423,6 +435,89 @@ private:
     EntryIter detachByIter(ConstEntryIter iter);
 };
 
+/**
+ * wait for termination of any of multiple jobs without polling each job.
+ * if pidfd is supported, wait for readable pidfd of processes via epoll.
+ * otherwise, wait for SIGCHLD via sigwaitinfo and check added jobs (not reap other child)
+ */
+class JobReaper {
+private:
+    struct Entry {
+        Job job;
+
+        /**
+         * pidfd of each process. if not available, -1
+         */
+        std::vector<int> pidfds;
+    };
+
+    std::vector<Entry> entries;
+
+    /**
+     * if pidfd is not supported, -1
+     */
+    int epollFd{-1};
+
+public:
+    NON_COPYABLE(JobReaper);
+
+    JobReaper();
+
+    /**
+     * close remain pidfd. not wait remain jobs
+     */
+    ~JobReaper();
+
+    /**
+     * add job to wait list.
+     * @param job
+     * must have ownership
+     */
+    void add(Job job);
+
+    unsigned int size() const {
+        return this->entries.size();
+    }
+
+    bool empty() const {
+        return this->entries.empty();
+    }
+
+    /**
+     * block until any of added jobs is terminated.
+     * terminated job is removed from wait list.
+     * @return
+     * terminated job. if wait list is empty, return null.
+     * if waiting failed, return null and set errno (wait list is not changed)
+     */
+    Job waitAny();
+
+    /**
+     * remove oldest job from wait list without waiting (for fallback of waitAny() failure)
+     * @return
+     * wait list must not be empty
+     */
+    Job takeFirst() {
+        assert(!this->empty());
+        return this->remove(0);
+    }
+
+private:
+    /**
+     * update status of added jobs.
+     * @return
+     * index of terminated job. if not found, return size()
+     */
+    unsigned int findTerminated();
+
+    Job remove(unsigned int index);
+
+    /**
+     * close all pidfd and epoll fd (fallback to waitid)
+     */
+    void closePidFds();
+};
+
 } // namespace ydsh
 
 #endif //YDSH_JOB_H
@@ -54,7 +54,7 @@ public:
 
     Lexer() = default;
 
-    Lexer(const char *sourceName, ByteBuffer &&buf, CStrPtr &&scriptDir) :
+    Lexer(const char *sourceName, SourceBuffer &&buf, CStrPtr &&scriptDir) :
             LexerBase(sourceName, std::move(buf)), scriptDir(std::move(scriptDir)) {
         if(!this->scriptDir || *this->scriptDir == '\0') {
             this->scriptDir.reset(strdup("."));
@@ -22,6 +22,7 @@
 #include <ydsh/ydsh.h>
 #include "misc/opt.hpp"
 #include "misc/util.hpp"
+#include "misc/resource.hpp"
 
 using namespace ydsh;
 
@@ -94,6 +95,8 @@ static void showFeature(FILE *fp) {
     const char *featureNames[] = {
             "USE_LOGGING",
             "USE_SAFE_CAST",
+            "USE_THREADED_CODE",
+            "USE_OBJECT_POOL",
     };
 
     const unsigned int featureBit = DSState_featureBit();
@@ -108,11 +111,16 @@ static void showFeature(FILE *fp) {
     OP(DUMP_UAST,      "--dump-untyped-ast",  opt::OPT_ARG, "dump abstract syntax tree (before type checking)") \
     OP(DUMP_AST,       "--dump-ast",          opt::OPT_ARG, "dump abstract syntax tree (after type checking)") \
     OP(DUMP_CODE,      "--dump-code",         opt::OPT_ARG, "dump compiled code") \
+    OP(DUMP_OPT_STATS, "--dump-opt-stats",    opt::OPT_ARG, "dump statistics of byte code optimization") \
     OP(PARSE_ONLY,     "--parse-only",        opt::NO_ARG, "not evaluate, parse only") \
     OP(CHECK_ONLY,     "--check-only",        opt::NO_ARG, "not evaluate, type check only") \
     OP(COMPILE_ONLY,   "--compile-only",      opt::NO_ARG, "not evaluate, compile only") \
     OP(DISABLE_ASSERT, "--disable-assertion", opt::NO_ARG, "disable assert statement") \
+    OP(NO_PEEPHOLE,    "--disable-peephole",  opt::NO_ARG, "disable peephole optimization of byte code") \
+    OP(PARALLEL_LOAD,  "--parallel-load",     opt::NO_ARG, "read and parse sourced modules in parallel (type checking is still sequential)") \
     OP(TRACE_EXIT,     "--trace-exit",        opt::NO_ARG, "trace execution process to exit command") \
+    OP(PROFILE,        "--profile",           opt::OPT_ARG, "sample call stack and write folded stacks (for flamegraph)") \
+    OP(PROFILE_EXACT,  "--profile-exact",     opt::OPT_ARG, "count all of executed instructions and write per-opcode/function counters") \
     OP(VERSION,        "--version",           opt::NO_ARG, "show version and copyright") \
     OP(HELP,           "--help",              opt::NO_ARG, "show this help message") \
     OP(COMMAND,        "-c",                  opt::HAS_ARG, "evaluate argument") \
@@ -170,13 +178,17 @@ int main(int argc, char **argv) {
     DSExecMode mode = DS_EXEC_MODE_NORMAL;
     unsigned short option = 0;
     bool noAssert = false;
+    bool noPeephole = false;
+    DSProfileMode profileMode = DS_PROFILE_SAMPLE;
+    const char *profileTarget = nullptr;
     struct {
         const DSDumpKind kind;
         const char *path;
-    } dumpTarget[3] = {
+    } dumpTarget[4] = {
             {DS_DUMP_KIND_UAST, nullptr},
             {DS_DUMP_KIND_AST, nullptr},
             {DS_DUMP_KIND_CODE, nullptr},
+            {DS_DUMP_KIND_OPT_STATS, nullptr},
     };
 
 
@@ -191,6 +203,9 @@ int main(int argc, char **argv) {
         case DUMP_CODE:
             dumpTarget[2].path = result.arg() != nullptr ? result.arg() : "";
             break;
+        case DUMP_OPT_STATS:
+            dumpTarget[3].path = result.arg() != nullptr ? result.arg() : "";
+            break;
         case PARSE_ONLY:
             mode = DS_EXEC_MODE_PARSE_ONLY;
             break;
@@ -204,9 +219,20 @@ int main(int argc, char **argv) {
         case DISABLE_ASSERT:
             noAssert = true;
             break;
+        case NO_PEEPHOLE:
+            noPeephole = true;
+            break;
         case TRACE_EXIT:
             setFlag(option, DS_OPTION_TRACE_EXIT);
             break;
+        case PARALLEL_LOAD:
+            setFlag(option, DS_OPTION_PARALLEL_LOAD);
+            break;
+        case PROFILE:
+        case PROFILE_EXACT:
+            profileMode = result.value() == PROFILE ? DS_PROFILE_SAMPLE : DS_PROFILE_EXACT;
+            profileTarget = result.arg() != nullptr ? result.arg() : "";
+            break;
         case VERSION:
             fprintf(stdout, "%s\n", version());
             return 0;
@@ -265,6 +291,18 @@ int main(int argc, char **argv) {
     if(noAssert) {
         DSState_unsetOption(state.get(), DS_OPTION_ASSERT);
     }
+    if(noPeephole) {
+        DSState_unsetOption(state.get(), DS_OPTION_PEEPHOLE);
+    }
+    if(profileTarget != nullptr && DSState_startProfile(state.get(), profileMode, 0) != 0) {
+        fprintf(stderr, "ydsh: cannot start profiling\n");
+        profileTarget = nullptr;
+    }
+    auto profileWriter = finally([&] {
+        if(profileTarget != nullptr && DSState_stopProfile(state.get(), profileTarget) != 0) {
+            fprintf(stderr, "ydsh: cannot write profile: %s\n", profileTarget);
+        }
+    });
 
 
     // set rest argument
@@ -287,6 +325,7 @@ int main(int argc, char **argv) {
         if(isatty(STDIN_FILENO) == 0 && !forceInteractive) {  // pipe line mode
             return apply(DSState_loadAndEval, state, nullptr);
         } else {    // interactive mode
+            DSState_setOption(state.get(), DS_OPTION_MODULE_CACHE);
             if(!quiet) {
                 fprintf(stdout, "%s\n%s\n", version(), DSState_copyright());
             }
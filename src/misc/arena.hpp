@@ -0,0 +1,226 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_MISC_ARENA_HPP
+#define YDSH_MISC_ARENA_HPP
+
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "noncopyable.h"
+
+namespace ydsh {
+
+/**
+ * reference counted bump allocator.
+ *
+ * each allocated block has header (owner arena). releasing block only decrements live block count,
+ * and if live block count reaches 0, all chunks are reclaimed at once (except for last chunk).
+ * after owner is destroyed (detached), arena itself is freed when remaining blocks are released.
+ * if owner arena is null, fallback to malloc/free.
+ */
+class Arena {
+private:
+    struct Chunk {
+        Chunk *next;
+        std::size_t size;   // size of data area
+    };
+
+public:
+    /**
+     * alignment of allocated block.
+     * not use max_align_t (16 byte in x86_64) for reducing per-block overhead
+     */
+    static constexpr std::size_t ALIGNMENT = alignof(void *) > alignof(double) ? alignof(void *) : alignof(double);
+
+private:
+    struct alignas(ALIGNMENT) Header {
+        Arena *arena;
+    };
+
+    static constexpr std::size_t MIN_CHUNK_SIZE = 16 * 1024;
+    static constexpr std::size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+    Chunk *chunks{nullptr};
+    char *cur{nullptr};
+    char *end{nullptr};
+
+    /**
+     * number of live blocks
+     */
+    unsigned int liveCount{0};
+
+    /**
+     * if true, owner is already destroyed
+     */
+    bool detached{false};
+
+    Arena() = default;
+
+    ~Arena() {
+        freeChunks(this->chunks);
+    }
+
+public:
+    NON_COPYABLE(Arena);
+
+    class Owner {
+    private:
+        Arena *arena;
+
+    public:
+        Owner() : arena(new Arena()) {}
+
+        Owner(Owner &&o) noexcept : arena(o.arena) {
+            o.arena = nullptr;
+        }
+
+        ~Owner() {
+            if(this->arena) {
+                this->arena->detach();
+            }
+        }
+
+        Owner &operator=(Owner &&o) noexcept {
+            auto tmp(std::move(o));
+            std::swap(this->arena, tmp.arena);
+            return *this;
+        }
+
+        Arena &operator*() const {
+            return *this->arena;
+        }
+
+        Arena *get() const {
+            return this->arena;
+        }
+    };
+
+    unsigned int getLiveCount() const {
+        return this->liveCount;
+    }
+
+    /**
+     *
+     * @param arena
+     * may be null. if null, allocate by malloc
+     * @param size
+     * @return
+     */
+    static void *allocate(Arena *arena, std::size_t size) {
+        size = alignSize(size) + sizeof(Header);
+        void *ptr = arena != nullptr ? arena->allocateImpl(size) : malloc(size);
+        if(ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        auto *header = static_cast<Header *>(ptr);
+        header->arena = arena;
+        return header + 1;
+    }
+
+    /**
+     * release block allocated by allocate()
+     * @param ptr
+     * may be null
+     */
+    static void release(void *ptr) {
+        if(ptr == nullptr) {
+            return;
+        }
+        auto *header = static_cast<Header *>(ptr) - 1;
+        Arena *arena = header->arena;
+        if(arena == nullptr) {
+            free(header);
+        } else if(--arena->liveCount == 0) {
+            if(arena->detached) {
+                delete arena;
+            } else {
+                arena->reset();
+            }
+        }
+    }
+
+private:
+    static std::size_t alignSize(std::size_t size) {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    static void freeChunks(Chunk *chunk) {
+        while(chunk) {
+            Chunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+
+    static char *dataOf(Chunk *chunk) {
+        return reinterpret_cast<char *>(chunk) + alignSize(sizeof(Chunk));
+    }
+
+    void *allocateImpl(std::size_t size) {
+        if(static_cast<std::size_t>(this->end - this->cur) < size && !this->addChunk(size)) {
+            return nullptr;
+        }
+        void *ptr = this->cur;
+        this->cur += size;
+        this->liveCount++;
+        return ptr;
+    }
+
+    bool addChunk(std::size_t requiredSize) {
+        std::size_t size = this->chunks ? this->chunks->size * 2 : MIN_CHUNK_SIZE;
+        if(size > MAX_CHUNK_SIZE) {
+            size = MAX_CHUNK_SIZE;
+        }
+        if(size < requiredSize) {
+            size = requiredSize;
+        }
+        auto *chunk = static_cast<Chunk *>(malloc(alignSize(sizeof(Chunk)) + size));
+        if(chunk == nullptr) {
+            return false;
+        }
+        chunk->next = this->chunks;
+        chunk->size = size;
+        this->chunks = chunk;
+        this->cur = dataOf(chunk);
+        this->end = this->cur + size;
+        return true;
+    }
+
+    /**
+     * reclaim all blocks. keep last chunk for next allocation
+     */
+    void reset() {
+        if(this->chunks) {
+            freeChunks(this->chunks->next);
+            this->chunks->next = nullptr;
+            this->cur = dataOf(this->chunks);
+        }
+    }
+
+    void detach() {
+        this->detached = true;
+        if(this->liveCount == 0) {
+            delete this;
+        }
+    }
+};
+
+} // namespace ydsh
+
+#endif //YDSH_MISC_ARENA_HPP
@@ -20,6 +20,7 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <cstdlib>
@@ -30,6 +31,7 @@
 #include <cerrno>
 
 #include "fatal.h"
+#include "noncopyable.h"
 #include "resource.hpp"
 
 namespace ydsh {
@@ -143,6 +145,126 @@ inline void removeDirWithRecursively(const char *currentDir) {
     }
 }
 
+/**
+ * read-only private mapping of regular file.
+ * mapped data is always terminated with newline and null character (for sentinel of re2c lexer).
+ * extra bytes after end of file are placed in anonymous mapping (guard page),
+ * so not touch file pages beyond end of file.
+ */
+class MappedFile {
+private:
+    char *base{nullptr};
+
+    /**
+     * size of whole mapping (multiple of page size)
+     */
+    size_t mapSize{0};
+
+    /**
+     * size of data including terminating newline and null character
+     */
+    size_t dataSize{0};
+
+public:
+    /**
+     * if file is smaller than it, reading is faster than mapping
+     */
+    static constexpr size_t MIN_SIZE = 64 * 1024;
+
+    NON_COPYABLE(MappedFile);
+
+    MappedFile() = default;
+
+    MappedFile(MappedFile &&o) noexcept : base(o.base), mapSize(o.mapSize), dataSize(o.dataSize) {
+        o.base = nullptr;
+        o.mapSize = 0;
+        o.dataSize = 0;
+    }
+
+    ~MappedFile() {
+        if(this->base != nullptr) {
+            munmap(this->base, this->mapSize);
+        }
+    }
+
+    MappedFile &operator=(MappedFile &&o) noexcept {
+        auto tmp(std::move(o));
+        this->swap(tmp);
+        return *this;
+    }
+
+    void swap(MappedFile &o) noexcept {
+        std::swap(this->base, o.base);
+        std::swap(this->mapSize, o.mapSize);
+        std::swap(this->dataSize, o.dataSize);
+    }
+
+    /**
+     *
+     * @param fd
+     * @param maxSize
+     * @return
+     * if fd is not regular file, file offset is not beginning of file,
+     * or file size is out of [MIN_SIZE, maxSize], return empty object.
+     * if mapping failed, also return empty object (fallback to read).
+     * after mapping, set file offset to end of file (same as reading all data)
+     */
+    static MappedFile map(int fd, size_t maxSize) {
+        MappedFile file;
+        struct stat st; //NOLINT
+        if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            return file;
+        }
+        const auto fileSize = static_cast<size_t>(st.st_size);
+        if(fileSize < MIN_SIZE || fileSize > maxSize - 2) {
+            return file;
+        }
+        if(lseek(fd, 0, SEEK_CUR) != 0) {   // fd may be shared (ex. dup of stdin)
+            return file;
+        }
+
+        // reserve whole region (file pages + guard page) before mapping file
+        const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t mapSize = (fileSize + 2 + pageSize - 1) / pageSize * pageSize;
+        void *ptr = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ptr == MAP_FAILED) {
+            return file;
+        }
+        file.base = static_cast<char *>(ptr);
+        file.mapSize = mapSize;
+        if(mmap(ptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            return MappedFile();
+        }
+
+        // append sentinel (copy on write, not change file)
+        size_t size = fileSize;
+        if(file.base[size - 1] != '\n') {
+            file.base[size++] = '\n';
+        }
+        file.base[size++] = '\0';
+        file.dataSize = size;
+        mprotect(ptr, mapSize, PROT_READ);
+        lseek(fd, static_cast<off_t>(fileSize), SEEK_SET);
+        return file;
+    }
+
+    explicit operator bool() const {
+        return this->base != nullptr;
+    }
+
+    const char *data() const {
+        return this->base;
+    }
+
+    /**
+     * @return
+     * size of data including null character
+     */
+    size_t size() const {
+        return this->dataSize;
+    }
+};
+
 class TempFileFactory {
 protected:
     const std::string tmpDirName;
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_MISC_FLAT_MAP_HPP
+#define YDSH_MISC_FLAT_MAP_HPP
+
+#include <memory>
+#include <utility>
+
+namespace ydsh {
+
+/**
+ * open addressing (linear probing) hash map of unsigned int key.
+ * entries are stored in single flat array, so pointer to value is invalidated by insertion.
+ * UINT_MAX is reserved for empty slot.
+ * @tparam V
+ * must be default constructible
+ */
+template <typename V>
+class FlatIntMap {
+public:
+    using value_type = std::pair<unsigned int, V>;
+
+    static constexpr unsigned int EMPTY = static_cast<unsigned int>(-1);
+
+private:
+    static constexpr unsigned int INIT_CAPACITY = 8;
+
+    std::unique_ptr<value_type[]> entries;
+
+    unsigned int capacity_{0};
+
+    /**
+     * 32 - log2(capacity_). use high bits of hash value as index
+     */
+    unsigned int shift_{32};
+
+    unsigned int size_{0};
+
+public:
+    class const_iterator {
+    private:
+        const value_type *ptr;
+        const value_type *end;
+
+        friend class FlatIntMap;
+
+        const_iterator(const value_type *ptr, const value_type *end) : ptr(ptr), end(end) {
+            this->skip();
+        }
+
+        void skip() {
+            for(; this->ptr != this->end && this->ptr->first == EMPTY; ++this->ptr);
+        }
+
+    public:
+        const value_type &operator*() const {
+            return *this->ptr;
+        }
+
+        const value_type *operator->() const {
+            return this->ptr;
+        }
+
+        const_iterator &operator++() {
+            ++this->ptr;
+            this->skip();
+            return *this;
+        }
+
+        bool operator==(const const_iterator &o) const {
+            return this->ptr == o.ptr;
+        }
+
+        bool operator!=(const const_iterator &o) const {
+            return !(*this == o);
+        }
+    };
+
+    FlatIntMap() = default;
+    FlatIntMap(FlatIntMap &&) noexcept = default;
+    FlatIntMap &operator=(FlatIntMap &&) noexcept = default;
+
+    FlatIntMap(const FlatIntMap &o) : FlatIntMap() {
+        for(auto &e : o) {
+            this->insert(e.first, e.second);
+        }
+    }
+
+    ~FlatIntMap() = default;
+
+    unsigned int size() const {
+        return this->size_;
+    }
+
+    bool empty() const {
+        return this->size_ == 0;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this->entries.get(), this->entries.get() + this->capacity_);
+    }
+
+    const_iterator end() const {
+        auto *last = this->entries.get() + this->capacity_;
+        return const_iterator(last, last);
+    }
+
+    const V *find(unsigned int key) const {
+        if(this->capacity_ == 0) {
+            return nullptr;
+        }
+        const unsigned int mask = this->capacity_ - 1;
+        for(unsigned int i = this->indexOf(key); ; i = (i + 1) & mask) {
+            auto &e = this->entries[i];
+            if(e.first == key) {
+                return &e.second;
+            }
+            if(e.first == EMPTY) {
+                return nullptr;
+            }
+        }
+    }
+
+    V *find(unsigned int key) {
+        return const_cast<V *>(static_cast<const FlatIntMap *>(this)->find(key));
+    }
+
+    /**
+     *
+     * @param key
+     * must not be EMPTY
+     * @param value
+     * @return
+     * pointer to inserted value (or already inserted value) and
+     * flag indicating whether inserted.
+     */
+    std::pair<V *, bool> insert(unsigned int key, const V &value) {
+        if((this->size_ + 1) * 4 > this->capacity_ * 3) {   // load factor 0.75
+            this->rehash(this->capacity_ == 0 ? INIT_CAPACITY : this->capacity_ * 2);
+        }
+        const unsigned int mask = this->capacity_ - 1;
+        for(unsigned int i = this->indexOf(key); ; i = (i + 1) & mask) {
+            auto &e = this->entries[i];
+            if(e.first == key) {
+                return {&e.second, false};
+            }
+            if(e.first == EMPTY) {
+                e.first = key;
+                e.second = value;
+                this->size_++;
+                return {&e.second, true};
+            }
+        }
+    }
+
+    /**
+     * remove entries if pred(entry) is true
+     * @tparam Func
+     * @param pred
+     */
+    template <typename Func>
+    void removeIf(Func pred) {
+        auto old = std::move(this->entries);
+        const unsigned int oldCapacity = this->capacity_;
+        this->capacity_ = 0;
+        this->size_ = 0;
+        if(oldCapacity > 0) {
+            this->rehash(oldCapacity);
+        }
+        for(unsigned int i = 0; i < oldCapacity; i++) {
+            if(old[i].first != EMPTY && !pred(old[i])) {
+                this->insert(old[i].first, old[i].second);
+            }
+        }
+    }
+
+    void clear() {
+        this->entries.reset();
+        this->capacity_ = 0;
+        this->shift_ = 32;
+        this->size_ = 0;
+    }
+
+    /**
+     * for debugging and testing
+     * @return
+     * max number of probed slots for looking up inserted key
+     */
+    unsigned int maxProbeLength() const {
+        const unsigned int mask = this->capacity_ - 1;
+        unsigned int maxLen = 0;
+        for(unsigned int i = 0; i < this->capacity_; i++) {
+            if(this->entries[i].first != EMPTY) {
+                unsigned int len = ((i - this->indexOf(this->entries[i].first)) & mask) + 1;
+                if(len > maxLen) {
+                    maxLen = len;
+                }
+            }
+        }
+        return maxLen;
+    }
+
+private:
+    /**
+     * fibonacci hashing. keys are often multiple of small power of 2 (ex. id << 2),
+     * so use high bits of product (low bits are not mixed)
+     * @param key
+     * @return
+     */
+    unsigned int indexOf(unsigned int key) const {
+        return (key * 0x9E3779B9u) >> this->shift_;
+    }
+
+    /**
+     *
+     * @param newCapacity
+     * must be power of 2
+     */
+    void rehash(unsigned int newCapacity) {
+        auto old = std::move(this->entries);
+        const unsigned int oldCapacity = this->capacity_;
+        this->entries.reset(new value_type[newCapacity]);
+        for(unsigned int i = 0; i < newCapacity; i++) {
+            this->entries[i].first = EMPTY;
+        }
+        this->capacity_ = newCapacity;
+        this->shift_ = 32;
+        for(unsigned int c = newCapacity; c > 1; c >>= 1u) {
+            this->shift_--;
+        }
+        this->size_ = 0;
+        for(unsigned int i = 0; i < oldCapacity; i++) {
+            if(old[i].first != EMPTY) {
+                this->insert(old[i].first, old[i].second);
+            }
+        }
+    }
+};
+
+} // namespace ydsh
+
+#endif //YDSH_MISC_FLAT_MAP_HPP
@@ -18,8 +18,22 @@
 #define YDSH_MISC_GLOB_HPP
 
 #include <dirent.h>
-
+#include <fcntl.h>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "files.h"
 #include "flag_util.hpp"
@@ -178,30 +192,343 @@ inline auto createWildCardMatcher(Iter begin, Iter end, WildMatchOption option)
     return WildCardMatcher<Meta, Iter>(begin, end, option);
 }
 
-template <typename Meta, typename Iter, typename Appender>
-unsigned int globBase(const char *baseDir, Iter iter, Iter end,
-                            Appender &appender, WildMatchOption option) {
-    DIR *dir = opendir(baseDir);
-    if(!dir) {
-        return 0;
+struct DirEntry {
+    std::string name;
+
+    /**
+     * d_type of dirent (DT_DIR, DT_REG, DT_UNKNOWN ...)
+     */
+    unsigned char type;
+};
+
+using DirEntries = std::vector<DirEntry>;
+
+/**
+ * read all entries of directory except for '.' and '..'.
+ * on linux, read entries in large batches via getdents64
+ * @param dirPath
+ * @param entries
+ * @return
+ * if cannot open directory, return false
+ */
+inline bool readDirEntries(const char *dirPath, DirEntries &entries) {
+#ifdef __linux__
+    int fd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
     }
 
-    unsigned int matchCount = 0;
+    struct linux_dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    constexpr size_t BUF_SIZE = 64 * 1024;
+    std::unique_ptr<char[]> buf(new char[BUF_SIZE]);
+    while(true) {
+        long readSize = syscall(SYS_getdents64, fd, buf.get(), BUF_SIZE);
+        if(readSize <= 0) {
+            break;
+        }
+        for(long pos = 0; pos < readSize; ) {
+            auto *entry = reinterpret_cast<linux_dirent64 *>(buf.get() + pos);
+            pos += entry->d_reclen;
+            if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            entries.push_back({entry->d_name, entry->d_type});
+        }
+    }
+    close(fd);
+    return true;
+#else
+    DIR *dir = opendir(dirPath);
+    if(!dir) {
+        return false;
+    }
     for(dirent *entry; (entry = readdir(dir)); ) {
         if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
             continue;
         }
+        entries.push_back({entry->d_name, entry->d_type});
+    }
+    closedir(dir);
+    return true;
+#endif
+}
 
-        auto matcher = createWildCardMatcher<Meta>(iter, end, option);
-        const WildMatchResult ret = matcher(entry->d_name);
-        if(ret == WildMatchResult::FAILED) {
-            continue;
+/**
+ * short-lived directory entry cache.
+ * reuse directory listings during globbing of single command line.
+ * thread safe.
+ */
+class DirEntryCache {
+private:
+    std::unordered_map<std::string, std::shared_ptr<const DirEntries>> map;
+
+    std::mutex mutex;
+
+public:
+    /**
+     *
+     * @param dirPath
+     * @return
+     * if cannot open directory, return null
+     */
+    std::shared_ptr<const DirEntries> get(const std::string &dirPath) {
+        {
+            std::lock_guard<std::mutex> guard(this->mutex);
+            auto iter = this->map.find(dirPath);
+            if(iter != this->map.end()) {
+                return iter->second;
+            }
+        }
+
+        std::shared_ptr<const DirEntries> entries;
+        DirEntries tmp;
+        if(readDirEntries(dirPath.c_str(), tmp)) {
+            entries = std::make_shared<const DirEntries>(std::move(tmp));
+        }
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->map.emplace(dirPath, std::move(entries)).first->second;
+    }
+
+    bool empty() {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        return this->map.empty();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> guard(this->mutex);
+        this->map.clear();
+    }
+};
+
+template <typename Iter>
+struct GlobTask {
+    std::string baseDir;
+    Iter iter;
+};
+
+enum class GlobSegmentKind {
+    EMPTY,          // match nothing
+    LITERAL,        // not have meta characters
+    PREFIX,         // prefix*
+    SUFFIX,         // *suffix
+    PREFIX_SUFFIX,  // prefix*suffix
+    GENERAL,        // other patterns. match by WildCardMatcher
+};
+
+/**
+ * pre-compiled glob path segment (between '/')
+ * @tparam Iter
+ */
+template <typename Iter>
+class GlobSegment {
+private:
+    GlobSegmentKind kind{GlobSegmentKind::EMPTY};
+
+    /**
+     * if LITERAL, hold whole segment
+     */
+    std::string prefix;
+
+    std::string suffix;
+
+    /**
+     * indicate end of segment ('/' or end of pattern)
+     */
+    Iter next;
+
+    explicit GlobSegment(Iter next) : next(next) {}
+
+public:
+    template <typename Meta>
+    static GlobSegment compile(Iter iter, Iter end) {
+        unsigned int starCount = 0;
+        bool prevStar = false;
+        bool general = false;
+        std::string prefix;
+        std::string suffix;
+        for(; iter != end; ++iter) {
+            if(Meta::isAny(iter)) {
+                general = true;
+                prevStar = false;
+            } else if(Meta::isZeroOrMore(iter)) {
+                if(!prevStar) {
+                    starCount++;
+                }
+                prevStar = true;
+            } else if(*iter == '/') {
+                break;
+            } else {
+                (starCount == 0 ? prefix : suffix) += *iter;
+                prevStar = false;
+            }
+        }
+
+        GlobSegment segment(iter);
+        if(general || starCount > 1) {
+            segment.kind = GlobSegmentKind::GENERAL;
+        } else if(starCount == 0) {
+            segment.kind = prefix.empty() ? GlobSegmentKind::EMPTY : GlobSegmentKind::LITERAL;
+        } else if(suffix.empty()) {
+            segment.kind = GlobSegmentKind::PREFIX;
+        } else if(prefix.empty()) {
+            segment.kind = GlobSegmentKind::SUFFIX;
+        } else {
+            segment.kind = GlobSegmentKind::PREFIX_SUFFIX;
+        }
+        segment.prefix = std::move(prefix);
+        segment.suffix = std::move(suffix);
+        return segment;
+    }
+
+    GlobSegmentKind getKind() const {
+        return this->kind;
+    }
+
+    const std::string &getLiteral() const {
+        return this->prefix;
+    }
+
+    Iter getNext() const {
+        return this->next;
+    }
+
+    /**
+     * match PREFIX, SUFFIX and PREFIX_SUFFIX segment.
+     * follow WildCardMatcher's rule of file names start with '.'
+     * @param name
+     * @param option
+     * @return
+     */
+    bool match(const std::string &name, WildMatchOption option) const {
+        if(name[0] == '.' && (this->prefix.empty() || this->prefix[0] != '.')
+            && !hasFlag(option, WildMatchOption::DOTGLOB)) {
+            return false;
+        }
+        if(name.size() < this->prefix.size() + this->suffix.size()) {
+            return false;
+        }
+        switch(this->kind) {
+        case GlobSegmentKind::PREFIX_SUFFIX:
+        case GlobSegmentKind::PREFIX:
+            if(memcmp(name.data(), this->prefix.data(), this->prefix.size()) != 0) {
+                return false;
+            }
+            if(this->kind == GlobSegmentKind::PREFIX) {
+                return true;
+            }
+            // fall-through
+        case GlobSegmentKind::SUFFIX:
+            return memcmp(name.data() + name.size() - this->suffix.size(),
+                          this->suffix.data(), this->suffix.size()) == 0;
+        default:
+            return false;
         }
+    }
+};
+
+template <typename Iter>
+unsigned int consumeGlobSep(Iter &iter, Iter end) {
+    unsigned int count = 0;
+    for(; iter != end && *iter == '/'; ++iter) {
+        count++;
+    }
+    return count;
+}
 
-        std::string name = strcmp(baseDir, ".") != 0 ? baseDir : "";
-        if(!name.empty() && name.back() != '/') {
+template <typename Iter>
+void addGlobMatched(std::string &&name, bool isDir, Iter iter, Iter end,
+                    std::vector<std::string> &paths, std::vector<GlobTask<Iter>> &nextTasks) {
+    if(isDir) {
+        if(consumeGlobSep(iter, end) > 0) {
             name += '/';
         }
+        if(iter != end) {
+            nextTasks.push_back({name, iter});
+        }
+    }
+    if(iter == end) {
+        paths.push_back(std::move(name));
+    }
+}
+
+/**
+ * match entries of single directory.
+ * if current segment is literal, lookup it by stat instead of reading directory
+ * @param task
+ * @param end
+ * @param option
+ * @param cache
+ * may be null
+ * @param paths
+ * append matched paths
+ * @param nextTasks
+ * append sub-directories that need to be expanded
+ */
+template <typename Meta, typename Iter>
+void globDir(const GlobTask<Iter> &task, Iter end, WildMatchOption option, DirEntryCache *cache,
+             std::vector<std::string> &paths, std::vector<GlobTask<Iter>> &nextTasks) {
+    const char *baseDir = task.baseDir.c_str();
+    if(*baseDir == '\0') {
+        return;
+    }
+    const auto segment = GlobSegment<Iter>::template compile<Meta>(task.iter, end);
+    if(segment.getKind() == GlobSegmentKind::EMPTY) {
+        return;
+    }
+
+    std::string prefix = strcmp(baseDir, ".") != 0 ? baseDir : "";
+    if(!prefix.empty() && prefix.back() != '/') {
+        prefix += '/';
+    }
+
+    if(segment.getKind() == GlobSegmentKind::LITERAL) {
+        std::string name = prefix;
+        name += segment.getLiteral();
+        struct stat st; //NOLINT
+        if(lstat(name.c_str(), &st) != 0) {
+            return;
+        }
+        bool isDir = S_ISDIR(st.st_mode) || (S_ISLNK(st.st_mode) && S_ISDIR(getStMode(name.c_str())));
+        addGlobMatched(std::move(name), isDir, segment.getNext(), end, paths, nextTasks);
+        return;
+    }
+
+    std::shared_ptr<const DirEntries> cached;
+    DirEntries local;
+    const DirEntries *entries = &local;
+    if(cache) {
+        cached = cache->get(task.baseDir);
+        if(!cached) {
+            return;
+        }
+        entries = cached.get();
+    } else if(!readDirEntries(baseDir, local)) {
+        return;
+    }
+
+    for(auto &entry : *entries) {
+        WildMatchResult ret = WildMatchResult::MATCHED;
+        Iter next = segment.getNext();
+        if(segment.getKind() == GlobSegmentKind::GENERAL) {
+            auto matcher = createWildCardMatcher<Meta>(task.iter, end, option);
+            ret = matcher(entry.name.c_str());
+            next = matcher.getIter();
+        } else if(!segment.match(entry.name, option)) {
+            ret = WildMatchResult::FAILED;
+        }
+        if(ret == WildMatchResult::FAILED) {
+            continue;
+        }
+
+        std::string name = prefix;
+        unsigned char type = DT_UNKNOWN;
         switch(ret) {
         case WildMatchResult::DOT:
             name += ".";
@@ -210,33 +537,142 @@ unsigned int globBase(const char *baseDir, Iter iter, Iter end,
             name += "..";
             break;
         default:
-            name += entry->d_name;
+            name += entry.name;
+            type = entry.type;
             break;
         }
 
-        if(S_ISDIR(getStMode(name.c_str()))) {
-            if(matcher.consumeSep() > 0) {
-                name += '/';
-            }
-            if(!matcher.isEnd()) {
-                matchCount += globBase<Meta>(name.c_str(), matcher.getIter(), end, appender, option);
-            }
-        }
-        if(matcher.isEnd()) {
-            appender(std::move(name));
-            matchCount++;
+        // if d_type is available, avoid stat (but follow symbolic link)
+        bool isDir = type == DT_DIR;
+        if(type == DT_UNKNOWN || type == DT_LNK) {
+            isDir = S_ISDIR(getStMode(name.c_str()));
         }
+        addGlobMatched(std::move(name), isDir, next, end, paths, nextTasks);
 
         if(ret == WildMatchResult::DOT || ret == WildMatchResult::DOTDOT) {
             break;
         }
     }
-    closedir(dir);
+}
+
+/**
+ * if number of directories in same level is larger than it, expand them concurrently
+ */
+constexpr unsigned int GLOB_PARALLEL_THRESHOLD = 8;
+
+constexpr unsigned int GLOB_MAX_WORKERS = 4;
+
+/**
+ * expand tasks on small worker pool.
+ * calling thread also works as worker.
+ * Iter and Meta are used from worker threads concurrently,
+ * so Iter must refer immutable plain data (not lazily updated objects such as DSValue).
+ * @param tasks
+ * @param end
+ * @param option
+ * @param cache
+ * @param paths
+ * @param nextTasks
+ */
+template <typename Meta, typename Iter>
+void globDirsInParallel(const std::vector<GlobTask<Iter>> &tasks, Iter end, WildMatchOption option,
+                        DirEntryCache *cache, std::vector<std::string> &paths,
+                        std::vector<GlobTask<Iter>> &nextTasks) {
+    unsigned int workerSize = std::thread::hardware_concurrency();
+    if(workerSize > GLOB_MAX_WORKERS) {
+        workerSize = GLOB_MAX_WORKERS;
+    }
+    if(workerSize < 2) {
+        workerSize = 2;
+    }
+
+    struct Output {
+        std::vector<std::string> paths;
+        std::vector<GlobTask<Iter>> nextTasks;
+    };
+    std::vector<Output> outputs(workerSize);
+    std::atomic<size_t> index{0};
+
+    auto worker = [&](unsigned int id) {
+        auto &out = outputs[id];
+        for(size_t i; (i = index.fetch_add(1, std::memory_order_relaxed)) < tasks.size(); ) {
+            globDir<Meta>(tasks[i], end, option, cache, out.paths, out.nextTasks);
+        }
+    };
+
+    // block all signals in worker threads (signal handler always run on main thread)
+    sigset_t maskSet;
+    sigset_t oldSet;
+    sigfillset(&maskSet);
+    pthread_sigmask(SIG_BLOCK, &maskSet, &oldSet);
+    std::vector<std::thread> threads;
+    for(unsigned int i = 1; i < workerSize; i++) {
+        try {
+            threads.emplace_back(worker, i);
+        } catch(const std::system_error &) {
+            break;  // if cannot create thread, remaining tasks are processed by calling thread
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+
+    worker(0);
+    for(auto &thread : threads) {
+        thread.join();
+    }
+
+    for(auto &out : outputs) {
+        for(auto &path : out.paths) {
+            paths.push_back(std::move(path));
+        }
+        for(auto &task : out.nextTasks) {
+            nextTasks.push_back(std::move(task));
+        }
+    }
+}
+
+/**
+ * expand glob pattern level by level (breadth first).
+ * if same level has many directories, expand them concurrently.
+ * matched paths are passed to appender at end of each level (appender is always called from calling thread).
+ * @param baseDir
+ * @param iter
+ * @param end
+ * @param appender
+ * @param option
+ * @param cache
+ * if not null, reuse directory entries
+ * @return
+ * number of matched paths
+ */
+template <typename Meta, typename Iter, typename Appender>
+unsigned int globBase(const char *baseDir, Iter iter, Iter end,
+                            Appender &appender, WildMatchOption option, DirEntryCache *cache = nullptr) {
+    unsigned int matchCount = 0;
+    std::vector<GlobTask<Iter>> tasks;
+    tasks.push_back({baseDir, iter});
+    std::vector<GlobTask<Iter>> nextTasks;
+    std::vector<std::string> paths;
+    while(!tasks.empty()) {
+        if(tasks.size() >= GLOB_PARALLEL_THRESHOLD) {
+            globDirsInParallel<Meta>(tasks, end, option, cache, paths, nextTasks);
+        } else {
+            for(auto &task : tasks) {
+                globDir<Meta>(task, end, option, cache, paths, nextTasks);
+            }
+        }
+        for(auto &path : paths) {
+            appender(std::move(path));
+            matchCount++;
+        }
+        paths.clear();
+        tasks.clear();
+        std::swap(tasks, nextTasks);
+    }
     return matchCount;
 }
 
 template <typename Meta, typename Iter, typename Appender>
-unsigned int glob(Iter iter, Iter end, Appender &appender, WildMatchOption option) {
+unsigned int glob(Iter iter, Iter end, Appender &appender, WildMatchOption option, DirEntryCache *cache = nullptr) {
     auto begin = iter;
     auto latestSep = end;
 
@@ -265,7 +701,7 @@ unsigned int glob(Iter iter, Iter end, Appender &appender, WildMatchOption optio
             Meta::preExpand(baseDir);
         }
     }
-    return globBase<Meta>(baseDir.c_str(), iter, end, appender, option);
+    return globBase<Meta>(baseDir.c_str(), iter, end, appender, option, cache);
 }
 
 } // namespace ydsh
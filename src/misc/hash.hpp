@@ -17,6 +17,7 @@
 #ifndef YDSH_MISC_HASH_HPP
 #define YDSH_MISC_HASH_HPP
 
+#include <cstdint>
 #include <cstring>
 #include <unordered_map>
 #include <unordered_set>
@@ -41,6 +42,116 @@ struct FNVHash64 {
     }
 };
 
+/**
+ * word-at-a-time string hash based on wyhash (public domain, https://github.com/wangyi-fudan/wyhash).
+ * hash value depends on byte order, so not use it for persistent data.
+ */
+struct WyHash {
+    static constexpr uint64_t P0 = 0xa0761d6478bd642full;
+    static constexpr uint64_t P1 = 0xe7037ed1a0b428dbull;
+    static constexpr uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+    static constexpr uint64_t P3 = 0x589965cc75374cc3ull;
+
+    /**
+     * 64x64 => 128 bit multiplication. a is low 64 bit, b is high 64 bit of result
+     */
+    static void mum(uint64_t &a, uint64_t &b) {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = a;
+        r *= b;
+        a = static_cast<uint64_t>(r);
+        b = static_cast<uint64_t>(r >> 64u);
+#else
+        const uint64_t ha = a >> 32u;
+        const uint64_t hb = b >> 32u;
+        const uint64_t la = static_cast<uint32_t>(a);
+        const uint64_t lb = static_cast<uint32_t>(b);
+        const uint64_t rh = ha * hb;
+        const uint64_t rm0 = ha * lb;
+        const uint64_t rm1 = hb * la;
+        const uint64_t rl = la * lb;
+        const uint64_t t = rl + (rm0 << 32u);
+        uint64_t carry = t < rl;
+        const uint64_t lo = t + (rm1 << 32u);
+        carry += lo < t;
+        a = lo;
+        b = rh + (rm0 >> 32u) + (rm1 >> 32u) + carry;
+#endif
+    }
+
+    static uint64_t mix(uint64_t a, uint64_t b) {
+        mum(a, b);
+        return a ^ b;
+    }
+
+    static uint64_t read64(const uint8_t *ptr) {
+        uint64_t v;
+        memcpy(&v, ptr, sizeof(v));
+        return v;
+    }
+
+    static uint64_t read32(const uint8_t *ptr) {
+        uint32_t v;
+        memcpy(&v, ptr, sizeof(v));
+        return v;
+    }
+
+    /**
+     * for 1~3 bytes
+     */
+    static uint64_t read3(const uint8_t *ptr, size_t size) {
+        return (static_cast<uint64_t>(ptr[0]) << 16u) | (static_cast<uint64_t>(ptr[size >> 1u]) << 8u) | ptr[size - 1];
+    }
+
+    static uint64_t compute(const void *data, size_t size, uint64_t seed = 0) {
+        auto *ptr = static_cast<const uint8_t *>(data);
+        seed ^= mix(seed ^ P0, P1);
+        uint64_t a;
+        uint64_t b;
+        if(size <= 16) {
+            if(size >= 4) {
+                const size_t off = (size >> 3u) << 2u;
+                a = (read32(ptr) << 32u) | read32(ptr + off);
+                b = (read32(ptr + size - 4) << 32u) | read32(ptr + size - 4 - off);
+            } else if(size > 0) {
+                a = read3(ptr, size);
+                b = 0;
+            } else {
+                a = b = 0;
+            }
+        } else {
+            size_t i = size;
+            if(i > 48) {
+                uint64_t seed1 = seed;
+                uint64_t seed2 = seed;
+                do {
+                    seed = mix(read64(ptr) ^ P1, read64(ptr + 8) ^ seed);
+                    seed1 = mix(read64(ptr + 16) ^ P2, read64(ptr + 24) ^ seed1);
+                    seed2 = mix(read64(ptr + 32) ^ P3, read64(ptr + 40) ^ seed2);
+                    ptr += 48;
+                    i -= 48;
+                } while(i > 48);
+                seed ^= seed1 ^ seed2;
+            }
+            while(i > 16) {
+                seed = mix(read64(ptr) ^ P1, read64(ptr + 8) ^ seed);
+                i -= 16;
+                ptr += 16;
+            }
+            a = read64(ptr + i - 16);
+            b = read64(ptr + i - 8);
+        }
+        a ^= P1;
+        b ^= seed;
+        mum(a, b);
+        return mix(a ^ P0 ^ size, b ^ P1);
+    }
+
+    static uint64_t compute(const char *begin, const char *end) {
+        return compute(begin, end - begin);
+    }
+};
+
 struct CStringComparator {
     bool operator()(const char *x, const char *y) const {
         return strcmp(x, y) == 0;
@@ -49,11 +160,7 @@ struct CStringComparator {
 
 struct CStringHash {
     std::size_t operator()(const char *key) const {
-        uint64_t hash = FNVHash64::FNV_offset_basis;
-        while(*key != '\0') {
-            FNVHash64::update(hash, static_cast<uint8_t>(*key++));
-        }
-        return hash;
+        return WyHash::compute(key, strlen(key));
     }
 };
 
@@ -27,6 +27,7 @@
 #include "noncopyable.h"
 #include "token.hpp"
 #include "buffer.hpp"
+#include "files.h"
 #include "resource.hpp"
 #include "string_ref.hpp"
 
@@ -72,6 +73,90 @@ public:
 };
 
 
+/**
+ * source of lexer. heap allocated buffer or read-only file mapping.
+ * must be terminated with null character
+ */
+class SourceBuffer {
+private:
+    ByteBuffer buf;
+
+    /**
+     * if not empty, use it instead of buf
+     */
+    MappedFile mapped;
+
+public:
+    NON_COPYABLE(SourceBuffer);
+
+    SourceBuffer() = default;
+
+    SourceBuffer(ByteBuffer &&buf) : buf(std::move(buf)) {}    //NOLINT
+
+    SourceBuffer(MappedFile &&mapped) : mapped(std::move(mapped)) {}    //NOLINT
+
+    SourceBuffer(SourceBuffer &&) noexcept = default;
+
+    SourceBuffer &operator=(SourceBuffer &&o) noexcept {
+        this->swap(o);
+        return *this;
+    }
+
+    void swap(SourceBuffer &o) noexcept {
+        this->buf.swap(o.buf);
+        this->mapped.swap(o.mapped);
+    }
+
+    bool isMapped() const {
+        return static_cast<bool>(this->mapped);
+    }
+
+    const char *get() const {
+        return this->isMapped() ? this->mapped.data() : this->buf.get();
+    }
+
+    unsigned int size() const {
+        return this->isMapped() ? this->mapped.size() : this->buf.size();
+    }
+
+    bool empty() const {
+        return this->size() == 0;
+    }
+
+    char operator[](unsigned int index) const {
+        return this->get()[index];
+    }
+
+    /**
+     * get modifiable buffer. if mapped, copy data to heap allocated buffer and unmap.
+     * @return
+     */
+    ByteBuffer &toBuffer() {
+        if(this->isMapped()) {
+            ByteBuffer tmp;
+            tmp.append(this->mapped.data(), this->mapped.size());
+            this->buf = std::move(tmp);
+            this->mapped = MappedFile();
+        }
+        return this->buf;
+    }
+};
+
+/**
+ * if fp is large regular file and not read yet, map it. otherwise, read all remaining data
+ * @param fp
+ * @param buf
+ * @return
+ */
+inline bool readAll(const FilePtr &fp, SourceBuffer &buf) {
+    auto mapped = MappedFile::map(fileno(fp.get()), UINT32_MAX);
+    if(mapped) {
+        buf = SourceBuffer(std::move(mapped));
+        return true;
+    }
+    return readAll<ByteBuffer>(fp.get(), buf.toBuffer());
+}
+
 namespace __detail {
 
 /**
@@ -84,12 +169,20 @@ protected:
 
     std::string sourceName;
 
-    LineNumTable lineNumTable;
+    /**
+     * lazily built when line number is requested (see. getLineNumByPos)
+     */
+    mutable LineNumTable lineNumTable;
+
+    /**
+     * newline positions before it are already added to lineNumTable
+     */
+    mutable unsigned int scannedPos{0};
 
     /**
      * must be terminated with null character
      */
-    ByteBuffer buf;
+    SourceBuffer buf;
 
     /**
      * current reading pointer of buf.
@@ -140,12 +233,21 @@ public:
         this->appendToBuf(data, size, true);
     }
 
-    LexerBase(const char *sourceName, ByteBuffer &&buffer) : LexerBase(sourceName) {
+    /**
+     *
+     * @param sourceName
+     * @param buffer
+     * if mapped file, already terminated with newline and null character
+     */
+    LexerBase(const char *sourceName, SourceBuffer &&buffer) : LexerBase(sourceName) {
         this->buf = std::move(buffer);
-        if(this->buf.empty() || this->buf.back() != '\n') {
-            this->buf += '\n';
+        if(!this->buf.isMapped()) {
+            auto &b = this->buf.toBuffer();
+            if(b.empty() || b.back() != '\n') {
+                b += '\n';
+            }
+            b += '\0';
         }
-        this->buf += '\0';
         this->cursor = this->buf.get();
         this->limit = this->cursor + this->getUsedSize();
     }
@@ -158,6 +260,7 @@ public:
     void swap(LexerBase &lex) noexcept {
         std::swap(this->sourceName, lex.sourceName);
         std::swap(this->lineNumTable, lex.lineNumTable);
+        std::swap(this->scannedPos, lex.scannedPos);
         this->buf.swap(lex.buf);
         std::swap(this->cursor, lex.cursor);
         std::swap(this->limit, lex.limit);
@@ -178,10 +281,16 @@ public:
     }
 
     unsigned int getLineNumByPos(unsigned int pos) const {
+        this->scanNewline(pos);
         return this->lineNumTable.lookup(pos);
     }
 
+    /**
+     * @return
+     * line number of current reading position
+     */
     unsigned int getMaxLineNum() const {
+        this->scanNewline(this->getPos());
         return this->lineNumTable.getMaxLineNum();
     }
 
@@ -274,8 +383,11 @@ private:
         return UnicodeUtil::utf8ToCodePoint(this->buf.get() + offset, this->getUsedSize() - offset, code);
     }
 
-protected:
-    void updateNewline(unsigned int pos);
+    /**
+     * add newline positions before stopPos to lineNumTable
+     * @param stopPos
+     */
+    void scanNewline(unsigned int stopPos) const;
 };
 
 // #######################
@@ -415,14 +527,15 @@ void LexerBase<T>::appendToBuf(const char *data, unsigned int size, bool isEnd)
     const unsigned int markerPos = this->marker - this->buf.get();
     const unsigned int ctxMarkerPos = this->ctxMarker - this->buf.get();
 
-    if(!this->buf.empty()) {
-        this->buf.pop_back();   // pop null character
+    auto &b = this->buf.toBuffer();
+    if(!b.empty()) {
+        b.pop_back();   // pop null character
     }
-    this->buf.append(data, size);
-    if(isEnd && (this->buf.empty() || this->buf.back() != '\n')) {
-        this->buf += '\n';
+    b.append(data, size);
+    if(isEnd && (b.empty() || b.back() != '\n')) {
+        b += '\n';
     }
-    this->buf += '\0';
+    b += '\0';
 
     // restore position
     this->cursor = this->buf.get() + pos;
@@ -432,12 +545,22 @@ void LexerBase<T>::appendToBuf(const char *data, unsigned int size, bool isEnd)
 }
 
 template<bool T>
-void LexerBase<T>::updateNewline(unsigned int pos) {
-    const unsigned int stopPos = this->getPos();
-    for(unsigned int i = pos; i < stopPos; ++i) {
-        if(this->buf[i] == '\n') {
-            this->lineNumTable.addNewlinePos(i);
+void LexerBase<T>::scanNewline(unsigned int stopPos) const {
+    if(stopPos > this->getUsedSize()) {
+        stopPos = this->getUsedSize();
+    }
+    const char *begin = this->buf.get();
+    for(unsigned int pos = this->scannedPos; pos < stopPos;) {
+        auto *ptr = static_cast<const char *>(memchr(begin + pos, '\n', stopPos - pos));
+        if(ptr == nullptr) {
+            break;
         }
+        pos = ptr - begin;
+        this->lineNumTable.addNewlinePos(pos);
+        pos++;
+    }
+    if(stopPos > this->scannedPos) {
+        this->scannedPos = stopPos;
     }
 }
 
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_MISC_ORDERED_MAP_HPP
+#define YDSH_MISC_ORDERED_MAP_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ydsh {
+
+/**
+ * insertion-ordered open-addressing hash map.
+ *
+ * entries are stored in insertion order and indexed by linear probing table
+ * (hold entry index and cached hash). removed entry becomes tombstone, so entry index
+ * is not changed by removal. entry index may be changed only by insertion (compaction).
+ *
+ * @tparam K
+ * @tparam V
+ * @tparam Hash
+ * @tparam Eq
+ */
+template <typename K, typename V, typename Hash, typename Eq>
+class OrderedHashMap {
+public:
+    using value_type = std::pair<K, V>;
+
+private:
+    struct Entry {
+        std::size_t hash;
+        bool removed;
+        value_type kv;
+
+        Entry(std::size_t hash, K &&key, V &&value) :
+                hash(hash), removed(false), kv(std::move(key), std::move(value)) {}
+    };
+
+    enum : uint32_t {
+        EMPTY_SLOT = 0,
+    };
+
+    static constexpr unsigned int MIN_CAPACITY = 8;
+
+    /**
+     * entries (insertion order)
+     */
+    std::vector<Entry> entries;
+
+    /**
+     * open addressing table. hold entry index + 1 (0 indicates empty slot)
+     */
+    std::vector<uint32_t> slots;
+
+    /**
+     * number of live entries
+     */
+    unsigned int usedSize{0};
+
+public:
+    class const_iterator {
+    private:
+        const Entry *cur;
+        const Entry *end;
+
+    public:
+        const_iterator(const Entry *cur, const Entry *end) : cur(cur), end(end) {
+            this->skipRemoved();
+        }
+
+        const value_type &operator*() const {
+            return this->cur->kv;
+        }
+
+        const value_type *operator->() const {
+            return &this->cur->kv;
+        }
+
+        const_iterator &operator++() {
+            ++this->cur;
+            this->skipRemoved();
+            return *this;
+        }
+
+        bool operator==(const const_iterator &o) const {
+            return this->cur == o.cur;
+        }
+
+        bool operator!=(const const_iterator &o) const {
+            return !(*this == o);
+        }
+
+    private:
+        void skipRemoved() {
+            for(; this->cur != this->end && this->cur->removed; ++this->cur);
+        }
+    };
+
+    OrderedHashMap() = default;
+
+    unsigned int size() const {
+        return this->usedSize;
+    }
+
+    bool empty() const {
+        return this->size() == 0;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this->entries.data(), this->entries.data() + this->entries.size());
+    }
+
+    const_iterator end() const {
+        auto *last = this->entries.data() + this->entries.size();
+        return const_iterator(last, last);
+    }
+
+    const_iterator find(const K &key) const {
+        unsigned int index = this->findIndex(key);
+        if(index == this->endIndex()) {
+            return this->end();
+        }
+        auto *ptr = this->entries.data();
+        return const_iterator(ptr + index, ptr + this->entries.size());
+    }
+
+    void clear() {
+        this->entries.clear();
+        this->slots.clear();
+        this->usedSize = 0;
+    }
+
+    // index based api
+
+    /**
+     * @return
+     * end of entry index (including removed entries)
+     */
+    unsigned int endIndex() const {
+        return this->entries.size();
+    }
+
+    /**
+     *
+     * @param index
+     * @return
+     * first live entry index (>= index). if not found, return endIndex()
+     */
+    unsigned int nextIndex(unsigned int index) const {
+        for(; index < this->endIndex() && this->entries[index].removed; index++);
+        return index;
+    }
+
+    value_type &at(unsigned int index) {
+        return this->entries[index].kv;
+    }
+
+    const value_type &at(unsigned int index) const {
+        return this->entries[index].kv;
+    }
+
+    /**
+     *
+     * @param key
+     * @return
+     * if not found, return endIndex()
+     */
+    unsigned int findIndex(const K &key) const {
+        if(this->slots.empty()) {
+            return this->endIndex();
+        }
+        const std::size_t hash = Hash()(key);
+        const unsigned int mask = this->slots.size() - 1;
+        for(unsigned int i = hash & mask; ; i = (i + 1) & mask) {
+            uint32_t slot = this->slots[i];
+            if(slot == EMPTY_SLOT) {
+                return this->endIndex();
+            }
+            auto &e = this->entries[slot - 1];
+            if(e.hash == hash && Eq()(e.kv.first, key)) {
+                return slot - 1;
+            }
+        }
+    }
+
+    /**
+     * if key is not found, insert key and value.
+     * @param key
+     * @param value
+     * if key is already found, not moved
+     * @return
+     * entry index of key and whether inserted or not
+     */
+    std::pair<unsigned int, bool> insert(K &&key, V &&value) {
+        unsigned int index = this->findIndex(key);
+        if(index != this->endIndex()) {
+            return {index, false};
+        }
+
+        this->reserveForInsert();
+        const std::size_t hash = Hash()(key);
+        index = this->entries.size();
+        this->entries.emplace_back(hash, std::move(key), std::move(value));
+        this->insertSlot(hash, index);
+        this->usedSize++;
+        return {index, true};
+    }
+
+    /**
+     * remove entry. after removal, entry index of other entries is not changed.
+     * @param index
+     * must be live entry
+     * @return
+     * next live entry index
+     */
+    unsigned int erase(unsigned int index) {
+        auto &e = this->entries[index];
+        const unsigned int mask = this->slots.size() - 1;
+        unsigned int pos = e.hash & mask;
+        for(; this->slots[pos] != index + 1; pos = (pos + 1) & mask);
+
+        // backward shift deletion
+        for(unsigned int next = (pos + 1) & mask; ; next = (next + 1) & mask) {
+            uint32_t slot = this->slots[next];
+            if(slot == EMPTY_SLOT) {
+                break;
+            }
+            unsigned int home = this->entries[slot - 1].hash & mask;
+            if(((next - home) & mask) >= ((next - pos) & mask)) {    // can move to pos
+                this->slots[pos] = slot;
+                pos = next;
+            }
+        }
+        this->slots[pos] = EMPTY_SLOT;
+
+        e.removed = true;
+        e.kv = value_type();    // release key and value
+        this->usedSize--;
+        if(this->usedSize == 0) {
+            this->clear();
+            return 0;
+        }
+        return this->nextIndex(index + 1);
+    }
+
+private:
+    void insertSlot(std::size_t hash, unsigned int index) {
+        const unsigned int mask = this->slots.size() - 1;
+        unsigned int i = hash & mask;
+        for(; this->slots[i] != EMPTY_SLOT; i = (i + 1) & mask);
+        this->slots[i] = index + 1;
+    }
+
+    /**
+     * grow slots (load factor <= 0.75) or compact removed entries
+     */
+    void reserveForInsert() {
+        unsigned int cap = this->slots.size();
+        const unsigned int removedSize = this->entries.size() - this->usedSize;
+        if((this->usedSize + 1) * 4 <= cap * 3 && (removedSize <= MIN_CAPACITY || removedSize <= this->usedSize)) {
+            return;
+        }
+        if(cap == 0) {
+            cap = MIN_CAPACITY;
+        }
+        while((this->usedSize + 1) * 4 > cap * 3) {
+            cap *= 2;
+        }
+        this->rehash(cap);
+    }
+
+    void rehash(unsigned int cap) {
+        // compact entries
+        if(this->usedSize != this->entries.size()) {
+            unsigned int dest = 0;
+            for(unsigned int i = 0; i < this->entries.size(); i++) {
+                if(!this->entries[i].removed) {
+                    if(dest != i) {
+                        this->entries[dest] = std::move(this->entries[i]);
+                    }
+                    dest++;
+                }
+            }
+            this->entries.erase(this->entries.begin() + dest, this->entries.end());
+        }
+
+        this->slots.assign(cap, EMPTY_SLOT);
+        for(unsigned int i = 0; i < this->entries.size(); i++) {
+            this->insertSlot(this->entries[i].hash, i);
+        }
+    }
+};
+
+} // namespace ydsh
+
+#endif //YDSH_MISC_ORDERED_MAP_HPP
@@ -0,0 +1,1135 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <cinttypes>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "module_cache.h"
+#include "node.h"
+#include "core.h"
+#include "logger.h"
+#include "misc/files.h"
+#include "misc/hash.hpp"
+
+namespace ydsh {
+
+/**
+ * file layout (all integers are big endian)
+ *
+ * header:  magic, revision, version, opcode size, opcode hash, assertion, peephole,
+ *          builtin var count, full path, file stamp
+ * types:   type table. referred by old type id
+ * symbols: global variables and user-defined commands of module (ordered by index)
+ * aliases: type aliases defined in module
+ * module:  max var num, nothing, global variable base index, module code
+ */
+static constexpr const char MODULE_CACHE_MAGIC[] = "YDSHMOD";
+static constexpr unsigned int MODULE_CACHE_REVISION = 3;
+
+enum class TypeDescTag : unsigned char {
+    BUILTIN,
+    REIFIED,
+    TUPLE,
+    FUNC,
+};
+
+enum class ValueTag : unsigned char {
+    INT,
+    FLOAT,
+    BOOL,
+    SIG,
+    NUMBER,
+    INVALID,
+    STR,
+    REGEX,
+    MAP,
+    FUNC,
+};
+
+enum class SymbolTag : unsigned char {
+    VAR,
+    UDC,
+};
+
+struct FileStamp {
+    uint64_t sec;
+    uint64_t nsec;
+    uint64_t size;
+
+    explicit FileStamp(const struct stat &st) :
+            sec(st.st_mtime),
+#ifdef __APPLE__
+            nsec(st.st_mtimespec.tv_nsec),
+#else
+            nsec(st.st_mtim.tv_nsec),
+#endif
+            size(st.st_size) {}
+
+    FileStamp() : sec(0), nsec(0), size(0) {}
+
+    bool operator==(const FileStamp &o) const {
+        return this->sec == o.sec && this->nsec == o.nsec && this->size == o.size;
+    }
+};
+
+/**
+ * hash of opcode names and byte sizes.
+ * version string is not changed between development builds, so detect change of instruction set
+ */
+static uint64_t computeOpcodeHash() {
+    const char *names[] = {
+#define GEN_NAME(CODE, N, S) #CODE,
+            OPCODE_LIST(GEN_NAME)
+#undef GEN_NAME
+    };
+    uint64_t hash = FNVHash64::FNV_offset_basis;
+    for(unsigned int i = 0; i < OPCODE_SIZE; i++) {
+        for(const char *ptr = names[i]; *ptr; ptr++) {
+            FNVHash64::update(hash, *ptr);
+        }
+        FNVHash64::update(hash, static_cast<uint8_t>(getByteSize(static_cast<OpCode>(i))));
+    }
+    return hash;
+}
+
+/**
+ * call func(op, operand index) for each instruction
+ */
+template <typename Func>
+static bool walkCode(const unsigned char *code, unsigned int size, Func func) {
+    for(unsigned int i = 0; i < size; i++) {
+        auto op = static_cast<OpCode>(code[i]);
+        if(static_cast<unsigned int>(op) >= OPCODE_SIZE) {
+            return false;
+        }
+        int byteSize = getByteSize(op);
+        if(byteSize < 0) {
+            if(i + 1 >= size) {
+                return false;
+            }
+            byteSize = -1 * byteSize + 2 * code[i + 1];
+        }
+        if(i + byteSize >= size) {
+            return false;
+        }
+        if(!func(op, i + 1)) {
+            return false;
+        }
+        i += byteSize;
+    }
+    return true;
+}
+
+// ###############################
+// ##     ModuleCacheWriter     ##
+// ###############################
+
+class ModuleCacheWriter {
+private:
+    const TypePool &pool;
+    const unsigned int builtinVarCount;
+    const unsigned int gvarBase;
+    const unsigned int gvarEnd;
+
+    std::string typeBuf;
+    unsigned int typeCount{0};
+    std::unordered_set<unsigned int> typeIDs;
+
+    std::string buf;
+
+public:
+    ModuleCacheWriter(const TypePool &pool, unsigned int builtinVarCount, unsigned int gvarBase, unsigned int gvarEnd) :
+            pool(pool), builtinVarCount(builtinVarCount), gvarBase(gvarBase), gvarEnd(gvarEnd) {}
+
+    void write8(std::string &out, unsigned char v) {
+        out += static_cast<char>(v);
+    }
+
+    void write16(std::string &out, unsigned short v) {
+        this->write8(out, v >> 8u);
+        this->write8(out, v);
+    }
+
+    void write32(std::string &out, unsigned int v) {
+        this->write16(out, v >> 16u);
+        this->write16(out, v);
+    }
+
+    void write64(std::string &out, uint64_t v) {
+        this->write32(out, v >> 32u);
+        this->write32(out, v);
+    }
+
+    void writeStr(std::string &out, StringRef ref) {
+        this->write32(out, ref.size());
+        out.append(ref.data(), ref.size());
+    }
+
+    void write8(unsigned char v) {
+        this->write8(this->buf, v);
+    }
+
+    void write16(unsigned short v) {
+        this->write16(this->buf, v);
+    }
+
+    void write32(unsigned int v) {
+        this->write32(this->buf, v);
+    }
+
+    void write64(uint64_t v) {
+        this->write64(this->buf, v);
+    }
+
+    void writeStr(StringRef ref) {
+        this->writeStr(this->buf, ref);
+    }
+
+    /**
+     * register type to type table and write type id
+     * @param type
+     * @return
+     * if type is not serializable (module type), return false
+     */
+    bool writeType(const DSType &type) {
+        if(!this->addType(type)) {
+            return false;
+        }
+        this->write32(type.getTypeID());
+        return true;
+    }
+
+    bool writeCode(const CompiledCode &code);
+
+    /**
+     * concat type table and other data
+     */
+    std::string take(std::string &&header) {
+        this->write32(header, this->typeCount);
+        header += this->typeBuf;
+        header += this->buf;
+        return std::move(header);
+    }
+
+private:
+    bool addType(const DSType &type);
+
+    bool writeValue(const DSValue &value);
+};
+
+bool ModuleCacheWriter::addType(const DSType &type) {
+    if(this->typeIDs.find(type.getTypeID()) != this->typeIDs.end()) {
+        return true;
+    }
+
+    if(type.isModType()) {
+        return false;
+    }
+
+    std::string entry;
+    this->write32(entry, type.getTypeID());
+    if(type.isFuncType()) {
+        auto &funcType = static_cast<const FunctionType &>(type);
+        if(!this->addType(*funcType.getReturnType())) {
+            return false;
+        }
+        for(auto &e : funcType.getParamTypes()) {
+            if(!this->addType(*e)) {
+                return false;
+            }
+        }
+        this->write8(entry, static_cast<unsigned char>(TypeDescTag::FUNC));
+        this->write32(entry, funcType.getReturnType()->getTypeID());
+        this->write32(entry, funcType.getParamTypes().size());
+        for(auto &e : funcType.getParamTypes()) {
+            this->write32(entry, e->getTypeID());
+        }
+    } else if(type.isReifiedType()) {
+        auto &reified = static_cast<const ReifiedType &>(type);
+        for(auto &e : reified.getElementTypes()) {
+            if(!this->addType(*e)) {
+                return false;
+            }
+        }
+        if(this->pool.isTupleType(type)) {
+            this->write8(entry, static_cast<unsigned char>(TypeDescTag::TUPLE));
+        } else {
+            const TypeTemplate *t = nullptr;
+            if(type.isOptionType()) {
+                t = &this->pool.getOptionTemplate();
+            } else if(this->pool.isArrayType(type)) {
+                t = &this->pool.getArrayTemplate();
+            } else if(this->pool.isMapType(type)) {
+                t = &this->pool.getMapTemplate();
+            } else {
+                return false;
+            }
+            this->write8(entry, static_cast<unsigned char>(TypeDescTag::REIFIED));
+            this->writeStr(entry, t->getName());
+        }
+        this->write32(entry, reified.getElementTypes().size());
+        for(auto &e : reified.getElementTypes()) {
+            this->write32(entry, e->getTypeID());
+        }
+    } else {
+        this->write8(entry, static_cast<unsigned char>(TypeDescTag::BUILTIN));
+        this->writeStr(entry, this->pool.getTypeName(type));
+    }
+
+    this->typeIDs.insert(type.getTypeID());
+    this->typeCount++;
+    this->typeBuf += entry;
+    return true;
+}
+
+bool ModuleCacheWriter::writeCode(const CompiledCode &code) {
+    // check global variable index and type operand
+    bool s = walkCode(code.getCode(), code.getCodeSize(), [&](OpCode op, unsigned int index) {
+        if(op == OpCode::LOAD_GLOBAL || op == OpCode::STORE_GLOBAL) {
+            unsigned int v = read16(code.getCode(), index);
+            return v < this->builtinVarCount || (v >= this->gvarBase && v < this->gvarEnd);
+        }
+        if(isTypeOp(op)) {
+            return this->addType(*this->pool.get(read24(code.getCode(), index)));
+        }
+        return true;
+    });
+    if(!s) {
+        return false;
+    }
+
+    this->write8(static_cast<unsigned char>(code.getKind()));
+    this->write8(code.getLocalVarNum());
+    this->write16(code.getStackDepth());
+    this->write32(code.getCodeSize());
+    this->buf.append(reinterpret_cast<const char *>(code.getCode()), code.getCodeSize());
+
+    // constant pool
+    unsigned int constSize;
+    for(constSize = 0; code.getConstPool()[constSize]; constSize++);
+    this->write32(constSize);
+    for(unsigned int i = 0; i < constSize; i++) {
+        if(!this->writeValue(code.getConstPool()[i])) {
+            return false;
+        }
+    }
+
+    // line number table
+    unsigned int lineSize;
+    for(lineSize = 0; code.getLineNumEntries()[lineSize]; lineSize++);
+    this->write32(lineSize);
+    for(unsigned int i = 0; i < lineSize; i++) {
+        this->write32(code.getLineNumEntries()[i].address);
+        this->write32(code.getLineNumEntries()[i].lineNum);
+    }
+
+    // exception table
+    unsigned int exceptSize;
+    for(exceptSize = 0; code.getExceptionEntries()[exceptSize].type != nullptr; exceptSize++);
+    this->write32(exceptSize);
+    for(unsigned int i = 0; i < exceptSize; i++) {
+        auto &e = code.getExceptionEntries()[i];
+        if(!this->writeType(*e.type)) {
+            return false;
+        }
+        this->write32(e.begin);
+        this->write32(e.end);
+        this->write32(e.dest);
+        this->write16(e.localOffset);
+        this->write16(e.localSize);
+    }
+    return true;
+}
+
+bool ModuleCacheWriter::writeValue(const DSValue &value) {
+    switch(value.kind()) {
+    case DSValueKind::INT:
+        this->write8(static_cast<unsigned char>(ValueTag::INT));
+        this->write64(static_cast<uint64_t>(value.asInt()));
+        return true;
+    case DSValueKind::FLOAT: {
+        union {
+            double d;
+            uint64_t u;
+        } wrap;
+        wrap.d = value.asFloat();
+        this->write8(static_cast<unsigned char>(ValueTag::FLOAT));
+        this->write64(wrap.u);
+        return true;
+    }
+    case DSValueKind::BOOL:
+        this->write8(static_cast<unsigned char>(ValueTag::BOOL));
+        this->write8(value.asBool() ? 1 : 0);
+        return true;
+    case DSValueKind::SIG:
+        this->write8(static_cast<unsigned char>(ValueTag::SIG));
+        this->write32(static_cast<unsigned int>(value.asSig()));
+        return true;
+    case DSValueKind::NUMBER:
+        this->write8(static_cast<unsigned char>(ValueTag::NUMBER));
+        this->write32(value.asNum());
+        return true;
+    case DSValueKind::INVALID:
+        this->write8(static_cast<unsigned char>(ValueTag::INVALID));
+        return true;
+    default:
+        break;
+    }
+
+    if(value.hasStrRef()) {
+        this->write8(static_cast<unsigned char>(ValueTag::STR));
+        this->writeStr(value.asStrRef());
+        return true;
+    }
+    if(!value.isObject()) {
+        return false;
+    }
+
+    switch(value.get()->getKind()) {
+    case DSObject::Regex: {
+        auto &re = typeAs<RegexObject>(value);
+        this->write8(static_cast<unsigned char>(ValueTag::REGEX));
+        this->writeStr(re.getStr());
+        this->write32(re.getFlag());
+        return true;
+    }
+    case DSObject::Map: {
+        auto &map = typeAs<MapObject>(value);
+        this->write8(static_cast<unsigned char>(ValueTag::MAP));
+        if(!this->writeType(*this->pool.get(value.getTypeID()))) {
+            return false;
+        }
+        this->write32(map.getValueMap().size());
+        for(auto &e : map.getValueMap()) {
+            if(!this->writeValue(e.first) || !this->writeValue(e.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case DSObject::Func: {
+        auto &func = typeAs<FuncObject>(value);
+        this->write8(static_cast<unsigned char>(ValueTag::FUNC));
+        return this->writeType(*this->pool.get(value.getTypeID())) && this->writeCode(func.getCode());
+    }
+    default:
+        return false;
+    }
+}
+
+// ###############################
+// ##     ModuleCacheReader     ##
+// ###############################
+
+class ModuleCacheReader {
+private:
+    SymbolTable &symbolTable;
+    const char *ptr;
+    const char *end;
+    bool ok{true};
+
+    /**
+     * old type id => current type
+     */
+    std::unordered_map<unsigned int, DSType *> typeMap;
+
+    unsigned int builtinVarCount{0};
+    unsigned int oldGvarBase{0};
+    unsigned int newGvarBase{0};
+
+    /**
+     * number of global variables defined in module
+     */
+    unsigned int gvarSize{0};
+
+public:
+    ModuleCacheReader(SymbolTable &symbolTable, const ByteBuffer &buf) :
+            symbolTable(symbolTable), ptr(buf.begin()), end(buf.end()) {}
+
+    explicit operator bool() const {
+        return this->ok;
+    }
+
+    uint64_t readN(unsigned int n) {
+        if(static_cast<size_t>(this->end - this->ptr) < n) {
+            this->ok = false;
+            return 0;
+        }
+        uint64_t v = 0;
+        for(unsigned int i = 0; i < n; i++) {
+            v = (v << 8u) | static_cast<unsigned char>(*(this->ptr++));
+        }
+        return v;
+    }
+
+    unsigned char read8() {
+        return this->readN(1);
+    }
+
+    unsigned short read16() {
+        return this->readN(2);
+    }
+
+    unsigned int read32() {
+        return this->readN(4);
+    }
+
+    uint64_t read64() {
+        return this->readN(8);
+    }
+
+    std::string readStr() {
+        unsigned int size = this->read32();
+        if(!this->ok || static_cast<size_t>(this->end - this->ptr) < size) {
+            this->ok = false;
+            return "";
+        }
+        std::string str(this->ptr, size);
+        this->ptr += size;
+        return str;
+    }
+
+    /**
+     *
+     * @return
+     * if not found, return null
+     */
+    DSType *readType() {
+        unsigned int id = this->read32();
+        auto iter = this->typeMap.find(id);
+        if(!this->ok || iter == this->typeMap.end()) {
+            this->ok = false;
+            return nullptr;
+        }
+        return iter->second;
+    }
+
+    bool readHeader(const char *fullPath, const FileStamp &stamp, bool assertion, bool peephole);
+
+    bool readTypeTable();
+
+    void setGvarBase(unsigned int oldBase, unsigned int newBase, unsigned int size) {
+        this->oldGvarBase = oldBase;
+        this->newGvarBase = newBase;
+        this->gvarSize = size;
+    }
+
+    /**
+     *
+     * @param name
+     * may be null
+     * @return
+     * if broken, return invalid code
+     */
+    CompiledCode readCode(const char *name);
+
+private:
+    DSValue readValue();
+};
+
+bool ModuleCacheReader::readHeader(const char *fullPath, const FileStamp &stamp, bool assertion, bool peephole) {
+    if(static_cast<size_t>(this->end - this->ptr) < sizeof(MODULE_CACHE_MAGIC) ||
+        memcmp(this->ptr, MODULE_CACHE_MAGIC, sizeof(MODULE_CACHE_MAGIC)) != 0) {
+        return false;
+    }
+    this->ptr += sizeof(MODULE_CACHE_MAGIC);
+    if(this->read32() != MODULE_CACHE_REVISION) {
+        return false;
+    }
+    if(this->readStr() != X_INFO_VERSION) {
+        return false;
+    }
+    if(this->read32() != OPCODE_SIZE || this->read64() != computeOpcodeHash()) {
+        return false;
+    }
+    if((this->read8() != 0) != assertion) {
+        return false;
+    }
+    if((this->read8() != 0) != peephole) {
+        return false;
+    }
+    this->builtinVarCount = this->read32();
+    if(this->builtinVarCount != this->symbolTable.getBuiltinVarCount()) {
+        return false;
+    }
+    if(this->readStr() != fullPath) {
+        return false;
+    }
+    FileStamp old;
+    old.sec = this->read64();
+    old.nsec = this->read64();
+    old.size = this->read64();
+    return this->ok && old == stamp;
+}
+
+bool ModuleCacheReader::readTypeTable() {
+    unsigned int size = this->read32();
+    for(unsigned int i = 0; i < size && this->ok; i++) {
+        unsigned int id = this->read32();
+        DSType *type = nullptr;
+        auto tag = static_cast<TypeDescTag>(this->read8());
+        switch(tag) {
+        case TypeDescTag::BUILTIN: {
+            auto ret = this->symbolTable.getType(this->readStr());
+            if(ret) {
+                type = ret.take();
+            }
+            break;
+        }
+        case TypeDescTag::REIFIED:
+        case TypeDescTag::TUPLE: {
+            bool tuple = tag == TypeDescTag::TUPLE;
+            const TypeTemplate *t = nullptr;
+            if(!tuple) {
+                auto ret = this->symbolTable.getTypeTemplate(this->readStr());
+                if(!ret) {
+                    return false;
+                }
+                t = ret.take();
+            }
+            unsigned int elementSize = this->read32();
+            std::vector<DSType *> elementTypes;
+            for(unsigned int index = 0; index < elementSize && this->ok; index++) {
+                elementTypes.push_back(this->readType());
+            }
+            if(!this->ok) {
+                return false;
+            }
+            auto ret = tuple ? this->symbolTable.createTupleType(std::move(elementTypes)) :
+                    this->symbolTable.createReifiedType(*t, std::move(elementTypes));
+            if(ret) {
+                type = ret.take();
+            }
+            break;
+        }
+        case TypeDescTag::FUNC: {
+            DSType *returnType = this->readType();
+            unsigned int paramSize = this->read32();
+            std::vector<DSType *> paramTypes;
+            for(unsigned int index = 0; index < paramSize && this->ok; index++) {
+                paramTypes.push_back(this->readType());
+            }
+            if(!this->ok) {
+                return false;
+            }
+            auto ret = this->symbolTable.createFuncType(returnType, std::move(paramTypes));
+            if(ret) {
+                type = ret.take();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        if(type == nullptr) {
+            return false;
+        }
+        this->typeMap[id] = type;
+    }
+    return this->ok;
+}
+
+CompiledCode ModuleCacheReader::readCode(const char *name) {
+    DSCode code{};
+    code.codeKind = static_cast<CodeKind>(this->read8());
+    code.localVarNum = this->read8();
+    code.stackDepth = this->read16();
+    code.size = this->read32();
+    if(!this->ok || code.size == 0 || static_cast<size_t>(this->end - this->ptr) < code.size ||
+        static_cast<unsigned int>(code.codeKind) > static_cast<unsigned int>(CodeKind::USER_DEFINED_CMD)) {
+        this->ok = false;
+        return CompiledCode();
+    }
+    code.code = static_cast<unsigned char *>(malloc(sizeof(unsigned char) * code.size));
+    memcpy(code.code, this->ptr, code.size);
+    this->ptr += code.size;
+
+    // relocate global variable index and type id
+    bool s = walkCode(code.code, code.size, [&](OpCode op, unsigned int index) {
+        if(op == OpCode::LOAD_GLOBAL || op == OpCode::STORE_GLOBAL) {
+            unsigned int v = ydsh::read16(code.code, index);
+            if(v >= this->builtinVarCount) {
+                if(v < this->oldGvarBase || v - this->oldGvarBase >= this->gvarSize) {
+                    return false;
+                }
+                v = v - this->oldGvarBase + this->newGvarBase;
+                if(v > UINT16_MAX) {
+                    return false;
+                }
+                write16(code.code + index, v);
+            }
+        } else if(isTypeOp(op)) {
+            auto iter = this->typeMap.find(read24(code.code, index));
+            if(iter == this->typeMap.end()) {
+                return false;
+            }
+            write24(code.code + index, iter->second->getTypeID());
+        }
+        return true;
+    });
+
+    // constant pool
+    unsigned int constSize = s ? this->read32() : 0;
+    if(constSize > static_cast<size_t>(this->end - this->ptr)) {
+        this->ok = false;
+        constSize = 0;
+    }
+    auto *constPool = new DSValue[constSize + 1];
+    for(unsigned int i = 0; i < constSize && this->ok; i++) {
+        constPool[i] = this->readValue();
+    }
+    constPool[constSize] = nullptr;
+
+    // line number table
+    unsigned int lineSize = s ? this->read32() : 0;
+    if(lineSize > static_cast<size_t>(this->end - this->ptr)) {
+        this->ok = false;
+        lineSize = 0;
+    }
+    auto *entries = static_cast<LineNumEntry *>(malloc(sizeof(LineNumEntry) * (lineSize + 1)));
+    for(unsigned int i = 0; i < lineSize; i++) {
+        entries[i].address = this->read32();
+        entries[i].lineNum = this->read32();
+    }
+    entries[lineSize] = {CODE_MAX_LEN, 0};
+
+    // exception table
+    unsigned int exceptSize = s ? this->read32() : 0;
+    if(exceptSize > static_cast<size_t>(this->end - this->ptr)) {
+        this->ok = false;
+        exceptSize = 0;
+    }
+    auto *except = new ExceptionEntry[exceptSize + 1];
+    for(unsigned int i = 0; i < exceptSize; i++) {
+        except[i].type = this->readType();
+        except[i].begin = this->read32();
+        except[i].end = this->read32();
+        except[i].dest = this->read32();
+        except[i].localOffset = this->read16();
+        except[i].localSize = this->read16();
+        if(except[i].type == nullptr) {
+            this->ok = false;
+            exceptSize = i;
+            break;
+        }
+    }
+    except[exceptSize] = {
+            .type = nullptr,
+            .begin = 0,
+            .end = 0,
+            .dest = 0,
+            .localOffset = 0,
+            .localSize = 0,
+    };  // sentinel
+
+    if(!s) {
+        this->ok = false;
+    }
+    CompiledCode ret(name, code, constPool, entries, except);
+    if(!this->ok) {
+        return CompiledCode();
+    }
+    return ret;
+}
+
+DSValue ModuleCacheReader::readValue() {
+    switch(static_cast<ValueTag>(this->read8())) {
+    case ValueTag::INT:
+        return DSValue::createInt(static_cast<int64_t>(this->read64()));
+    case ValueTag::FLOAT: {
+        union {
+            double d;
+            uint64_t u;
+        } wrap;
+        wrap.u = this->read64();
+        return DSValue::createFloat(wrap.d);
+    }
+    case ValueTag::BOOL:
+        return DSValue::createBool(this->read8() != 0);
+    case ValueTag::SIG:
+        return DSValue::createSig(static_cast<int>(this->read32()));
+    case ValueTag::NUMBER:
+        return DSValue::createNum(this->read32());
+    case ValueTag::INVALID:
+        return DSValue::createInvalid();
+    case ValueTag::STR:
+        return DSValue::createStr(this->readStr());
+    case ValueTag::REGEX: {
+        std::string str = this->readStr();
+        int flag = static_cast<int>(this->read32());
+        const char *errorStr;
+        auto re = compileRegex(str.c_str(), errorStr, flag);
+        if(!this->ok || !re) {
+            break;
+        }
+        return DSValue::create<RegexObject>(std::move(str), std::move(re));
+    }
+    case ValueTag::MAP: {
+        auto *type = this->readType();
+        unsigned int size = this->read32();
+        if(type == nullptr) {
+            break;
+        }
+        auto value = DSValue::create<MapObject>(*type);
+        auto &map = typeAs<MapObject>(value);
+        for(unsigned int i = 0; i < size && this->ok; i++) {
+            auto key = this->readValue();
+            map.set(std::move(key), this->readValue());
+        }
+        return value;
+    }
+    case ValueTag::FUNC: {
+        auto *type = this->readType();
+        if(type == nullptr) {
+            break;
+        }
+        auto code = this->readCode(nullptr);
+        if(!code) {
+            break;
+        }
+        return DSValue::create<FuncObject>(*type, std::move(code));
+    }
+    default:
+        break;
+    }
+    this->ok = false;
+    return DSValue::createInvalid();
+}
+
+// #########################
+// ##     ModuleCache     ##
+// #########################
+
+ModuleCache::ModuleCache(bool assertion, bool peephole) : assertion(assertion), peephole(peephole) {
+    const char *dir = getenv(ENV_MOD_CACHE_DIR);
+    this->cacheDir = dir != nullptr && *dir != '\0' ? dir : LOCAL_MOD_CACHE_DIR;
+    expandTilde(this->cacheDir);
+}
+
+std::string ModuleCache::getCachePath(const std::string &fullPath) const {
+    char name[32];
+    snprintf(name, arraySize(name), "%016" PRIx64 ".dsc",
+             FNVHash64::compute(fullPath.c_str(), fullPath.c_str() + fullPath.size()));
+    std::string path = this->cacheDir;
+    path += "/";
+    path += name;
+    return path;
+}
+
+struct CachedSymbol {
+    SymbolTag tag;
+    std::string name;
+    DSType *type;
+    FieldAttribute attr;
+};
+
+/**
+ * check whether symbol can be defined in new module without modifying symbol table
+ * @param symbolTable
+ * @param tag
+ * @param name
+ * @return
+ */
+static bool isDefinable(const SymbolTable &symbolTable, SymbolTag tag, const std::string &name) {
+    unsigned int id = symbolTable.getSymbolPool().lookup(name.c_str());
+    if(id == SymbolPool::NOT_FOUND) {  // not interned symbol is not defined
+        return true;
+    }
+    auto &handleMap = symbolTable.rootGlobalScope().getHandleMap();
+    if(tag == SymbolTag::UDC) {  // user-defined commands are defined in root module (also check blacklist)
+        return handleMap.find(SymbolKey(SymbolKind::UDC, id).raw()) == nullptr;
+    }
+    auto *handle = handleMap.find(SymbolKey(SymbolKind::VAR, id).raw());
+    return handle == nullptr || !*handle || !hasFlag(handle->attr(), FieldAttribute::BUILTIN);
+}
+
+bool ModuleCache::isFresh(SymbolTable &symbolTable, const char *fullPath) const {
+    struct stat st;  //NOLINT
+    if(stat(fullPath, &st) != 0) {
+        return false;
+    }
+
+    ByteBuffer buf;
+    {
+        auto filePtr = createFilePtr(fopen, this->getCachePath(fullPath).c_str(), "rb");
+        if(!filePtr || !readAll(filePtr, buf)) {
+            return false;
+        }
+    }
+    ModuleCacheReader reader(symbolTable, buf);
+    return reader.readHeader(fullPath, FileStamp(st), this->assertion, this->peephole);
+}
+
+ModType *ModuleCache::load(SymbolTable &symbolTable, const char *fullPath, int fd,
+                           unsigned int &maxVarNum, bool &nothing) {
+    struct stat st;  //NOLINT
+    if(fstat(fd, &st) != 0) {
+        return nullptr;
+    }
+
+    ByteBuffer buf;
+    {
+        auto filePtr = createFilePtr(fopen, this->getCachePath(fullPath).c_str(), "rb");
+        if(!filePtr || !readAll(filePtr, buf)) {
+            return nullptr;
+        }
+    }
+
+    ModuleCacheReader reader(symbolTable, buf);
+    if(!reader.readHeader(fullPath, FileStamp(st), this->assertion, this->peephole) || !reader.readTypeTable()) {
+        LOG(TRACE_MODULE, "stale module cache: `%s'", fullPath);
+        return nullptr;
+    }
+
+    // read symbols and check conflict (symbol table is not modified until all data is validated)
+    std::vector<CachedSymbol> symbols;
+    std::unordered_set<std::string> varNames;
+    std::unordered_set<std::string> udcNames;
+    unsigned int symbolSize = reader.read32();
+    for(unsigned int i = 0; i < symbolSize && reader; i++) {
+        auto tag = static_cast<SymbolTag>(reader.read8());
+        auto name = reader.readStr();
+        auto *type = reader.readType();
+        auto attr = static_cast<FieldAttribute>(reader.read16());
+        if(!reader || (tag != SymbolTag::VAR && tag != SymbolTag::UDC)) {
+            return nullptr;
+        }
+        auto &names = tag == SymbolTag::UDC ? udcNames : varNames;
+        if(!names.insert(name).second || !isDefinable(symbolTable, tag, name)) {
+            LOG(TRACE_MODULE, "conflicted module cache: `%s'", fullPath);
+            return nullptr;
+        }
+        symbols.push_back({tag, std::move(name), type, attr});
+    }
+
+    std::vector<std::pair<std::string, DSType *>> aliases;
+    unsigned int aliasSize = reader.read32();
+    for(unsigned int i = 0; i < aliasSize && reader; i++) {
+        auto name = reader.readStr();
+        auto *type = reader.readType();
+        if(!reader || symbolTable.getType(name)) {
+            return nullptr;
+        }
+        aliases.emplace_back(std::move(name), type);
+    }
+
+    maxVarNum = reader.read32();
+    nothing = reader.read8() != 0;
+    unsigned int oldBase = reader.read32();
+    if(!reader) {
+        return nullptr;
+    }
+
+    // restore module code (global variable indices are checked in [oldBase, oldBase + symbolSize))
+    const unsigned int newBase = symbolTable.getMaxGVarIndex();
+    reader.setGvarBase(oldBase, newBase, symbols.size());
+    auto code = reader.readCode(ModType::toModName(symbolTable.nextModID()).c_str());
+    if(!code) {
+        LOG(TRACE_MODULE, "broken module cache: `%s'", fullPath);
+        return nullptr;
+    }
+
+    // define module symbols (already validated, so always success)
+    auto scope = symbolTable.createModuleScope();
+    symbolTable.setModuleScope(scope);
+    for(unsigned int i = 0; i < symbols.size(); i++) {
+        auto &e = symbols[i];
+        auto ret = e.tag == SymbolTag::UDC ? symbolTable.registerUdc(e.name, *e.type) :
+                symbolTable.newHandle(e.name, *e.type, e.attr);
+        (void) ret;
+        assert(ret && ret.asOk()->getIndex() == newBase + i);
+    }
+    for(auto &e : aliases) {
+        symbolTable.setAlias(e.first, *e.second);
+    }
+    auto &modType = symbolTable.createModType(fullPath);
+    this->loadedFunc = DSValue::create<FuncObject>(modType, std::move(code));
+
+    // module which imports cached module is not cacheable
+    for(auto &e : this->records) {
+        e.cacheable = false;
+    }
+
+    LOG(TRACE_MODULE, "load module cache: `%s'", fullPath);
+    return &modType;
+}
+
+void ModuleCache::enterModule(const SymbolTable &symbolTable, const char *fullPath) {
+    // module which imports other module is not cacheable
+    for(auto &e : this->records) {
+        e.cacheable = false;
+    }
+
+    Record record;
+    record.fullPath = fullPath;
+    record.gvarBase = symbolTable.getMaxGVarIndex();
+    record.cacheable = stat(fullPath, &record.st) == 0;
+    this->records.push_back(std::move(record));
+}
+
+void ModuleCache::addAlias(const std::string &alias, const DSType &type) {
+    if(!this->records.empty()) {
+        this->records.back().aliases.emplace_back(alias, &type);
+    }
+}
+
+struct SymbolEntry {
+    SymbolTag tag;
+    std::string name;
+    const FieldHandle *handle;
+};
+
+static bool collectSymbols(const SymbolTable &symbolTable, const ModType &modType,
+                           unsigned int base, unsigned int end, std::vector<SymbolEntry> &symbols) {
+    for(auto &e : modType.getHandleMap()) {
+        unsigned int index = e.second.getIndex();
+        if(index < base || index >= end) {
+            return false;
+        }
+        SymbolKey key(e.first);
+        if(key.kind() != SymbolKind::VAR) {
+            return false;
+        }
+        symbols.push_back({SymbolTag::VAR, symbolTable.getSymbolName(key), &e.second});
+    }
+
+    // user-defined commands are defined in root module
+    for(auto &e : symbolTable.rootGlobalScope()) {
+        unsigned int index = e.second.getIndex();
+        if(!e.second || index < base || index >= end) {
+            continue;
+        }
+        SymbolKey key(e.first);
+        if(key.kind() != SymbolKind::UDC) {
+            return false;
+        }
+        symbols.push_back({SymbolTag::UDC, symbolTable.getSymbolName(key), &e.second});
+    }
+
+    std::sort(symbols.begin(), symbols.end(), [](const SymbolEntry &x, const SymbolEntry &y) {
+        return x.handle->getIndex() < y.handle->getIndex();
+    });
+    if(symbols.size() != end - base) {
+        return false;
+    }
+    for(unsigned int i = 0; i < symbols.size(); i++) {
+        if(symbols[i].handle->getIndex() != base + i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeFileAtomically(const std::string &dir, const std::string &path, const std::string &data) {
+    // create cache directory
+    for(std::string::size_type pos = 1; pos != std::string::npos; pos++) {
+        pos = dir.find('/', pos);
+        std::string sub = dir.substr(0, pos);
+        if(mkdir(sub.c_str(), 0700) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if(pos == std::string::npos) {
+            break;
+        }
+    }
+
+    std::string tmp = path;
+    tmp += ".";
+    tmp += std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        return false;
+    }
+    bool s = write(fd, data.c_str(), data.size()) == static_cast<ssize_t>(data.size());
+    close(fd);
+    if(!s || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+void ModuleCache::exitModule(const SymbolTable &symbolTable, const SourceNode &node, const DSValue &func) {
+    assert(!this->records.empty());
+    auto record = std::move(this->records.back());
+    this->records.pop_back();
+    if(!record.cacheable) {
+        return;
+    }
+
+    /**
+     * module handle is defined just after module symbols,
+     * so module symbols are [gvarBase, modIndex)
+     */
+    const unsigned int base = record.gvarBase;
+    const unsigned int end = node.getModIndex();
+    std::vector<SymbolEntry> symbols;
+    if(!collectSymbols(symbolTable, node.getModType(), base, end, symbols)) {
+        LOG(TRACE_MODULE, "not cacheable module: `%s'", record.fullPath.c_str());
+        return;
+    }
+
+    ModuleCacheWriter writer(symbolTable.getTypePool(), symbolTable.getBuiltinVarCount(), base, end);
+    writer.write32(symbols.size());
+    for(auto &e : symbols) {
+        writer.write8(static_cast<unsigned char>(e.tag));
+        writer.writeStr(e.name);
+        if(!writer.writeType(e.handle->getType())) {
+            return;
+        }
+        writer.write16(static_cast<unsigned short>(e.handle->attr()));
+    }
+    writer.write32(record.aliases.size());
+    for(auto &e : record.aliases) {
+        writer.writeStr(e.first);
+        if(!writer.writeType(*e.second)) {
+            return;
+        }
+    }
+    writer.write32(node.getMaxVarNum());
+    writer.write8(node.isNothing() ? 1 : 0);
+    writer.write32(base);
+    if(!writer.writeCode(typeAs<FuncObject>(func).getCode())) {
+        LOG(TRACE_MODULE, "not cacheable module: `%s'", record.fullPath.c_str());
+        return;
+    }
+
+    // write header
+    FileStamp stamp(record.st);
+    std::string header(MODULE_CACHE_MAGIC, sizeof(MODULE_CACHE_MAGIC));
+    writer.write32(header, MODULE_CACHE_REVISION);
+    writer.writeStr(header, X_INFO_VERSION);
+    writer.write32(header, OPCODE_SIZE);
+    writer.write64(header, computeOpcodeHash());
+    writer.write8(header, this->assertion ? 1 : 0);
+    writer.write8(header, this->peephole ? 1 : 0);
+    writer.write32(header, symbolTable.getBuiltinVarCount());
+    writer.writeStr(header, record.fullPath);
+    writer.write64(header, stamp.sec);
+    writer.write64(header, stamp.nsec);
+    writer.write64(header, stamp.size);
+
+    std::string path = this->getCachePath(record.fullPath);
+    if(writeFileAtomically(this->cacheDir, path, writer.take(std::move(header)))) {
+        LOG(TRACE_MODULE, "write module cache: `%s' => `%s'", record.fullPath.c_str(), path.c_str());
+    }
+}
+
+} // namespace ydsh
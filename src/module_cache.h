@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_MODULE_CACHE_H
+#define YDSH_MODULE_CACHE_H
+
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+#include "object.h"
+#include "symbol_table.h"
+
+namespace ydsh {
+
+class SourceNode;
+
+/**
+ * persistent on-disk cache of compiled module code.
+ * cache file is keyed by module full path and invalidated by
+ * modification time, file size, ydsh version, assertion option and peephole optimization option.
+ *
+ * currently, only cache leaf module (not import other modules).
+ */
+class ModuleCache {
+private:
+    /**
+     * for recording compiling module
+     */
+    struct Record {
+        std::string fullPath;
+
+        struct stat st;
+
+        /**
+         * first global variable index of this module
+         */
+        unsigned int gvarBase;
+
+        bool cacheable;
+
+        std::vector<std::pair<std::string, const DSType *>> aliases;
+    };
+
+    const bool assertion;
+
+    /**
+     * cached code is already optimized if true
+     */
+    const bool peephole;
+
+    std::string cacheDir;
+
+    std::vector<Record> records;
+
+    /**
+     * module code restored from cache. consumed by code generator
+     */
+    DSValue loadedFunc;
+
+public:
+    NON_COPYABLE(ModuleCache);
+
+    ModuleCache(bool assertion, bool peephole);
+
+    ~ModuleCache() = default;
+
+    /**
+     * try to restore module from cache.
+     * if hit, define module symbols and module type, and keep module code.
+     * after call it, curModule of symbolTable is null (like SymbolTable::createModType())
+     * @param symbolTable
+     * @param fullPath
+     * @param fd
+     * file descriptor of module source
+     * @param maxVarNum
+     * write max number of local variable
+     * @param nothing
+     * write true if module is Nothing type
+     * @return
+     * if cache miss, return null and not modify symbolTable
+     */
+    ModType *load(SymbolTable &symbolTable, const char *fullPath, int fd, unsigned int &maxVarNum, bool &nothing);
+
+    /**
+     * check whether cache of module is fresh (only check header, not restore it).
+     * even if true, load() may fail (ex. symbol conflict)
+     * @param symbolTable
+     * @param fullPath
+     * @return
+     */
+    bool isFresh(SymbolTable &symbolTable, const char *fullPath) const;
+
+    /**
+     * get module code restored by load()
+     * @return
+     * if not restored, return empty value
+     */
+    DSValue takeLoadedFunc() {
+        return std::move(this->loadedFunc);
+    }
+
+    void enterModule(const SymbolTable &symbolTable, const char *fullPath);
+
+    void addAlias(const std::string &alias, const DSType &type);
+
+    /**
+     * write compiled module code to cache
+     * @param symbolTable
+     * @param node
+     * @param func
+     * compiled module code (FuncObject)
+     */
+    void exitModule(const SymbolTable &symbolTable, const SourceNode &node, const DSValue &func);
+
+private:
+    std::string getCachePath(const std::string &fullPath) const;
+};
+
+} // namespace ydsh
+
+#endif //YDSH_MODULE_CACHE_H
@@ -33,11 +33,6 @@
 
 #define MODE(m) this->setLexerMode(yyc ## m)
 
-/*
- * update line number table
- */
-#define UPDATE_LN() this->updateNewline(startPos)
-
 #define FIND_NEW_LINE() \
     do {\
         foundNewLine = true;\
@@ -149,8 +144,8 @@ TokenKind Lexer::nextToken(Token &token) {
 
       <STMT> INTEGER           { MODE(EXPR); RET(INT_LITERAL); }
       <STMT> FLOAT             { MODE(EXPR); RET(FLOAT_LITERAL); }
-      <STMT> STRING_LITERAL    { UPDATE_LN(); MODE(EXPR); RET(STRING_LITERAL); }
-      <STMT> ESTRING_LITERAL   { UPDATE_LN(); MODE(EXPR); RET(STRING_LITERAL); }
+      <STMT> STRING_LITERAL    { MODE(EXPR); RET(STRING_LITERAL); }
+      <STMT> ESTRING_LITERAL   { MODE(EXPR); RET(STRING_LITERAL); }
       <STMT> REGEX             { MODE(EXPR); RET(REGEX_LITERAL); }
       <STMT> "%" ['] VAR_NAME [']
                                { MODE(EXPR); RET(SIGNAL_LITERAL); }
@@ -170,7 +165,7 @@ TokenKind Lexer::nextToken(Token &token) {
       <STMT,EXPR> "}"          { POP_MODE(); RET(RBC); }
 
       <STMT> CMD_START_CHAR CMD_CHAR*
-                               { PUSH_MODE(CMD); UPDATE_LN(); RET(COMMAND); }
+                               { PUSH_MODE(CMD); RET(COMMAND); }
 
       <EXPR> ":"               { RET(COLON); }
       <EXPR> ","               { MODE(STMT); RET(COMMA); }
@@ -223,17 +218,17 @@ TokenKind Lexer::nextToken(Token &token) {
 
       <STMT,EXPR> LINE_END     { MODE(STMT); RET(LINE_END); }
       <STMT,EXPR,NAME,TYPE> NEW_LINE
-                               { UPDATE_LN(); FIND_NEW_LINE(); }
+                               { FIND_NEW_LINE(); }
 
       <STMT,EXPR,NAME,CMD,TYPE> COMMENT
                                { SKIP(); }
       <STMT,EXPR,NAME,TYPE> [ \t]+
                                { SKIP(); }
       <STMT,EXPR,NAME,TYPE> "\\" [\r\n]
-                               { UPDATE_LN(); SKIP(); }
+                               { SKIP(); }
 
       <DSTRING> ["]            { POP_MODE(); RET(CLOSE_DQUOTE); }
-      <DSTRING> DQUOTE_CHAR+   { UPDATE_LN(); RET(STR_ELEMENT); }
+      <DSTRING> DQUOTE_CHAR+   { RET(STR_ELEMENT); }
       <DSTRING,CMD> INNER_NAME { RET(APPLIED_NAME); }
       <DSTRING,CMD> INNER_SPECIAL_NAME
                                { RET(SPECIAL_NAME); }
@@ -242,18 +237,18 @@ TokenKind Lexer::nextToken(Token &token) {
       <DSTRING,CMD> "$("       { PUSH_MODE(STMT); RET(START_SUB_CMD); }
 
       <CMD> CMD_ARG_START_CHAR CMD_ARG_CHAR*
-                               { UPDATE_LN(); RET(CMD_ARG_PART); }
+                               { RET(CMD_ARG_PART); }
       <CMD> "?"                { RET(GLOB_ANY); }
       <CMD> "*"                { RET(GLOB_ZERO_OR_MORE); }
-      <CMD> STRING_LITERAL     { UPDATE_LN(); RET(STRING_LITERAL); }
-      <CMD> ESTRING_LITERAL    { UPDATE_LN(); RET(STRING_LITERAL); }
+      <CMD> STRING_LITERAL     { RET(STRING_LITERAL); }
+      <CMD> ESTRING_LITERAL    { RET(STRING_LITERAL); }
       <CMD> ["]                { PUSH_MODE(DSTRING); RET(OPEN_DQUOTE); }
       <CMD> APPLIED_NAME "["   { PUSH_MODE(STMT); RET(APPLIED_NAME_WITH_BRACKET); }
       <CMD> SPECIAL_NAME "["   { PUSH_MODE(STMT); RET(SPECIAL_NAME_WITH_BRACKET); }
       <CMD> ")"                { POP_MODE(); POP_MODE(); RET(RP); }
       <CMD> "("                { PUSH_MODE(CMD); RET(LP); }
       <CMD> [ \t]+             { FIND_SPACE(); }
-      <CMD> "\\" [\r\n]        { UPDATE_LN(); FIND_SPACE(); }
+      <CMD> "\\" [\r\n]        { FIND_SPACE(); }
 
       <CMD> "<"                { RET(REDIR_IN_2_FILE); }
       <CMD> (">" | "1>")       { RET(REDIR_OUT_2_FILE); }
@@ -274,7 +269,7 @@ TokenKind Lexer::nextToken(Token &token) {
       <CMD> "||"               { POP_MODE(); MODE(STMT); RET(COND_OR); }
       <CMD> "&&"               { POP_MODE(); MODE(STMT); RET(COND_AND); }
       <CMD> LINE_END           { POP_MODE(); MODE(STMT); RET(LINE_END); }
-      <CMD> NEW_LINE           { POP_MODE(); MODE(STMT); UPDATE_LN(); FIND_NEW_LINE(); }
+      <CMD> NEW_LINE           { POP_MODE(); MODE(STMT); FIND_NEW_LINE(); }
 
       <TYPE> "Func"            { RET(FUNC); }
       <TYPE> "typeof"          { RET(TYPEOF); }
@@ -67,6 +67,20 @@
 
 namespace ydsh {
 
+static thread_local Arena *curNodeArena = nullptr;
+
+Arena *getNodeArena() {
+    return curNodeArena;
+}
+
+NodeArenaScope::NodeArenaScope(Arena &arena) : oldArena(curNodeArena) {
+    curNodeArena = &arena;
+}
+
+NodeArenaScope::~NodeArenaScope() {
+    curNodeArena = this->oldArena;
+}
+
 // ##################
 // ##     Node     ##
 // ##################
@@ -290,7 +304,7 @@ void TypeOpNode::dump(NodeDumper &dumper) const {
 // ##     ApplyNode     ##
 // #######################
 
-ApplyNode::ApplyNode(std::unique_ptr<Node> &&exprNode, std::vector<std::unique_ptr<Node>> &&argNodes, Kind kind) :
+ApplyNode::ApplyNode(std::unique_ptr<Node> &&exprNode, NodeVector<Node> &&argNodes, Kind kind) :
         WithRtti(exprNode->getToken()),
         exprNode(std::move(exprNode)), argNodes(std::move(argNodes)), kind(kind) {
     if(!this->argNodes.empty()) {
@@ -301,7 +315,7 @@ ApplyNode::ApplyNode(std::unique_ptr<Node> &&exprNode, std::vector<std::unique_p
 std::unique_ptr<ApplyNode> ApplyNode::newMethodCall(std::unique_ptr<Node> &&recvNode, Token token, std::string &&methodName) {
     auto exprNode = std::make_unique<AccessNode>(
             std::move(recvNode), std::make_unique<VarNode>(token, std::move(methodName)));
-    return std::make_unique<ApplyNode>(std::move(exprNode), std::vector<std::unique_ptr<Node>>(), METHOD_CALL);
+    return std::make_unique<ApplyNode>(std::move(exprNode), NodeVector<Node>(), METHOD_CALL);
 }
 
 void ApplyNode::dump(NodeDumper &dumper) const {
@@ -324,7 +338,7 @@ void ApplyNode::dump(NodeDumper &dumper) const {
 // #####################
 
 NewNode::NewNode(unsigned int startPos, std::unique_ptr<TypeNode> &&targetTypeNode,
-        std::vector<std::unique_ptr<Node>> &&argNodes) :
+        NodeVector<Node> &&argNodes) :
         WithRtti({startPos, 0}), targetTypeNode(std::move(targetTypeNode)), argNodes(std::move(argNodes)) {
     if(!this->argNodes.empty()) {
         this->updateToken(this->argNodes.back()->getToken());
@@ -20,6 +20,7 @@
 #include <utility>
 #include <memory>
 #include <list>
+#include <vector>
 #include <cassert>
 
 #include "misc/rtti.hpp"
@@ -27,6 +28,7 @@
 #include "misc/noncopyable.h"
 #include "misc/token.hpp"
 #include "misc/result.hpp"
+#include "misc/arena.hpp"
 #include "token_kind.h"
 #include "type.h"
 #include "constant.h"
@@ -87,6 +89,62 @@ enum class NodeKind : unsigned char {
 #undef GEN_ENUM
 };
 
+/**
+ * get arena for node allocation in current thread.
+ * if null (outside of NodeArenaScope), node is allocated by malloc
+ */
+Arena *getNodeArena();
+
+/**
+ * during lifetime of this object, node and node list are allocated from specified arena
+ */
+class NodeArenaScope {
+private:
+    Arena *oldArena;
+
+public:
+    NON_COPYABLE(NodeArenaScope);
+
+    explicit NodeArenaScope(Arena &arena);
+
+    ~NodeArenaScope();
+};
+
+template <typename T>
+struct NodeAllocator {
+    using value_type = T;
+
+    NodeAllocator() = default;
+
+    template <typename U>
+    NodeAllocator(const NodeAllocator<U> &) {}  //NOLINT
+
+    T *allocate(std::size_t n) {
+        static_assert(alignof(T) <= Arena::ALIGNMENT, "must be aligned");
+        return static_cast<T *>(Arena::allocate(getNodeArena(), sizeof(T) * n));
+    }
+
+    void deallocate(T *ptr, std::size_t) {
+        Arena::release(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const NodeAllocator<U> &) const {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const NodeAllocator<U> &) const {
+        return false;
+    }
+};
+
+/**
+ * list of child nodes
+ */
+template <typename T>
+using NodeVector = std::vector<std::unique_ptr<T>, NodeAllocator<std::unique_ptr<T>>>;
+
 
 class Node {
 protected:
@@ -106,6 +164,14 @@ public:
 
     virtual ~Node() = default;
 
+    static void *operator new(std::size_t size) {
+        return Arena::allocate(getNodeArena(), size);
+    }
+
+    static void operator delete(void *ptr) {
+        Arena::release(ptr);
+    }
+
     NodeKind getNodeKind() const {
         return this->nodeKind;
     }
@@ -221,11 +287,11 @@ public:
 class ReifiedTypeNode : public TypeNode {
 private:
     std::unique_ptr<BaseTypeNode> templateTypeNode;
-    std::vector<std::unique_ptr<TypeNode>> elementTypeNodes;
+    NodeVector<TypeNode> elementTypeNodes;
 
 public:
     ReifiedTypeNode(std::unique_ptr<BaseTypeNode> &&templateTypeNode,
-            std::vector<std::unique_ptr<TypeNode>> &&elementNodes, Token endToken) :
+            NodeVector<TypeNode> &&elementNodes, Token endToken) :
             TypeNode(TypeNode::Reified, templateTypeNode->getToken()),
             templateTypeNode(std::move(templateTypeNode)), elementTypeNodes(std::move(elementNodes)) {
         this->updateToken(endToken);
@@ -242,7 +308,7 @@ public:
         return this->templateTypeNode;
     }
 
-    const std::vector<std::unique_ptr<TypeNode>> &getElementTypeNodes() const {
+    const NodeVector<TypeNode> &getElementTypeNodes() const {
         return this->elementTypeNodes;
     }
 
@@ -256,24 +322,24 @@ private:
     /**
      * may be empty vector, if has no parameter
      */
-    std::vector<std::unique_ptr<TypeNode>> paramTypeNodes;
+    NodeVector<TypeNode> paramTypeNodes;
 
 public:
     FuncTypeNode(unsigned int startPos, std::unique_ptr<TypeNode> &&returnTypeNode,
-                std::vector<std::unique_ptr<TypeNode>> paramTypeNodes, Token endToken) :
+                NodeVector<TypeNode> paramTypeNodes, Token endToken) :
             TypeNode(TypeNode::Func, {startPos, 0}),
             returnTypeNode(std::move(returnTypeNode)), paramTypeNodes(std::move(paramTypeNodes)) {
         this->updateToken(endToken);
     }
 
-    FuncTypeNode(unsigned int startPos, std::vector<std::unique_ptr<TypeNode>> paramTypeNodes,
+    FuncTypeNode(unsigned int startPos, NodeVector<TypeNode> paramTypeNodes,
                 std::unique_ptr<TypeNode> &&returnTypeNode) :
             TypeNode(TypeNode::Func, {startPos, 0}),
             returnTypeNode(std::move(returnTypeNode)), paramTypeNodes(std::move(paramTypeNodes)) {
         this->updateToken(this->returnTypeNode->getToken());
     }
 
-    const std::vector<std::unique_ptr<TypeNode>> &getParamTypeNodes() const {
+    const NodeVector<TypeNode> &getParamTypeNodes() const {
         return this->paramTypeNodes;
     }
 
@@ -289,7 +355,7 @@ public:
  */
 class ReturnTypeNode : public TypeNode {
 private:
-    std::vector<std::unique_ptr<TypeNode>> typeNodes;
+    NodeVector<TypeNode> typeNodes;
 
 public:
     explicit ReturnTypeNode(std::unique_ptr<TypeNode> &&typeNode) :
@@ -302,7 +368,7 @@ public:
         this->typeNodes.push_back(std::move(typeNode));
     }
 
-    const std::vector<std::unique_ptr<TypeNode>> &getTypeNodes() const {
+    const NodeVector<TypeNode> &getTypeNodes() const {
         return this->typeNodes;
     }
 
@@ -438,7 +504,7 @@ public:
 
 class StringExprNode : public WithRtti<Node, NodeKind::StringExpr> {
 private:
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
 
 public:
     explicit StringExprNode(unsigned int startPos) : WithRtti({startPos, 1}) { }
@@ -449,11 +515,11 @@ public:
         this->nodes.push_back(std::move(node));
     }
 
-    const std::vector<std::unique_ptr<Node>> &getExprNodes() const {
+    const NodeVector<Node> &getExprNodes() const {
         return this->nodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refExprNodes() {
+    NodeVector<Node> &refExprNodes() {
         return this->nodes;
     }
 
@@ -489,7 +555,7 @@ public:
 
 class ArrayNode : public WithRtti<Node, NodeKind::Array> {
 private:
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
 
 public:
     ArrayNode(unsigned int startPos, std::unique_ptr<Node> &&node) : WithRtti({startPos, 0}) {
@@ -500,11 +566,11 @@ public:
         this->nodes.push_back(std::move(node));
     }
 
-    const std::vector<std::unique_ptr<Node>> &getExprNodes() const {
+    const NodeVector<Node> &getExprNodes() const {
         return this->nodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refExprNodes() {
+    NodeVector<Node> &refExprNodes() {
         return this->nodes;
     }
 
@@ -513,8 +579,8 @@ public:
 
 class MapNode : public WithRtti<Node, NodeKind::Map> {
 private:
-    std::vector<std::unique_ptr<Node>> keyNodes;
-    std::vector<std::unique_ptr<Node>> valueNodes;
+    NodeVector<Node> keyNodes;
+    NodeVector<Node> valueNodes;
 
 public:
     MapNode(unsigned int startPos, std::unique_ptr<Node> &&keyNode, std::unique_ptr<Node> &&valueNode) :
@@ -524,19 +590,19 @@ public:
 
     void addEntry(std::unique_ptr<Node> &&keyNode, std::unique_ptr<Node> &&valueNode);
 
-    const std::vector<std::unique_ptr<Node>> &getKeyNodes() const {
+    const NodeVector<Node> &getKeyNodes() const {
         return this->keyNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refKeyNodes() {
+    NodeVector<Node> &refKeyNodes() {
         return this->keyNodes;
     }
 
-    const std::vector<std::unique_ptr<Node>> &getValueNodes() const {
+    const NodeVector<Node> &getValueNodes() const {
         return this->valueNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refValueNodes() {
+    NodeVector<Node> &refValueNodes() {
         return this->valueNodes;
     }
 
@@ -548,17 +614,17 @@ private:
     /**
      * at least one nodes
      */
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
 
 public:
-    TupleNode(unsigned int startPos, std::vector<std::unique_ptr<Node>> &&nodes, Token endToken) :
+    TupleNode(unsigned int startPos, NodeVector<Node> &&nodes, Token endToken) :
             WithRtti({startPos, 0}), nodes(std::move(nodes)) {
         this->updateToken(endToken);
     }
 
     ~TupleNode() override = default;
 
-    const std::vector<std::unique_ptr<Node>> &getNodes() const {
+    const NodeVector<Node> &getNodes() const {
         return this->nodes;
     }
 
@@ -779,7 +845,7 @@ public:
 
 private:
     std::unique_ptr<Node> exprNode;
-    std::vector<std::unique_ptr<Node>> argNodes;
+    NodeVector<Node> argNodes;
 
     /**
      * for method call
@@ -789,7 +855,7 @@ private:
     Kind kind;
 
 public:
-    ApplyNode(std::unique_ptr<Node> &&exprNode, std::vector<std::unique_ptr<Node>> &&argNodes, Kind kind = UNRESOLVED);
+    ApplyNode(std::unique_ptr<Node> &&exprNode, NodeVector<Node> &&argNodes, Kind kind = UNRESOLVED);
 
     static std::unique_ptr<ApplyNode> newMethodCall(std::unique_ptr<Node> &&recvNode,
             Token token, std::string &&methodName);
@@ -812,11 +878,11 @@ public:
         return *this->exprNode;
     }
 
-    const std::vector<std::unique_ptr<Node>> &getArgNodes() const {
+    const NodeVector<Node> &getArgNodes() const {
         return this->argNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refArgNodes() {
+    NodeVector<Node> &refArgNodes() {
         return this->argNodes;
     }
 
@@ -878,13 +944,13 @@ public:
 class NewNode : public WithRtti<Node, NodeKind::New> {
 private:
     std::unique_ptr<TypeNode> targetTypeNode;
-    std::vector<std::unique_ptr<Node>> argNodes;
+    NodeVector<Node> argNodes;
 
     const MethodHandle *handle{nullptr};
 
 public:
     NewNode(unsigned int startPos, std::unique_ptr<TypeNode> &&targetTypeNode,
-            std::vector<std::unique_ptr<Node>> &&argNodes);
+            NodeVector<Node> &&argNodes);
 
     explicit NewNode(std::unique_ptr<TypeNode> &&targetTypeNode) :
             WithRtti(targetTypeNode->getToken()), targetTypeNode(std::move(targetTypeNode)) {}
@@ -893,11 +959,11 @@ public:
         return *this->targetTypeNode;
     }
 
-    const std::vector<std::unique_ptr<Node>> &getArgNodes() const {
+    const NodeVector<Node> &getArgNodes() const {
         return this->argNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refArgNodes() {
+    NodeVector<Node> &refArgNodes() {
         return this->argNodes;
     }
 
@@ -1120,7 +1186,7 @@ public:
 class CmdArgNode : public WithRtti<Node, NodeKind::CmdArg> {
 private:
     unsigned int globPathSize{0};
-    std::vector<std::unique_ptr<Node>> segmentNodes;
+    NodeVector<Node> segmentNodes;
 
 public:
     explicit CmdArgNode(std::unique_ptr<Node> &&segmentNode) :
@@ -1132,11 +1198,11 @@ public:
 
     void addSegmentNode(std::unique_ptr<Node> &&node);
 
-    const std::vector<std::unique_ptr<Node>> &getSegmentNodes() const {
+    const NodeVector<Node> &getSegmentNodes() const {
         return this->segmentNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refSegmentNodes() {
+    NodeVector<Node> &refSegmentNodes() {
         return this->segmentNodes;
     }
 
@@ -1199,7 +1265,7 @@ private:
     /**
      * may be CmdArgNode, RedirNode
      */
-    std::vector<std::unique_ptr<Node>> argNodes;
+    NodeVector<Node> argNodes;
 
     unsigned int redirCount{0};
 
@@ -1217,7 +1283,7 @@ public:
 
     void addArgNode(std::unique_ptr<CmdArgNode> &&node);
 
-    const std::vector<std::unique_ptr<Node>> &getArgNodes() const {
+    const NodeVector<Node> &getArgNodes() const {
         return this->argNodes;
     }
 
@@ -1240,7 +1306,7 @@ public:
 
 class PipelineNode : public WithRtti<Node, NodeKind::Pipeline> {
 private:
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
 
     unsigned int baseIndex{0}; // for indicating internal pipeline state index
 
@@ -1255,7 +1321,7 @@ public:
 
     void addNode(std::unique_ptr<Node> &&node);
 
-    const std::vector<std::unique_ptr<Node>> &getNodes() const {
+    const NodeVector<Node> &getNodes() const {
         return this->nodes;
     }
 
@@ -1281,7 +1347,7 @@ class WithNode : public WithRtti<Node, NodeKind::With> {
 private:
     std::unique_ptr<Node> exprNode;
 
-    std::vector<std::unique_ptr<RedirNode>> redirNodes;
+    NodeVector<RedirNode> redirNodes;
 
     unsigned int baseIndex{0};
 
@@ -1302,7 +1368,7 @@ public:
         this->redirNodes.push_back(std::move(node));
     }
 
-    const std::vector<std::unique_ptr<RedirNode>> &getRedirNodes() const {
+    const NodeVector<RedirNode> &getRedirNodes() const {
         return this->redirNodes;
     }
 
@@ -1405,7 +1471,7 @@ public:
 
 class BlockNode : public WithRtti<Node, NodeKind::Block> {
 private:
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
     unsigned int baseIndex{0};
     unsigned int varSize{0};
     unsigned int maxVarSize{0};
@@ -1419,11 +1485,11 @@ public:
 
     void insertNodeToFirst(std::unique_ptr<Node> &&node);
 
-    const std::vector<std::unique_ptr<Node>> &getNodes() const {
+    const NodeVector<Node> &getNodes() const {
         return this->nodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refNodes() {
+    NodeVector<Node> &refNodes() {
         return this->nodes;
     }
 
@@ -1596,7 +1662,7 @@ private:
     /**
      * if represents default pattern, size is 0
      */
-    std::vector<std::unique_ptr<Node>> patternNodes;
+    NodeVector<Node> patternNodes;
 
     /**
      * initial value is null.
@@ -1619,11 +1685,11 @@ public:
         this->patternNodes.push_back(std::move(node));
     }
 
-    const std::vector<std::unique_ptr<Node>> &getPatternNodes() const {
+    const NodeVector<Node> &getPatternNodes() const {
         return this->patternNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refPatternNodes() {
+    NodeVector<Node> &refPatternNodes() {
         return this->patternNodes;
     }
 
@@ -1651,7 +1717,7 @@ public:
 
 private:
     std::unique_ptr<Node> exprNode;
-    std::vector<std::unique_ptr<ArmNode>> armNodes;
+    NodeVector<ArmNode> armNodes;
     Kind caseKind{MAP};
 
 public:
@@ -1666,7 +1732,7 @@ public:
         this->armNodes.push_back(std::move(armNode));
     }
 
-    const std::vector<std::unique_ptr<ArmNode>> &getArmNodes() const {
+    const NodeVector<ArmNode> &getArmNodes() const {
         return this->armNodes;
     }
 
@@ -1804,7 +1870,7 @@ private:
     /**
      * may be empty
      */
-    std::vector<std::unique_ptr<Node>> catchNodes;
+    NodeVector<Node> catchNodes;
 
     /**
      * may be null
@@ -1830,11 +1896,11 @@ public:
         this->catchNodes.push_back(std::move(catchNode));
     }
 
-    const std::vector<std::unique_ptr<Node>> &getCatchNodes() const {
+    const NodeVector<Node> &getCatchNodes() const {
         return this->catchNodes;
     }
 
-    std::vector<std::unique_ptr<Node>> &refCatchNodes() {
+    NodeVector<Node> &refCatchNodes() {
         return this->catchNodes;
     }
 
@@ -2041,12 +2107,12 @@ private:
     /**
      * for parameter definition.
      */
-    std::vector<std::unique_ptr<VarNode>> paramNodes;
+    NodeVector<VarNode> paramNodes;
 
     /**
      * type token of each parameter
      */
-    std::vector<std::unique_ptr<TypeNode>> paramTypeNodes;
+    NodeVector<TypeNode> paramTypeNodes;
 
     std::unique_ptr<TypeNode> returnTypeNode;
 
@@ -2079,11 +2145,11 @@ public:
         this->paramTypeNodes.push_back(std::move(paramType));
     }
 
-    const std::vector<std::unique_ptr<VarNode>> &getParamNodes() const {
+    const NodeVector<VarNode> &getParamNodes() const {
         return this->paramNodes;
     }
 
-    const std::vector<std::unique_ptr<TypeNode>> &getParamTypeNodes() const {
+    const NodeVector<TypeNode> &getParamTypeNodes() const {
         return this->paramTypeNodes;
     }
 
@@ -2566,7 +2632,7 @@ public:
     }
 
     template <typename T, enable_when<std::is_convertible<T *, Node *>::value> = nullptr>
-    void dump(const char *fieldName, const std::vector<std::unique_ptr<T>> &nodes) {
+    void dump(const char *fieldName, const NodeVector<T> &nodes) {
         this->dumpNodesHead(fieldName);
         for(auto &e : nodes) {
             this->dumpNodesBody(*e);
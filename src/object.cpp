@@ -22,9 +22,18 @@
 
 namespace ydsh {
 
+template <typename T>
+static void deleteObject(T *obj) {
+    delete obj;
+}
+
+static void deleteObject(BaseObject *obj) {
+    BaseObject::destroy(obj);
+}
+
 void DSObject::destroy() {
     switch(this->getKind()) {
-#define GEN_CASE(K) case K: delete static_cast<K ## Object*>(this); break;
+#define GEN_CASE(K) case K: deleteObject(static_cast<K ## Object*>(this)); break;
     EACH_OBJECT_KIND(GEN_CASE)
 #undef GEN_CASE
     }
@@ -69,10 +78,56 @@ StringRef DSValue::asStrRef() const {
     if(isSmallStr(this->kind())) {
         return StringRef(this->str.value, smallStrSize(this->kind()));
     }
+    if(this->get()->getKind() == DSObject::StringSlice) {
+        return typeAs<StringSliceObject>(*this).getRef();
+    }
     auto &obj = typeAs<StringObject>(*this);
     return StringRef(obj.getValue(), obj.size());
 }
 
+const char *DSValue::asCStr() const {
+    assert(this->hasStrRef());
+    if(this->isObject() && this->get()->getKind() == DSObject::StringSlice) {
+        return typeAs<StringSliceObject>(*this).getCStr();
+    }
+    return this->asStrRef().data();
+}
+
+DSValue DSValue::materialize() const {
+    if(this->isObject() && this->get()->getKind() == DSObject::StringSlice
+        && !typeAs<StringSliceObject>(*this).isTerminated()) {
+        return DSValue::create<StringObject>(this->asStrRef());
+    }
+    return *this;
+}
+
+DSValue DSValue::createStrSlice(const DSValue &value, unsigned int begin, unsigned int end) {
+    auto ref = value.asStrRef();
+    assert(begin <= end && end <= ref.size());
+    const unsigned int size = end - begin;
+    if(size == ref.size()) {
+        return value;
+    }
+    if(size < StringSliceObject::MIN_SIZE || !value.isObject()) {
+        return createStr(ref.slice(begin, end));
+    }
+
+    // always refer original string (not slice)
+    DSValue parent = value;
+    unsigned int offset = begin;
+    if(parent.get()->getKind() == DSObject::StringSlice) {
+        auto &slice = typeAs<StringSliceObject>(value);
+        offset += slice.getOffset();
+        parent = slice.getParent();
+    }
+    const uint64_t parentSize = typeAs<StringObject>(parent).size();
+    if(parentSize < StringSliceObject::MIN_PARENT_SIZE
+        || static_cast<uint64_t>(size) * StringSliceObject::MAX_PARENT_RATIO < parentSize) {
+        return createStr(ref.slice(begin, end));
+    }
+    return DSValue::create<StringSliceObject>(std::move(parent), offset, size);
+}
+
 std::string DSValue::toString() const {
     switch(this->kind()) {
     case DSValueKind::NUMBER:
@@ -213,6 +268,9 @@ size_t DSValue::hash() const {
     case DSValueKind::FLOAT:
         return std::hash<double>()(this->asFloat());
     default:
+        if(this->isObject() && this->get()->getKind() == DSObject::String) {
+            return typeAs<StringObject>(*this).hash();   // reuse cached hash
+        }
         if(this->hasStrRef()) {
             return std::hash<StringRef>()(this->asStrRef());
         }
@@ -250,6 +308,10 @@ bool DSValue::compare(const DSValue &o) const {
 bool DSValue::appendAsStr(StringRef value) {
     assert(this->hasStrRef());
 
+    if(this->isObject() && this->get()->getKind() == DSObject::StringSlice) {
+        (*this) = DSValue::create<StringObject>(this->asStrRef());    // copy to own buffer
+    }
+
     const bool small = isSmallStr(this->kind());
     const size_t size = small ? smallStrSize(this->kind()) : typeAs<StringObject>(*this).size();
     if(size > StringObject::MAX_SIZE - value.size()) {
@@ -422,13 +484,15 @@ DSValue ArrayObject::opCmdArg(DSState &state) const {
 // ########################
 
 DSValue MapObject::nextElement(DSState &ctx) {
+    this->iter = this->valueMap.nextIndex(this->iter);
+    auto &e = this->valueMap.at(this->iter);
     std::vector<DSType *> types(2);
-    types[0] = &ctx.symbolTable.get(this->iter->first.getTypeID());
-    types[1] = &ctx.symbolTable.get(this->iter->second.getTypeID());
+    types[0] = &ctx.symbolTable.get(e.first.getTypeID());
+    types[1] = &ctx.symbolTable.get(e.second.getTypeID());
 
     auto entry = DSValue::create<BaseObject>(*ctx.symbolTable.createTupleType(std::move(types)).take());
-    typeAs<BaseObject>(entry)[0] = this->iter->first;
-    typeAs<BaseObject>(entry)[1] = this->iter->second;
+    typeAs<BaseObject>(entry)[0] = e.first;
+    typeAs<BaseObject>(entry)[1] = e.second;
     ++this->iter;
 
     return entry;
@@ -29,10 +29,12 @@
 #include "misc/buffer.hpp"
 #include "misc/string_ref.hpp"
 #include "misc/rtti.hpp"
+#include "misc/ordered_map.hpp"
 #include "lexer.h"
 #include "opcode.h"
 #include "regex_wrapper.h"
 #include "constant.h"
+#include "object_pool.h"
 
 namespace ydsh {
 
@@ -40,6 +42,7 @@ class DSValue;
 
 #define EACH_OBJECT_KIND(OP) \
     OP(String) \
+    OP(StringSlice) \
     OP(UnixFd) \
     OP(Regex) \
     OP(Array) \
@@ -114,6 +117,21 @@ public:
     static bool classof(const DSObject *obj) {
         return obj->getKind() == K;
     }
+
+    static void *operator new(size_t size) {
+        return ObjectPool::allocate(size);
+    }
+
+    /**
+     * for variable length object
+     */
+    static void *operator new(size_t, void *ptr) noexcept {
+        return ptr;
+    }
+
+    static void operator delete(void *ptr, size_t size) noexcept {
+        ObjectPool::deallocate(ptr, size);
+    }
 };
 
 class UnixFdObject : public ObjectWithRtti<DSObject::UnixFd> {
@@ -151,6 +169,11 @@ class StringObject : public ObjectWithRtti<DSObject::String> {
 private:
     std::string value;
 
+    /**
+     * cached hash value. if 0, not computed yet
+     */
+    mutable size_t hashValue{0};
+
 public:
     static constexpr size_t MAX_SIZE = INT32_MAX;
 
@@ -169,6 +192,14 @@ public:
 
     void append(StringRef v) {
         this->value.append(v.data(), v.size());
+        this->hashValue = 0;
+    }
+
+    size_t hash() const {
+        if(this->hashValue == 0) {
+            this->hashValue = WyHash::compute(this->value.data(), this->value.size());
+        }
+        return this->hashValue;
     }
 };
 
@@ -412,7 +443,8 @@ public:
 
     bool hasStrRef() const {
         return isSmallStr(this->kind()) ||
-            (this->isObject() && this->get()->getKind() == DSObject::String);
+            (this->isObject() && (this->get()->getKind() == DSObject::String ||
+                                  this->get()->getKind() == DSObject::StringSlice));
     }
 
     unsigned int asNum() const {
@@ -450,8 +482,27 @@ public:
         return this->d.value;
     }
 
+    /**
+     * returned string may not be null terminated (if string slice).
+     * @return
+     */
     StringRef asStrRef() const;
 
+    /**
+     * get null terminated string.
+     * not modify object. string slice must be terminated (see materialize())
+     * @return
+     */
+    const char *asCStr() const;
+
+    /**
+     * if string slice which does not end at the end of parent string, copy to new string object.
+     * otherwise, return this.
+     * must be called from main thread before asCStr() if value may be string slice
+     * @return
+     */
+    DSValue materialize() const;
+
     std::string toString() const;
 
     /**
@@ -567,6 +618,18 @@ public:
         }
         return DSValue::create<StringObject>(std::move(value));
     }
+
+    /**
+     * create substring. if large enough, share buffer of original string object (see. StringSliceObject)
+     * @param value
+     * must be string
+     * @param begin
+     * inclusive
+     * @param end
+     * exclusive
+     * @return
+     */
+    static DSValue createStrSlice(const DSValue &value, unsigned int begin, unsigned int end);
 };
 
 template <typename T>
@@ -610,6 +673,68 @@ inline bool concatAsStr(DSValue &left, const DSValue &right, bool selfConcat) {
     return left.appendAsStr(right.asStrRef());
 }
 
+/**
+ * substring of StringObject. share buffer of original string.
+ * if null terminated string is required (ex. argv, path), copy to new string on main thread (see DSValue::materialize).
+ */
+class StringSliceObject : public ObjectWithRtti<DSObject::StringSlice> {
+private:
+    /**
+     * always StringObject (not slice)
+     */
+    DSValue parent;
+
+    unsigned int offset;
+
+    unsigned int len;
+
+public:
+    /**
+     * if slice is shorter than it, copy substring
+     */
+    static constexpr unsigned int MIN_SIZE = 64;
+
+    /**
+     * if original string is shorter than it, copy substring
+     */
+    static constexpr unsigned int MIN_PARENT_SIZE = 256;
+
+    /**
+     * if original string is larger than slice * it, copy substring
+     * (not pin large original string by small slice)
+     */
+    static constexpr unsigned int MAX_PARENT_RATIO = 16;
+
+    StringSliceObject(DSValue &&parent, unsigned int offset, unsigned int len) :
+            ObjectWithRtti(TYPE::String), parent(std::move(parent)), offset(offset), len(len) {}
+
+    const DSValue &getParent() const {
+        return this->parent;
+    }
+
+    unsigned int getOffset() const {
+        return this->offset;
+    }
+
+    StringRef getRef() const {
+        auto &str = typeAs<StringObject>(this->parent);
+        return StringRef(str.getValue() + this->offset, this->len);
+    }
+
+    /**
+     * if true, slice shares null character of parent string
+     * @return
+     */
+    bool isTerminated() const {
+        return this->offset + this->len == typeAs<StringObject>(this->parent).size();
+    }
+
+    const char *getCStr() const {
+        assert(this->isTerminated());
+        return typeAs<StringObject>(this->parent).getValue() + this->offset;
+    }
+};
+
 class RegexObject : public ObjectWithRtti<DSObject::Regex> {
 private:
     std::string str; // for string representation
@@ -635,6 +760,15 @@ public:
     const std::string &getStr() const {
         return this->str;
     }
+
+    /**
+     * get regex flag (PCRE_CASELESS, PCRE_MULTILINE) specified in regex literal
+     */
+    int getFlag() const {
+        unsigned long option = 0;
+        pcre_fullinfo(this->re.get(), nullptr, PCRE_INFO_OPTIONS, &option);
+        return static_cast<int>(option & (PCRE_CASELESS | PCRE_MULTILINE));
+    }
 };
 
 class ArrayObject : public ObjectWithRtti<DSObject::Array> {
@@ -693,7 +827,7 @@ public:
 };
 
 inline const char *str(const DSValue &v) {
-    return v.asStrRef().data();
+    return v.asCStr();
 }
 
 struct KeyCompare {
@@ -708,12 +842,16 @@ struct GenHash {
     }
 };
 
-using HashMap = std::unordered_map<DSValue, DSValue, GenHash, KeyCompare>;
+using HashMap = OrderedHashMap<DSValue, DSValue, GenHash, KeyCompare>;
 
 class MapObject : public ObjectWithRtti<DSObject::Map> {
 private:
     HashMap valueMap;
-    HashMap::const_iterator iter;
+
+    /**
+     * entry index of HashMap
+     */
+    unsigned int iter{0};
 
 public:
     explicit MapObject(const DSType &type) : ObjectWithRtti(type) { }
@@ -739,50 +877,50 @@ public:
      * old element. if not found (first time insertion), return invalid
      */
     DSValue set(DSValue &&key, DSValue &&value) {
-        auto pair = this->valueMap.emplace(std::move(key), value);
+        auto pair = this->valueMap.insert(std::move(key), std::move(value));
         if(pair.second) {
-            this->iter = ++pair.first;
+            this->iter = pair.first + 1;
             return DSValue::createInvalid();
         }
-        std::swap(pair.first->second, value);
+        std::swap(this->valueMap.at(pair.first).second, value);
         return std::move(value);
     }
 
     DSValue setDefault(DSValue &&key, DSValue &&value) {
-        auto pair = this->valueMap.emplace(std::move(key), std::move(value));
+        auto pair = this->valueMap.insert(std::move(key), std::move(value));
         if(pair.second) {
-            this->iter = pair.first;
-            this->iter++;
+            this->iter = pair.first + 1;
         }
-        return pair.first->second;
+        return this->valueMap.at(pair.first).second;
     }
 
     bool trySwap(const DSValue &key, DSValue &value) {
-        auto ret = this->valueMap.find(key);
-        if(ret != this->valueMap.end()) {
-            std::swap(ret->second, value);
+        unsigned int index = this->valueMap.findIndex(key);
+        if(index != this->valueMap.endIndex()) {
+            std::swap(this->valueMap.at(index).second, value);
             return true;
         }
         return false;
     }
 
     bool remove(const DSValue &key) {
-        auto ret = this->valueMap.find(key);
-        if(ret == this->valueMap.end()) {
+        unsigned int index = this->valueMap.findIndex(key);
+        if(index == this->valueMap.endIndex()) {
             return false;
         }
-        this->iter = this->valueMap.erase(ret);
+        this->iter = this->valueMap.erase(index);
         return true;
     }
 
     void initIterator() {
-        this->iter = this->valueMap.cbegin();
+        this->iter = 0;
     }
 
     DSValue nextElement(DSState &ctx);
 
     bool hasNext() {
-        return this->iter != this->valueMap.cend();
+        this->iter = this->valueMap.nextIndex(this->iter);
+        return this->iter != this->valueMap.endIndex();
     }
 
     std::string toString() const;
@@ -801,12 +939,27 @@ private:
         }
     }
 
+    static size_t allocSize(unsigned int fieldSize) {
+        return sizeof(BaseObject) + sizeof(DSValueBase) * fieldSize;
+    }
+
 public:
     static BaseObject *create(const DSType &type, unsigned int size) {
-        void *ptr = malloc(sizeof(BaseObject) + sizeof(DSValueBase) * size);
+        void *ptr = ObjectPool::allocate(allocSize(size));
         return new(ptr) BaseObject(type, size);
     }
 
+    /**
+     * call destructor and release memory.
+     * (memory size depends on field size, so not use operator delete)
+     * @param obj
+     */
+    static void destroy(BaseObject *obj) {
+        const size_t size = allocSize(obj->getFieldSize());
+        obj->~BaseObject();
+        ObjectPool::deallocate(obj, size);
+    }
+
     /**
      * for tuple object construction
      * @param type
@@ -826,9 +979,7 @@ public:
         return static_cast<const DSValue&>(this->fields[index]);
     }
 
-    static void operator delete(void *ptr) noexcept {   //NOLINT
-        free(ptr);
-    }
+    static void operator delete(void *ptr) = delete;
 
     unsigned int getFieldSize() const {
         return this->fieldSize;
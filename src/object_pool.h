@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_OBJECT_POOL_H
+#define YDSH_OBJECT_POOL_H
+
+#include <cstdlib>
+
+#include <config.h>
+#include "misc/noncopyable.h"
+#include "misc/fatal.h"
+
+namespace ydsh {
+
+/**
+ * size class free lists for small objects.
+ * released memory block is cached in free list of its size class and reused by next allocation.
+ * free lists are per-thread (object allocation does not have access to DSState).
+ * if USE_OBJECT_POOL is not defined, directly use malloc/free.
+ */
+class ObjectPool {
+public:
+    static constexpr unsigned int GRANULE = 16;
+
+    /**
+     * larger objects are not pooled
+     */
+    static constexpr unsigned int MAX_POOLED_SIZE = 128;
+
+    static constexpr unsigned int CLASS_SIZE = MAX_POOLED_SIZE / GRANULE;
+
+    /**
+     * maximum number of cached blocks per size class
+     */
+    static constexpr unsigned int MAX_CACHED_NUM = 1024;
+
+    struct Stats {
+        unsigned long alloc{0};     // number of allocation
+        unsigned long reuse{0};     // number of allocation from free list
+        unsigned long free{0};      // number of deallocation
+        unsigned long cached{0};    // number of currently cached blocks
+        unsigned long cachedBytes{0};
+    };
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    FreeBlock *freeLists[CLASS_SIZE]{};
+
+    unsigned int cachedNums[CLASS_SIZE]{};
+
+    Stats stats;
+
+    static thread_local ObjectPool pool;
+
+    ObjectPool() = default;
+
+public:
+    NON_COPYABLE(ObjectPool);
+
+    ~ObjectPool();
+
+    static void *allocate(size_t size) {
+#ifdef USE_OBJECT_POOL
+        return pool.allocateImpl(size);
+#else
+        return mallocOrAbort(size);
+#endif
+    }
+
+    static void deallocate(void *ptr, size_t size) noexcept {
+#ifdef USE_OBJECT_POOL
+        pool.deallocateImpl(ptr, size);
+#else
+        (void) size;
+        ::free(ptr);
+#endif
+    }
+
+    /**
+     * get allocation statistics of current thread.
+     * if USE_OBJECT_POOL is not defined, always zero.
+     */
+    static const Stats &getStats() {
+        return pool.stats;
+    }
+
+private:
+    static void *mallocOrAbort(size_t size) {
+        void *ptr = malloc(size);
+        if(ptr == nullptr) {
+            fatal("memory allocation failed\n");
+        }
+        return ptr;
+    }
+
+    static unsigned int toClass(size_t size) {
+        return size == 0 ? 0 : (size - 1) / GRANULE;
+    }
+
+    void *allocateImpl(size_t size) {
+        this->stats.alloc++;
+        if(size > MAX_POOLED_SIZE) {
+            return mallocOrAbort(size);
+        }
+
+        const unsigned int index = toClass(size);
+        FreeBlock *block = this->freeLists[index];
+        if(block != nullptr) {
+            this->freeLists[index] = block->next;
+            this->cachedNums[index]--;
+            this->stats.reuse++;
+            this->stats.cached--;
+            this->stats.cachedBytes -= (index + 1) * GRANULE;
+            return block;
+        }
+        return mallocOrAbort((index + 1) * GRANULE); // round up for reuse by other objects of same class
+    }
+
+    void deallocateImpl(void *ptr, size_t size) noexcept {
+        this->stats.free++;
+        const unsigned int index = toClass(size);
+        if(size > MAX_POOLED_SIZE || this->cachedNums[index] == MAX_CACHED_NUM) {
+            ::free(ptr);
+            return;
+        }
+
+        auto *block = static_cast<FreeBlock *>(ptr);
+        block->next = this->freeLists[index];
+        this->freeLists[index] = block;
+        this->cachedNums[index]++;
+        this->stats.cached++;
+        this->stats.cachedBytes += (index + 1) * GRANULE;
+    }
+};
+
+} // namespace ydsh
+
+#endif //YDSH_OBJECT_POOL_H
@@ -75,6 +75,36 @@ namespace ydsh {
     OP(LOOKUP_HASH  , 0, -2) \
     OP(REF_EQ       , 0, -1) \
     OP(REF_NE       , 0, -1) \
+    OP(ADD_INT      , 0, -1) \
+    OP(SUB_INT      , 0, -1) \
+    OP(MUL_INT      , 0, -1) \
+    OP(DIV_INT      , 0, -1) \
+    OP(MOD_INT      , 0, -1) \
+    OP(AND_INT      , 0, -1) \
+    OP(OR_INT       , 0, -1) \
+    OP(XOR_INT      , 0, -1) \
+    OP(EQ_INT       , 0, -1) \
+    OP(NE_INT       , 0, -1) \
+    OP(LT_INT       , 0, -1) \
+    OP(GT_INT       , 0, -1) \
+    OP(LE_INT       , 0, -1) \
+    OP(GE_INT       , 0, -1) \
+    OP(ADD_FLOAT    , 0, -1) \
+    OP(SUB_FLOAT    , 0, -1) \
+    OP(MUL_FLOAT    , 0, -1) \
+    OP(DIV_FLOAT    , 0, -1) \
+    OP(EQ_FLOAT     , 0, -1) \
+    OP(NE_FLOAT     , 0, -1) \
+    OP(LT_FLOAT     , 0, -1) \
+    OP(GT_FLOAT     , 0, -1) \
+    OP(LE_FLOAT     , 0, -1) \
+    OP(GE_FLOAT     , 0, -1) \
+    OP(EQ_STR       , 0, -1) \
+    OP(NE_STR       , 0, -1) \
+    OP(LT_STR       , 0, -1) \
+    OP(GT_STR       , 0, -1) \
+    OP(LE_STR       , 0, -1) \
+    OP(GE_STR       , 0, -1) \
     OP(FORK         , 3,  1) \
     OP(PIPELINE    , -1,  1) \
     OP(PIPELINE_LP , -1,  1) \
@@ -97,7 +127,11 @@ namespace ydsh {
     OP(CHECK_UNWRAP , 0,  0) \
     OP(TRY_UNWRAP   , 2,  0) \
     OP(NEW_INVALID  , 0,  1) \
-    OP(RECLAIM_LOCAL, 2,  0)
+    OP(RECLAIM_LOCAL, 2,  0) \
+    OP(LOAD_LOCAL2  , 2,  2) \
+    OP(INC_LOCAL    , 2,  0) \
+    OP(DEC_LOCAL    , 2,  0) \
+    OP(INTERP_N     , 1,  0)
 
 enum class OpCode : unsigned char {
 #define GEN_OPCODE(CODE, N, S) CODE,
@@ -105,6 +139,12 @@ enum class OpCode : unsigned char {
 #undef GEN_OPCODE
 };
 
+constexpr unsigned int OPCODE_SIZE = 0
+#define GEN_COUNT(CODE, N, S) + 1
+    OPCODE_LIST(GEN_COUNT)
+#undef GEN_COUNT
+;
+
 int getByteSize(OpCode code);
 
 bool isTypeOp(OpCode code);
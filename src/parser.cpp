@@ -204,7 +204,7 @@ std::unique_ptr<TypeNode> Parser::parse_basicOrReifiedType(Token token) {
     auto typeToken = std::make_unique<BaseTypeNode>(token, this->lexer->toName(token));
     if(!HAS_NL() && CUR_KIND() == TYPE_OPEN) {
         this->consume();
-        std::vector<std::unique_ptr<TypeNode>> types;
+        NodeVector<TypeNode> types;
         types.push_back(TRY(this->parse_typeName(false)));
 
         while(CUR_KIND() == TYPE_SEP) {
@@ -218,7 +218,7 @@ std::unique_ptr<TypeNode> Parser::parse_basicOrReifiedType(Token token) {
 }
 
 static std::unique_ptr<TypeNode> createTupleOrBasicType(
-        Token open, std::vector<std::unique_ptr<TypeNode>> &&types,
+        Token open, NodeVector<TypeNode> &&types,
         Token close, unsigned int commaCount) {
     if(commaCount == 0) {
         auto type = std::move(types[0]);
@@ -238,7 +238,7 @@ std::unique_ptr<TypeNode> Parser::parse_typeNameImpl() {
     case PTYPE_OPEN: {
         Token openToken = this->expect(PTYPE_OPEN);  // always success
         unsigned int count = 0;
-        std::vector<std::unique_ptr<TypeNode>> types;
+        NodeVector<TypeNode> types;
         while(CUR_KIND() != PTYPE_CLOSE) {
             types.push_back(TRY(this->parse_typeName(false)));
             if(CUR_KIND() == TYPE_SEP) {
@@ -260,7 +260,7 @@ std::unique_ptr<TypeNode> Parser::parse_typeNameImpl() {
     }
     case ATYPE_OPEN: {
         Token token = this->expect(ATYPE_OPEN);  // always success
-        std::vector<std::unique_ptr<TypeNode>> types;
+        NodeVector<TypeNode> types;
         types.push_back(TRY(this->parse_typeName(false)));
         bool isMap = CUR_KIND() == TYPE_MSEP;
         auto tempNode = std::make_unique<BaseTypeNode>(token, isMap ? TYPE_MAP : TYPE_ARRAY);
@@ -293,7 +293,7 @@ std::unique_ptr<TypeNode> Parser::parse_typeNameImpl() {
             // parse return type
             unsigned int pos = token.pos;
             auto retNode = TRY(this->parse_typeName(false));
-            std::vector<std::unique_ptr<TypeNode>> types;
+            NodeVector<TypeNode> types;
 
             if(CUR_KIND() == TYPE_SEP) {   // ,[
                 this->consume();    // TYPE_SEP
@@ -981,7 +981,7 @@ std::unique_ptr<Node> Parser::parse_suffixExpression() {
 
 static std::unique_ptr<Node> createTupleOrGroup(
         Token open,
-        std::vector<std::unique_ptr<Node>> &&nodes,
+        NodeVector<Node> &&nodes,
         Token close, unsigned int commaCount) {
     if(commaCount == 0) {
         auto node = std::move(nodes[0]);
@@ -1036,7 +1036,7 @@ std::unique_ptr<Node> Parser::parse_primaryExpression() {
     case LP: {  // group or tuple
         Token openToken = this->expect(LP); // always success
         unsigned int count = 0;
-        std::vector<std::unique_ptr<Node>> nodes;
+        NodeVector<Node> nodes;
         do {
             nodes.push_back(TRY(this->parse_expression()));
             if(CUR_KIND() == COMMA) {
@@ -1262,7 +1262,7 @@ std::unique_ptr<Node> Parser::parse_stringExpression() {
 
 std::unique_ptr<Node> Parser::toAccessNode(Token token) const {
     std::unique_ptr<Node> node;
-    std::vector<std::unique_ptr<VarNode>> nodes;
+    NodeVector<VarNode> nodes;
 
     const char *ptr = this->lexer->toStrRef(token).data();
     for(unsigned int index = token.size - 1; index != 0; index--) {
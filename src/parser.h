@@ -30,7 +30,7 @@ namespace ydsh {
 class ArgsWrapper {
 private:
     Token token;
-    std::vector<std::unique_ptr<Node>> nodes;
+    NodeVector<Node> nodes;
 
 public:
     NON_COPYABLE(ArgsWrapper);
@@ -51,7 +51,7 @@ public:
         this->nodes.push_back(std::move(node));
     }
 
-    static std::vector<std::unique_ptr<Node>> extract(ArgsWrapper &&argsWrapper) {
+    static NodeVector<Node> extract(ArgsWrapper &&argsWrapper) {
         return std::move(argsWrapper.nodes);
     }
 };
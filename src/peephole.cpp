@@ -0,0 +1,612 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+
+#include "peephole.h"
+#include "opcode.h"
+
+namespace ydsh {
+
+void PeepholeStats::dump(FILE *fp) const {
+    const char *names[] = {
+#define GEN_NAME(E, D) #E,
+            EACH_PEEPHOLE_RULE(GEN_NAME)
+#undef GEN_NAME
+    };
+    const char *descs[] = {
+#define GEN_DESC(E, D) D,
+            EACH_PEEPHOLE_RULE(GEN_DESC)
+#undef GEN_DESC
+    };
+
+    fprintf(fp, "code objects: %u (skipped: %u)\n", this->codeCount, this->skipCount);
+    fprintf(fp, "code size: %lu -> %lu bytes", this->oldSize, this->newSize);
+    if(this->oldSize > 0) {
+        fprintf(fp, " (%.1f%%)", (static_cast<double>(this->newSize) - this->oldSize) * 100.0 / this->oldSize);
+    }
+    fputc('\n', fp);
+    fputs("rewrite:\n", fp);
+    for(unsigned int i = 0; i < arraySize(names); i++) {
+        fprintf(fp, "  %-13s %6u  %s\n", names[i], this->ruleCount[i], descs[i]);
+    }
+    fflush(fp);
+}
+
+namespace {
+
+enum : unsigned int {
+    NO_INSN = static_cast<unsigned int>(-1),
+    MAX_JUMP_HOP = 8,
+};
+
+struct Insn {
+    enum State : unsigned char {
+        KEEP,       // emit original bytes
+        REWRITTEN,  // emit code (new instruction)
+        MERGED,     // merged into leader
+        REMOVED,
+    };
+
+    unsigned int addr;  // original address
+    unsigned int size;  // original byte size (including opcode)
+    OpCode op;          // current opcode
+    State state;
+
+    unsigned char code[5];
+    unsigned char codeSize;
+
+    /**
+     * instruction index of jump target (BRANCH, GOTO, TRY_UNWRAP, ENTER_FINALLY, FORK)
+     */
+    unsigned int target;
+
+    /**
+     * for MERGED
+     */
+    unsigned int leader;
+
+    unsigned int newAddr;
+};
+
+class CodeRewriter {
+private:
+    const unsigned char *code;
+    const unsigned int codeSize;
+
+    std::vector<Insn> insns;
+
+    /**
+     * original address to instruction index (if not instruction boundary, NO_INSN).
+     * indexOf[codeSize] indicates end of code
+     */
+    std::vector<unsigned int> indexOf;
+
+    /**
+     * instruction indexes which are referred from exception entries or jump tables
+     */
+    std::vector<unsigned int> extraTargets;
+
+    /**
+     * if true, the instruction may be reached from other than previous instruction
+     */
+    std::vector<bool> boundary;
+
+    unsigned int endAddr{0};
+
+    unsigned int ruleCount[PEEPHOLE_RULE_SIZE]{};
+
+public:
+    CodeRewriter(const unsigned char *code, unsigned int codeSize) : code(code), codeSize(codeSize) {}
+
+    bool decode();
+
+    /**
+     *
+     * @param addr
+     * @return
+     * if addr indicates start of instruction or end of code, return true
+     */
+    bool isInsnAddr(unsigned int addr) const {
+        return addr <= this->codeSize && this->indexOf[addr] != NO_INSN;
+    }
+
+    bool addExtraTarget(unsigned int addr) {
+        if(!this->isInsnAddr(addr)) {
+            return false;
+        }
+        this->extraTargets.push_back(this->indexOf[addr]);
+        return true;
+    }
+
+    void optimize() {
+        this->threadJumps();
+        this->markBoundary();
+        for(unsigned int i = 0; i < this->insns.size(); i++) {
+            if(this->insns[i].state == Insn::KEEP) {
+                this->applyRules(i);
+            }
+        }
+        this->removeGotoNext();
+        this->layout();
+    }
+
+    /**
+     *
+     * @param buf
+     * @return
+     * if relative offset is out of range, return false
+     */
+    bool emit(FlexBuffer<unsigned char> &buf) const;
+
+    unsigned int newAddrOf(unsigned int addr) const {
+        unsigned int index = this->indexOf[addr];
+        return index == this->insns.size() ? this->endAddr : this->insns[index].newAddr;
+    }
+
+    void addCount(PeepholeStats &stats) const {
+        for(unsigned int i = 0; i < PEEPHOLE_RULE_SIZE; i++) {
+            stats.ruleCount[i] += this->ruleCount[i];
+        }
+    }
+
+private:
+    static bool hasTarget(OpCode op) {
+        switch(op) {
+        case OpCode::BRANCH:
+        case OpCode::GOTO:
+        case OpCode::TRY_UNWRAP:
+        case OpCode::ENTER_FINALLY:
+        case OpCode::FORK:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool isPipeline(OpCode op) {
+        return op == OpCode::PIPELINE || op == OpCode::PIPELINE_LP;
+    }
+
+    void count(PeepholeRule rule) {
+        this->ruleCount[static_cast<unsigned int>(rule)]++;
+    }
+
+    unsigned char operand8(const Insn &insn, unsigned int offset) const {
+        return insn.state == Insn::REWRITTEN ? insn.code[1 + offset] : this->code[insn.addr + 1 + offset];
+    }
+
+    /**
+     *
+     * @param index
+     * @param len
+     * @return
+     * if following len instructions can be merged into instruction of index, return true.
+     */
+    bool follows(unsigned int index, unsigned int len) const {
+        if(index + len >= this->insns.size()) {
+            return false;
+        }
+        for(unsigned int i = index + 1; i <= index + len; i++) {
+            if(this->boundary[i] || this->insns[i].state != Insn::KEEP) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void rewrite(unsigned int index, OpCode op, unsigned char v1, unsigned char v2) {
+        auto &insn = this->insns[index];
+        insn.state = Insn::REWRITTEN;
+        insn.op = op;
+        insn.code[0] = static_cast<unsigned char>(op);
+        insn.code[1] = v1;
+        insn.code[2] = v2;
+        insn.codeSize = 3;
+    }
+
+    void rewriteGoto(unsigned int index, unsigned int target) {
+        auto &insn = this->insns[index];
+        insn.state = Insn::REWRITTEN;
+        insn.op = OpCode::GOTO;
+        insn.code[0] = static_cast<unsigned char>(OpCode::GOTO);
+        insn.codeSize = 5;
+        insn.target = target;
+    }
+
+    void merge(unsigned int leader, unsigned int len) {
+        for(unsigned int i = leader + 1; i <= leader + len; i++) {
+            this->insns[i].state = Insn::MERGED;
+            this->insns[i].leader = leader;
+        }
+    }
+
+    void remove(unsigned int index) {
+        this->insns[index].state = Insn::REMOVED;
+    }
+
+    void threadJumps();
+
+    void markBoundary();
+
+    void applyRules(unsigned int index);
+
+    void removeGotoNext();
+
+    void layout();
+};
+
+bool CodeRewriter::decode() {
+    this->indexOf.assign(this->codeSize + 1, NO_INSN);
+    for(unsigned int i = 0; i < this->codeSize;) {
+        auto op = static_cast<OpCode>(this->code[i]);
+        if(static_cast<unsigned int>(op) >= OPCODE_SIZE) {
+            return false;
+        }
+        int byteSize = getByteSize(op);
+        unsigned int size;
+        if(byteSize < 0) {
+            if(i + 1 >= this->codeSize) {
+                return false;
+            }
+            size = 2 + 2 * this->code[i + 1];
+        } else {
+            size = 1 + byteSize;
+        }
+        if(i + size > this->codeSize) {
+            return false;
+        }
+        this->indexOf[i] = this->insns.size();
+        Insn insn{};
+        insn.addr = i;
+        insn.size = size;
+        insn.op = op;
+        insn.state = Insn::KEEP;
+        insn.target = NO_INSN;
+        insn.leader = NO_INSN;
+        this->insns.push_back(insn);
+        i += size;
+    }
+    this->indexOf[this->codeSize] = this->insns.size();
+
+    // resolve jump target
+    for(auto &insn : this->insns) {
+        unsigned int target;
+        switch(insn.op) {
+        case OpCode::BRANCH:
+        case OpCode::TRY_UNWRAP:
+        case OpCode::ENTER_FINALLY:
+            target = insn.addr + read16(this->code, insn.addr + 1);
+            break;
+        case OpCode::FORK:
+            target = insn.addr + read16(this->code, insn.addr + 2);
+            break;
+        case OpCode::GOTO:
+            target = read32(this->code, insn.addr + 1);
+            break;
+        case OpCode::PIPELINE:
+        case OpCode::PIPELINE_LP:
+            for(unsigned int i = 0; i < this->code[insn.addr + 1]; i++) {
+                target = insn.addr + read16(this->code, insn.addr + 2 + i * 2);
+                if(target > this->codeSize || this->indexOf[target] == NO_INSN) {
+                    return false;
+                }
+            }
+            continue;
+        default:
+            continue;
+        }
+        if(target > this->codeSize || this->indexOf[target] == NO_INSN) {
+            return false;
+        }
+        insn.target = this->indexOf[target];
+    }
+    return true;
+}
+
+void CodeRewriter::threadJumps() {
+    const unsigned int size = this->insns.size();
+    for(unsigned int i = 0; i < size; i++) {
+        auto &insn = this->insns[i];
+        if(insn.op != OpCode::GOTO && insn.op != OpCode::BRANCH && insn.op != OpCode::TRY_UNWRAP) {
+            continue;
+        }
+        unsigned int target = insn.target;
+        for(unsigned int hop = 0; hop < MAX_JUMP_HOP && target < size; hop++) {
+            auto &next = this->insns[target];
+            if(next.op != OpCode::GOTO || next.target == target) {
+                break;
+            }
+            target = next.target;
+        }
+        if(target == insn.target || (insn.op != OpCode::GOTO && target <= i)) {
+            continue;   // relative offset is always forward
+        }
+        insn.target = target;
+        this->count(PeepholeRule::JUMP_THREAD);
+    }
+}
+
+void CodeRewriter::markBoundary() {
+    this->boundary.assign(this->insns.size() + 1, false);
+    for(unsigned int i = 0; i < this->insns.size(); i++) {
+        auto &insn = this->insns[i];
+        if(hasTarget(insn.op)) {
+            this->boundary[insn.target] = true;
+        }
+        if(insn.op == OpCode::ENTER_FINALLY) {
+            this->boundary[i + 1] = true;   // return address of EXIT_FINALLY
+        } else if(isPipeline(insn.op)) {
+            for(unsigned int j = 0; j < this->code[insn.addr + 1]; j++) {
+                unsigned int target = insn.addr + read16(this->code, insn.addr + 2 + j * 2);
+                this->boundary[this->indexOf[target]] = true;
+            }
+        }
+    }
+    for(auto &e : this->extraTargets) {
+        this->boundary[e] = true;
+    }
+}
+
+void CodeRewriter::applyRules(unsigned int index) {
+    auto &insn = this->insns[index];
+    switch(insn.op) {
+    case OpCode::LOAD_LOCAL:
+        if(this->follows(index, 3) && this->insns[index + 1].op == OpCode::PUSH_INT &&
+           (this->insns[index + 2].op == OpCode::ADD_INT || this->insns[index + 2].op == OpCode::SUB_INT) &&
+           this->insns[index + 3].op == OpCode::STORE_LOCAL &&
+           this->operand8(insn, 0) == this->operand8(this->insns[index + 3], 0)) {
+            bool inc = this->insns[index + 2].op == OpCode::ADD_INT;
+            this->rewrite(index, inc ? OpCode::INC_LOCAL : OpCode::DEC_LOCAL,
+                          this->operand8(insn, 0), this->operand8(this->insns[index + 1], 0));
+            this->merge(index, 3);
+            this->count(inc ? PeepholeRule::INC_LOCAL : PeepholeRule::DEC_LOCAL);
+        } else if(this->follows(index, 1) && this->insns[index + 1].op == OpCode::LOAD_LOCAL) {
+            this->rewrite(index, OpCode::LOAD_LOCAL2,
+                          this->operand8(insn, 0), this->operand8(this->insns[index + 1], 0));
+            this->merge(index, 1);
+            this->count(PeepholeRule::LOAD_LOCAL2);
+        }
+        break;
+    case OpCode::PUSH_TRUE:
+    case OpCode::PUSH_FALSE:
+        if(this->follows(index, 1) && this->insns[index + 1].op == OpCode::BRANCH) {
+            if(insn.op == OpCode::PUSH_TRUE) { // never jump
+                this->remove(index);
+                this->remove(index + 1);
+            } else {    // always jump
+                this->rewriteGoto(index, this->insns[index + 1].target);
+                this->merge(index, 1);
+            }
+            this->count(PeepholeRule::CONST_BRANCH);
+        }
+        break;
+    case OpCode::DUP:
+        if(this->follows(index, 1) && this->insns[index + 1].op == OpCode::POP) {
+            this->remove(index);
+            this->remove(index + 1);
+            this->count(PeepholeRule::DUP_POP);
+        }
+        break;
+    case OpCode::RECLAIM_LOCAL: {
+        unsigned int offset = this->operand8(insn, 0);
+        unsigned int stop = offset + this->operand8(insn, 1);
+        unsigned int len = 0;
+        for(; this->follows(index + len, 1) && this->insns[index + len + 1].op == OpCode::RECLAIM_LOCAL; len++) {
+            auto &next = this->insns[index + len + 1];
+            unsigned int nextOffset = this->operand8(next, 0);
+            unsigned int nextStop = nextOffset + this->operand8(next, 1);
+            if(nextOffset > stop || offset > nextStop) {
+                break;  // not contiguous
+            }
+            unsigned int newOffset = std::min(offset, nextOffset);
+            unsigned int newStop = std::max(stop, nextStop);
+            if(newStop - newOffset > UINT8_MAX) {
+                break;
+            }
+            offset = newOffset;
+            stop = newStop;
+            this->count(PeepholeRule::MERGE_RECLAIM);
+        }
+        if(len > 0) {
+            this->rewrite(index, OpCode::RECLAIM_LOCAL, offset, stop - offset);
+            this->merge(index, len);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void CodeRewriter::removeGotoNext() {
+    const unsigned int size = this->insns.size();
+    for(unsigned int i = 0; i < size; i++) {
+        auto &insn = this->insns[i];
+        if(insn.op != OpCode::GOTO || (insn.state != Insn::KEEP && insn.state != Insn::REWRITTEN)) {
+            continue;
+        }
+        unsigned int next = i + 1;
+        for(; next < size && (this->insns[next].state == Insn::MERGED || this->insns[next].state == Insn::REMOVED); next++);
+        unsigned int target = insn.target;
+        for(; target < size && this->insns[target].state == Insn::REMOVED; target++);
+        if(target != next) {
+            continue;
+        }
+        for(unsigned int j = i; j < next; j++) {
+            this->remove(j);    // also remove merged instructions
+        }
+        this->count(PeepholeRule::GOTO_NEXT);
+    }
+}
+
+void CodeRewriter::layout() {
+    unsigned int pos = 0;
+    for(auto &insn : this->insns) {
+        switch(insn.state) {
+        case Insn::KEEP:
+            insn.newAddr = pos;
+            pos += insn.size;
+            break;
+        case Insn::REWRITTEN:
+            insn.newAddr = pos;
+            pos += insn.codeSize;
+            break;
+        case Insn::MERGED:
+            insn.newAddr = this->insns[insn.leader].newAddr;
+            break;
+        case Insn::REMOVED:
+            insn.newAddr = pos; // next instruction address
+            break;
+        }
+    }
+    this->endAddr = pos;
+}
+
+static bool writeOffset16(FlexBuffer<unsigned char> &buf, unsigned int index,
+                          unsigned int baseIndex, unsigned int location) {
+    if(baseIndex > location || location - baseIndex > UINT16_MAX) {
+        return false;
+    }
+    write16(buf.get() + index, location - baseIndex);
+    return true;
+}
+
+bool CodeRewriter::emit(FlexBuffer<unsigned char> &buf) const {
+    for(auto &insn : this->insns) {
+        if(insn.state == Insn::MERGED || insn.state == Insn::REMOVED) {
+            continue;
+        }
+        const unsigned int base = buf.size();
+        assert(base == insn.newAddr);
+        if(insn.state == Insn::KEEP) {
+            buf.append(this->code + insn.addr, insn.size);
+        } else {
+            buf.append(insn.code, insn.codeSize);
+        }
+
+        // relocate jump target
+        const unsigned int target = insn.target == NO_INSN ? 0 :
+                insn.target == this->insns.size() ? this->endAddr : this->insns[insn.target].newAddr;
+        switch(insn.op) {
+        case OpCode::BRANCH:
+        case OpCode::TRY_UNWRAP:
+        case OpCode::ENTER_FINALLY:
+            if(!writeOffset16(buf, base + 1, base, target)) {
+                return false;
+            }
+            break;
+        case OpCode::FORK:
+            if(!writeOffset16(buf, base + 2, base, target)) {
+                return false;
+            }
+            break;
+        case OpCode::GOTO:
+            write32(buf.get() + base + 1, target);
+            break;
+        case OpCode::PIPELINE:
+        case OpCode::PIPELINE_LP:
+            for(unsigned int i = 0; i < this->code[insn.addr + 1]; i++) {
+                unsigned int old = insn.addr + read16(this->code, insn.addr + 2 + i * 2);
+                if(!writeOffset16(buf, base + 2 + i * 2, base, this->newAddrOf(old))) {
+                    return false;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool PeepholeOptimizer::operator()(FlexBuffer<unsigned char> &codeBuffer, std::vector<DSValue> &constBuffer,
+                                   const std::vector<unsigned int> &jumpTables,
+                                   FlexBuffer<LineNumEntry> &lineNumEntries,
+                                   std::vector<ExceptionEntry> &exceptEntries) {
+    const unsigned int oldSize = codeBuffer.size();
+    this->stats.codeCount++;
+    this->stats.oldSize += oldSize;
+
+    CodeRewriter rewriter(codeBuffer.get(), oldSize);
+    bool s = rewriter.decode();
+    for(unsigned int i = 0; s && i < jumpTables.size(); i++) {
+        for(auto &e : typeAs<MapObject>(constBuffer[jumpTables[i]]).getValueMap()) {
+            if(!(s = rewriter.addExtraTarget(e.second.asNum()))) {
+                break;
+            }
+        }
+    }
+    for(unsigned int i = 0; s && i < exceptEntries.size(); i++) {
+        auto &e = exceptEntries[i];
+        s = rewriter.addExtraTarget(e.begin) && rewriter.addExtraTarget(e.end) && rewriter.addExtraTarget(e.dest);
+    }
+    for(unsigned int i = 0; s && i < lineNumEntries.size(); i++) {
+        s = rewriter.isInsnAddr(lineNumEntries[i].address);
+    }
+
+    FlexBuffer<unsigned char> newBuffer;
+    if(s) {
+        rewriter.optimize();
+        s = rewriter.emit(newBuffer);
+    }
+    if(!s) {
+        this->stats.skipCount++;
+        this->stats.newSize += oldSize;
+        return false;
+    }
+
+    // relocate jump table
+    for(auto &index : jumpTables) {
+        auto &map = typeAs<MapObject>(constBuffer[index]);
+        std::vector<std::pair<DSValue, unsigned int>> entries;
+        for(auto &e : map.getValueMap()) {
+            entries.emplace_back(e.first, rewriter.newAddrOf(e.second.asNum()));
+        }
+        for(auto &e : entries) {
+            map.set(std::move(e.first), DSValue::createNum(e.second));
+        }
+    }
+
+    // relocate exception entry
+    for(auto &e : exceptEntries) {
+        e.begin = rewriter.newAddrOf(e.begin);
+        e.end = rewriter.newAddrOf(e.end);
+        e.dest = rewriter.newAddrOf(e.dest);
+    }
+
+    // relocate line number entry (if multiple entries indicate same address, last one is used)
+    FlexBuffer<LineNumEntry> newEntries;
+    for(auto &e : lineNumEntries) {
+        unsigned int address = rewriter.newAddrOf(e.address);
+        if(!newEntries.empty() && newEntries.back().address == address) {
+            newEntries.pop_back();
+        }
+        if(newEntries.empty() || newEntries.back().lineNum != e.lineNum) {
+            newEntries.push_back({address, e.lineNum});
+        }
+    }
+    lineNumEntries = std::move(newEntries);
+
+    this->stats.newSize += newBuffer.size();
+    rewriter.addCount(this->stats);
+    codeBuffer = std::move(newBuffer);
+    return true;
+}
+
+} // namespace ydsh
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_PEEPHOLE_H
+#define YDSH_PEEPHOLE_H
+
+#include <cstdio>
+#include <vector>
+
+#include "object.h"
+#include "misc/buffer.hpp"
+
+namespace ydsh {
+
+#define EACH_PEEPHOLE_RULE(OP) \
+    OP(LOAD_LOCAL2  , "LOAD_LOCAL x; LOAD_LOCAL y => LOAD_LOCAL2 x y") \
+    OP(INC_LOCAL    , "LOAD_LOCAL x; PUSH_INT n; ADD_INT; STORE_LOCAL x => INC_LOCAL x n") \
+    OP(DEC_LOCAL    , "LOAD_LOCAL x; PUSH_INT n; SUB_INT; STORE_LOCAL x => DEC_LOCAL x n") \
+    OP(CONST_BRANCH , "PUSH_TRUE/PUSH_FALSE; BRANCH => (removed)/GOTO") \
+    OP(DUP_POP      , "DUP; POP => (removed)") \
+    OP(JUMP_THREAD  , "jump to GOTO => jump to final target") \
+    OP(GOTO_NEXT    , "GOTO to next instruction => (removed)") \
+    OP(MERGE_RECLAIM, "RECLAIM_LOCAL; RECLAIM_LOCAL => RECLAIM_LOCAL")
+
+enum class PeepholeRule : unsigned int {
+#define GEN_ENUM(E, D) E,
+    EACH_PEEPHOLE_RULE(GEN_ENUM)
+#undef GEN_ENUM
+};
+
+constexpr unsigned int PEEPHOLE_RULE_SIZE = 0
+#define GEN_COUNT(E, D) + 1
+    EACH_PEEPHOLE_RULE(GEN_COUNT)
+#undef GEN_COUNT
+;
+
+/**
+ * statistics of peephole optimization (accumulated over multiple code objects)
+ */
+struct PeepholeStats {
+    unsigned int codeCount{0};
+
+    /**
+     * number of code objects left unchanged due to offset overflow or unknown instruction
+     */
+    unsigned int skipCount{0};
+
+    unsigned long oldSize{0};
+    unsigned long newSize{0};
+
+    unsigned int ruleCount[PEEPHOLE_RULE_SIZE]{};
+
+    void dump(FILE *fp) const;
+};
+
+/**
+ * rewrite finalized byte code (all labels have already been resolved).
+ * after rewriting, relocate branch offsets, jump tables (of case expression),
+ * line number entries and exception entries.
+ *
+ * if cannot rewrite (ex. relative offset does not fit in 16bit), leave all of them unchanged.
+ */
+class PeepholeOptimizer {
+private:
+    PeepholeStats &stats;
+
+public:
+    explicit PeepholeOptimizer(PeepholeStats &stats) : stats(stats) {}
+
+    /**
+     *
+     * @param codeBuffer
+     * @param constBuffer
+     * @param jumpTables
+     * indexes of constant pool which hold jump table (MapObject) of case expression
+     * @param lineNumEntries
+     * @param exceptEntries
+     * not contain sentinel
+     * @return
+     * if code is rewritten, return true
+     */
+    bool operator()(FlexBuffer<unsigned char> &codeBuffer, std::vector<DSValue> &constBuffer,
+                    const std::vector<unsigned int> &jumpTables, FlexBuffer<LineNumEntry> &lineNumEntries,
+                    std::vector<ExceptionEntry> &exceptEntries);
+};
+
+} // namespace ydsh
+
+#endif //YDSH_PEEPHOLE_H
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/time.h>
+#include <ctime>
+
+#include <algorithm>
+#include <vector>
+
+#include "profiler.h"
+#include "vm.h"
+
+namespace ydsh {
+
+/**
+ * if x86, read time stamp counter. otherwise, read monotonic clock (nano seconds)
+ */
+static unsigned long readCycle() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<unsigned long>(ts.tv_sec) * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+static void profileSignalHandler(int) {
+    setFlag(DSState::eventDesc, VMEvent::PROFILE);
+}
+
+static void appendFrame(std::string &out, const DSCode *code, unsigned int pc, bool withLine) {
+    if(code == nullptr) {
+        return;
+    }
+    if(!out.empty()) {
+        out += ';';
+    }
+    if(code->is(CodeKind::NATIVE)) {
+        out += "<native>";
+        return;
+    }
+
+    const auto *cc = static_cast<const CompiledCode *>(code);
+    switch(code->getKind()) {
+    case CodeKind::TOPLEVEL:
+        out += "<toplevel>";
+        break;
+    case CodeKind::FUNCTION:
+        out += "function ";
+        out += cc->getName();
+        break;
+    case CodeKind::USER_DEFINED_CMD:
+        out += "command ";
+        out += cc->getName();
+        break;
+    default:
+        break;
+    }
+    out += " (";
+    for(const char *ptr = cc->getSourceName(); *ptr != '\0'; ptr++) {
+        out += *ptr == ';' ? '_' : *ptr;   // ';' is frame separator of folded stack
+    }
+    if(withLine) {
+        out += ':';
+        out += std::to_string(cc->getLineNum(pc));
+    }
+    out += ')';
+}
+
+// ######################
+// ##     Profiler     ##
+// ######################
+
+std::unique_ptr<Profiler> Profiler::start(DSProfileMode mode, unsigned int interval) {
+    std::unique_ptr<Profiler> profiler(new Profiler(mode));
+    if(mode == DS_PROFILE_SAMPLE) {
+        struct sigaction action{};
+        action.sa_flags = SA_RESTART;
+        sigfillset(&action.sa_mask);
+        action.sa_handler = profileSignalHandler;
+        sigaction(SIGPROF, &action, &profiler->oldAction);
+
+        if(interval == 0) {
+            interval = DEFAULT_INTERVAL;
+        }
+        struct itimerval timer{};
+        timer.it_interval.tv_sec = interval / 1000000;
+        timer.it_interval.tv_usec = interval % 1000000;
+        timer.it_value = timer.it_interval;
+        if(setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+            return nullptr;
+        }
+    } else {
+        profiler->prevCycle = readCycle();
+        setFlag(DSState::eventDesc, VMEvent::PROFILE);
+    }
+    return profiler;
+}
+
+Profiler::~Profiler() {
+    if(this->mode == DS_PROFILE_SAMPLE) {
+        // stop timer before restoring handler (pending SIGPROF may terminate process)
+        struct itimerval timer{};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        sigaction(SIGPROF, &this->oldAction, nullptr);
+    }
+
+    SignalGuard guard;
+    unsetFlag(DSState::eventDesc, VMEvent::PROFILE);
+}
+
+void Profiler::fetch(const VMState &stack) {
+    if(this->mode == DS_PROFILE_SAMPLE) {
+        {
+            SignalGuard guard;
+            unsetFlag(DSState::eventDesc, VMEvent::PROFILE);
+        }
+        this->sample(stack);
+    } else {
+        this->count(stack);
+    }
+}
+
+void Profiler::sample(const VMState &stack) {
+    std::string key;
+    const auto &frames = stack.getFrames();
+    for(unsigned int i = 1; i < frames.size(); i++) {   // skip bottom frame (always empty)
+        appendFrame(key, frames[i].code, frames[i].pc, true);
+    }
+    appendFrame(key, stack.getFrame().code, stack.getFrame().pc, true);
+    this->samples[key]++;
+}
+
+void Profiler::count(const VMState &stack) {
+    // count cycles of previous instruction
+    const unsigned long now = readCycle();
+    if(this->curStat != nullptr) {
+        const unsigned long delta = now - this->prevCycle;
+        this->opCycles[static_cast<unsigned int>(this->prevOp)] += delta;
+        this->curStat->cycles += delta;
+    }
+
+    const auto &frame = stack.getFrame();
+    const unsigned int depth = stack.getFrames().size();
+    if(frame.code != this->curCode || this->curStat == nullptr) {
+        std::string label;
+        appendFrame(label, frame.code, frame.pc, false);
+        this->curStat = &this->funcStats[label];
+        this->curCode = frame.code;
+    }
+    if(depth > this->curDepth) {
+        this->curStat->callCount++;
+    }
+    this->curDepth = depth;
+
+    const auto op = static_cast<OpCode>(frame.code->getCode()[frame.pc]);
+    this->opCount[static_cast<unsigned int>(op)]++;
+    this->curStat->insnCount++;
+    this->prevOp = op;
+
+    if(op == OpCode::HALT) {
+        /**
+         * after HALT, exit from VM. so, not count cycles until next evaluation.
+         * (code object may be released and its address may be reused)
+         */
+        this->curStat = nullptr;
+        this->curCode = nullptr;
+    }
+    this->prevCycle = readCycle();
+}
+
+void Profiler::dump(FILE *fp) const {
+    if(this->mode == DS_PROFILE_SAMPLE) {
+        std::vector<std::pair<std::string, unsigned long>> entries(this->samples.begin(), this->samples.end());
+        std::sort(entries.begin(), entries.end());
+        for(auto &e : entries) {
+            fprintf(fp, "%s %lu\n", e.first.c_str(), e.second);
+        }
+        fflush(fp);
+        return;
+    }
+
+    const char *opName[] = {
+#define GEN_NAME(CODE, N, S) #CODE,
+            OPCODE_LIST(GEN_NAME)
+#undef GEN_NAME
+    };
+
+    // sort by cycles
+    std::vector<unsigned int> ops;
+    for(unsigned int i = 0; i < OPCODE_SIZE; i++) {
+        if(this->opCount[i] > 0) {
+            ops.push_back(i);
+        }
+    }
+    std::sort(ops.begin(), ops.end(), [&](unsigned int x, unsigned int y) {
+        return this->opCycles[x] > this->opCycles[y];
+    });
+
+    fputs("### opcode profile ###\n", fp);
+    fprintf(fp, "%-16s %14s %16s\n", "OPCODE", "COUNT", "CYCLES");
+    for(auto &i : ops) {
+        fprintf(fp, "%-16s %14lu %16lu\n", opName[i], this->opCount[i], this->opCycles[i]);
+    }
+
+    std::vector<std::pair<std::string, FuncStat>> funcs(this->funcStats.begin(), this->funcStats.end());
+    std::sort(funcs.begin(), funcs.end(), [](const std::pair<std::string, FuncStat> &x,
+                                             const std::pair<std::string, FuncStat> &y) {
+        return x.second.cycles > y.second.cycles;
+    });
+
+    fputs("\n### function profile ###\n", fp);
+    fprintf(fp, "%10s %14s %16s  %s\n", "CALLS", "INSNS", "CYCLES", "NAME");
+    for(auto &e : funcs) {
+        fprintf(fp, "%10lu %14lu %16lu  %s\n",
+                e.second.callCount, e.second.insnCount, e.second.cycles, e.first.c_str());
+    }
+    fflush(fp);
+}
+
+} // namespace ydsh
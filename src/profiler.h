@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2020 Nagisa Sekiguchi
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef YDSH_PROFILER_H
+#define YDSH_PROFILER_H
+
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <ydsh/ydsh.h>
+
+#include "opcode.h"
+#include "state.h"
+#include "misc/noncopyable.h"
+
+namespace ydsh {
+
+/**
+ * VM profiler.
+ *
+ * in DS_PROFILE_SAMPLE mode, SIGPROF handler only sets VMEvent::PROFILE
+ * and call stack is recorded at next instruction fetch (avoid walking stack in signal handler).
+ * in DS_PROFILE_EXACT mode, VMEvent::PROFILE is always set and all of instruction fetch are counted.
+ */
+class Profiler {
+public:
+    /**
+     * default sampling interval (micro seconds)
+     */
+    static constexpr unsigned int DEFAULT_INTERVAL = 1000;
+
+private:
+    struct FuncStat {
+        unsigned long callCount{0};
+        unsigned long insnCount{0};
+        unsigned long cycles{0};
+    };
+
+    const DSProfileMode mode;
+
+    struct sigaction oldAction{};
+
+    /**
+     * folded call stack (root first, separated by ';') => sample count
+     */
+    std::unordered_map<std::string, unsigned long> samples;
+
+    /**
+     * for DS_PROFILE_EXACT
+     */
+    unsigned long opCount[OPCODE_SIZE]{};
+    unsigned long opCycles[OPCODE_SIZE]{};
+
+    /**
+     * callable label => stat
+     */
+    std::unordered_map<std::string, FuncStat> funcStats;
+
+    const DSCode *curCode{nullptr};
+
+    unsigned int curDepth{0};
+
+    /**
+     * stat of curCode.
+     * if null, not count cycles of previous instruction (ex. after HALT)
+     */
+    FuncStat *curStat{nullptr};
+
+    OpCode prevOp{OpCode::HALT};
+
+    unsigned long prevCycle{0};
+
+    explicit Profiler(DSProfileMode mode) : mode(mode) {}
+
+public:
+    NON_COPYABLE(Profiler);
+
+    /**
+     * install SIGPROF handler and start interval timer (only DS_PROFILE_SAMPLE), then set VMEvent::PROFILE
+     * @param mode
+     * @param interval
+     * sampling interval (micro seconds). if 0, use DEFAULT_INTERVAL
+     * @return
+     * if cannot start timer, return null
+     */
+    static std::unique_ptr<Profiler> start(DSProfileMode mode, unsigned int interval);
+
+    /**
+     * stop timer and restore old signal handler
+     */
+    ~Profiler();
+
+    /**
+     * called from VM::checkVMEvent before instruction fetch
+     * @param stack
+     */
+    void fetch(const VMState &stack);
+
+    /**
+     * in DS_PROFILE_SAMPLE mode, write folded stacks (for flamegraph.pl).
+     * in DS_PROFILE_EXACT mode, write per-opcode and per-function counters
+     * @param fp
+     */
+    void dump(FILE *fp) const;
+
+private:
+    void sample(const VMState &stack);
+
+    void count(const VMState &stack);
+};
+
+} // namespace ydsh
+
+#endif //YDSH_PROFILER_H
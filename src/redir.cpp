@@ -15,6 +15,9 @@
  */
 
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
 #include <climits>
 
 #include "redir.h"
@@ -50,6 +53,9 @@ static bool isPassingFD(const std::pair<RedirOP, DSValue> &pair) {
 }
 
 RedirObject::~RedirObject() {
+    if(this->outBuffer != nullptr) {
+        this->outBuffer->flush();
+    }
     this->restoreFDs();
     for(int fd : this->oldFds) {
         close(fd);
@@ -63,7 +69,69 @@ RedirObject::~RedirObject() {
     }
 }
 
+/**
+ * create anonymous regular file (memfd or unnamed temporary file)
+ * @return
+ * if failed, return -1
+ */
+static int createAnonymousFile() {
+    int fd = -1;
+#if defined(SYS_memfd_create) && defined(MFD_CLOEXEC)
+    fd = static_cast<int>(syscall(SYS_memfd_create, "ydsh-here-str", MFD_CLOEXEC));
+#endif
+#ifdef O_TMPFILE
+    if(fd < 0) {
+        fd = open("/tmp", O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    }
+#endif
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t size) {
+    while(size > 0) {
+        ssize_t r = write(fd, data, size);
+        if(r < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += r;
+        size -= r;
+    }
+    return true;
+}
+
+/**
+ * write here string to anonymous file and dup it to stdin.
+ * @param value
+ * @return
+ * if cannot create anonymous file, return -1.
+ * if other error, return errno
+ */
+static int doIOHereWithFile(const StringRef &value) {
+    int fd = createAnonymousFile();
+    if(fd < 0) {
+        return -1;
+    }
+    int errnum = 0;
+    if(!writeAll(fd, value.data(), value.size()) || !writeAll(fd, "\n", 1)
+        || lseek(fd, 0, SEEK_SET) < 0 || dup2(fd, STDIN_FILENO) < 0) {
+        errnum = errno;
+    }
+    close(fd);
+    return errnum;
+}
+
 static int doIOHere(const StringRef &value) {
+    if(value.size() + 1 > PIPE_BUF) {
+        // large here string is written to seekable file (not require writer process)
+        int errnum = doIOHereWithFile(value);
+        if(errnum > -1) {
+            return errnum;
+        }
+    }
+
     pipe_t pipe[1];
     initAllPipe(1, pipe);
 
@@ -109,7 +177,7 @@ static int doIOHere(const StringRef &value) {
  */
 static int redirectToFile(const DSValue &fileName, const char *mode, int targetFD) {
     if(fileName.hasType(TYPE::String)) {
-        FILE *fp = fopen(fileName.asStrRef().data(), mode);
+        FILE *fp = fopen(fileName.asCStr(), mode);
         if(fp == nullptr) {
             return errno;
         }
@@ -185,7 +253,18 @@ void RedirObject::passFDToExtProc() {
     }
 }
 
+bool RedirObject::hasPassingFD() const {
+    for(auto &e : this->ops) {
+        if(isPassingFD(e)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool RedirObject::redirect(DSState &st) {
+    st.outBuffer.flush();
+    this->outBuffer = &st.outBuffer;
     this->backupFDs();
     for(auto &pair : this->ops) {
         int r = redirectImpl(pair);
@@ -28,6 +28,8 @@
 
 namespace ydsh {
 
+class StdoutBuffer;
+
 constexpr unsigned int FD_BIT_0 = 1u << 0u;
 constexpr unsigned int FD_BIT_1 = 1u << 1u;
 constexpr unsigned int FD_BIT_2 = 1u << 2u;
@@ -188,6 +190,11 @@ private:
 
     int oldFds[3];
 
+    /**
+     * for flushing buffered output before restoring fds
+     */
+    StdoutBuffer *outBuffer{nullptr};
+
 public:
     NON_COPYABLE(RedirObject);
 
@@ -196,7 +203,7 @@ public:
     ~RedirObject();
 
     void addRedirOp(RedirOP op, DSValue &&arg) {
-        this->ops.emplace_back(op, std::move(arg));
+        this->ops.emplace_back(op, arg.materialize());
         this->backupFDset |= getChangedFD(op);
     }
 
@@ -209,6 +216,11 @@ public:
      */
     void passFDToExtProc();
 
+    /**
+     * if has FD object passing to command arguments, return true.
+     */
+    bool hasPassingFD() const;
+
     bool redirect(DSState &st);
 
 private:
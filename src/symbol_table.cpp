@@ -28,12 +28,12 @@ namespace ydsh {
 // ##     BlockScope     ##
 // ########################
 
-HandleOrError BlockScope::add(const std::string &symbolName, FieldHandle handle) {
-    auto pair = this->handleMap.insert({symbolName, handle});
+HandleOrError BlockScope::add(SymbolKey key, FieldHandle handle) {
+    auto pair = this->handleMap.insert(key.raw(), handle);
     if(!pair.second) {
         return Err(SymbolError::DEFINED);
     }
-    if(pair.first->second) {
+    if(*pair.first) {
         this->curVarIndex++;
     } else {
         this->shadowCount++;
@@ -41,14 +41,14 @@ HandleOrError BlockScope::add(const std::string &symbolName, FieldHandle handle)
     if(this->getCurVarIndex() > UINT8_MAX) {
         return Err(SymbolError::LIMIT);
     }
-    return Ok(&pair.first->second);
+    return Ok(pair.first);
 }
 
 // #########################
 // ##     GlobalScope     ##
 // #########################
 
-GlobalScope::GlobalScope(unsigned int &gvarCount) : gvarCount(gvarCount) {
+GlobalScope::GlobalScope(SymbolPool &pool, unsigned int &gvarCount) : gvarCount(gvarCount) {
     if(gvarCount == 0) {
         const char *blacklist[] = {
                 "eval",
@@ -57,25 +57,23 @@ GlobalScope::GlobalScope(unsigned int &gvarCount) : gvarCount(gvarCount) {
                 "command",
         };
         for(auto &e : blacklist) {
-            std::string name = CMD_SYMBOL_PREFIX;
-            name += e;
-            this->handleMap.emplace(std::move(name), FieldHandle());
+            this->handleMap.insert(SymbolKey(SymbolKind::UDC, pool.intern(e)).raw(), FieldHandle());
         }
     }
 }
 
-HandleOrError GlobalScope::addNew(const std::string &symbolName, const DSType &type,
+HandleOrError GlobalScope::addNew(SymbolKey key, const DSType &type,
                                   FieldAttribute attribute, unsigned short modID) {
     setFlag(attribute, FieldAttribute::GLOBAL);
     FieldHandle handle(type, this->gvarCount.get(), attribute, modID);
-    auto pair = this->handleMap.emplace(symbolName, handle);
+    auto pair = this->handleMap.insert(key.raw(), handle);
     if(!pair.second) {
         return Err(SymbolError::DEFINED);
     }
-    if(pair.first->second) {
+    if(*pair.first) {
         this->gvarCount.get()++;
     }
-    return Ok(&pair.first->second);
+    return Ok(pair.first);
 }
 
 
@@ -83,27 +81,27 @@ HandleOrError GlobalScope::addNew(const std::string &symbolName, const DSType &t
 // ##     ModuleScope     ##
 // #########################
 
-const FieldHandle *ModuleScope::lookupHandle(const std::string &symbolName) const {
+const FieldHandle *ModuleScope::lookupHandle(SymbolKey key) const {
     for(auto iter = this->scopes.crbegin(); iter != this->scopes.crend(); ++iter) {
-        auto *handle = (*iter).lookup(symbolName);
+        auto *handle = (*iter).lookup(key);
         if(handle != nullptr) {
             return handle;
         }
     }
-    return this->globalScope.lookup(symbolName);
+    return this->globalScope.lookup(key);
 }
 
-HandleOrError ModuleScope::newHandle(const std::string &symbolName,
+HandleOrError ModuleScope::newHandle(SymbolKey key,
                                      const DSType &type, FieldAttribute attribute) {
     if(this->inGlobalScope()) {
         if(this->builtin) {
             setFlag(attribute, FieldAttribute::BUILTIN);
         }
-        return this->globalScope.addNew(symbolName, type, attribute, this->modID);
+        return this->globalScope.addNew(key, type, attribute, this->modID);
     }
 
     FieldHandle handle(type, this->scopes.back().getCurVarIndex(), attribute, this->modID);
-    auto ret = this->scopes.back().add(symbolName, handle);
+    auto ret = this->scopes.back().add(key, handle);
     if(ret) {
         unsigned int varIndex = this->scopes.back().getCurVarIndex();
         if(varIndex > this->maxVarIndexStack.back()) {
@@ -137,15 +135,17 @@ void ModuleScope::exitFunc() {
     this->maxVarIndexStack.pop_back();
 }
 
-const char* ModuleScope::import(const ModType &type) {
+const char* ModuleScope::import(const ModType &type, const SymbolPool &pool) {
     for(auto &e : type.handleMap) {
         assert(!hasFlag(e.second.attr(), FieldAttribute::BUILTIN));
-        if(e.first[0] == '_' && this->getModID() != e.second.getModID()) {
+        SymbolKey key(e.first);
+        const char *name = key.kind() == SymbolKind::MOD ? nullptr : pool.get(key.id());
+        if(name != nullptr && name[0] == '_' && this->getModID() != e.second.getModID()) {
             continue;
         }
-        auto ret = this->globalScope.handleMap.insert(e);
-        if(!ret.second && ret.first->second.getModID() != type.getModID()) {
-            return ret.first->first.c_str();
+        auto ret = this->globalScope.handleMap.insert(e.first, e.second);
+        if(!ret.second && ret.first->getModID() != type.getModID()) {
+            return name != nullptr ? name : "";
         }
     }
     return nullptr;
@@ -162,23 +162,27 @@ void ModuleScope::clear() {
 // #####################
 
 ModType::ModType(unsigned int id, ydsh::DSType &superType, unsigned short modID,
-                 const std::unordered_map<std::string, ydsh::FieldHandle> &handleMap) :
+                 const HandleMap &handleMap) :
         DSType(id, &superType, TypeAttr::MODULE_TYPE), modID(modID) {
     assert(modID > 0);
     for(auto &e : handleMap) {
         if(e.second.getModID() == modID) {
-            this->handleMap.emplace(e.first, e.second);
+            this->handleMap.insert(e.first, e.second);
         }
     }
 }
 
 const FieldHandle* ModType::lookupFieldHandle(SymbolTable &symbolTable, const std::string &fieldName) const {
-    auto iter = this->handleMap.find(fieldName);
-    if(iter != this->handleMap.end()) {
-        if(fieldName[0] == '_' && symbolTable.currentModID() != iter->second.getModID()) {
+    unsigned int id = symbolTable.getSymbolPool().lookup(fieldName.c_str());
+    if(id == SymbolPool::NOT_FOUND) {
+        return nullptr;
+    }
+    auto *handle = this->handleMap.find(SymbolKey(SymbolKind::VAR, id).raw());
+    if(handle != nullptr) {
+        if(fieldName[0] == '_' && symbolTable.currentModID() != handle->getModID()) {
             return nullptr;
         }
-        return &iter->second;
+        return handle;
     }
     return nullptr;
 }
@@ -271,6 +275,54 @@ ModResult SymbolTable::tryToLoadModule(const char *scriptDir, const char *path,
     return ret;
 }
 
+/**
+ *
+ * @param scriptDir
+ * @param modPath
+ * @param path
+ * write resolved path (if already loaded or not regular file, write empty string)
+ * @return
+ * if not found, return false
+ */
+static bool resolvePath(const std::unordered_map<std::string, ModType *> &typeMap,
+                        const char *scriptDir, const char *modPath, std::string &path) {
+    path = expandDots(scriptDir, modPath);
+    if(typeMap.find(path) != typeMap.end()) {
+        path.clear();
+        return true;
+    }
+    mode_t mode = getStMode(path.c_str());
+    if(mode == 0 && errno == ENOENT) {
+        return false;
+    }
+    if(!S_ISREG(mode)) {
+        path.clear();
+    }
+    return true;
+}
+
+std::string SymbolTable::resolveModulePath(const char *scriptDir, const char *modPath) const {
+    auto &typeMap = this->modLoader.typeMap;
+    std::string path;
+    if(resolvePath(typeMap, scriptDir, modPath, path)) {
+        return path;
+    }
+    if(modPath[0] == '/' || scriptDir == nullptr || scriptDir[0] != '/'
+        || strcmp(scriptDir, SYSTEM_MOD_DIR) == 0) {
+        return "";
+    }
+
+    std::string dir = LOCAL_MOD_DIR;
+    expandTilde(dir);
+    if(strcmp(scriptDir, dir.c_str()) != 0 && resolvePath(typeMap, dir.c_str(), modPath, path)) {
+        return path;
+    }
+    if(resolvePath(typeMap, SYSTEM_MOD_DIR, modPath, path)) {
+        return path;
+    }
+    return "";
+}
+
 ModType& SymbolTable::createModType(const std::string &fullpath) {
     std::string name = ModType::toModName(this->cur().getModID());
     auto &modType = this->typePool.newType<ModType>(std::move(name),
@@ -283,12 +335,12 @@ ModType& SymbolTable::createModType(const std::string &fullpath) {
     return modType;
 }
 
-const FieldHandle* SymbolTable::lookupHandle(const std::string &symbolName) const {
-    auto handle = this->cur().lookupHandle(symbolName);
+const FieldHandle* SymbolTable::lookupHandle(SymbolKey key) const {
+    auto handle = this->cur().lookupHandle(key);
     if(handle == nullptr) {
         if(&this->cur() != &this->root()) {
             assert(this->root().inGlobalScope());
-            auto ret = this->root().lookupHandle(symbolName);
+            auto ret = this->root().lookupHandle(key);
             if(ret && hasFlag(ret->attr(), FieldAttribute::BUILTIN)) {
                 handle = ret;
             }
@@ -297,16 +349,16 @@ const FieldHandle* SymbolTable::lookupHandle(const std::string &symbolName) cons
     return handle;
 }
 
-HandleOrError SymbolTable::newHandle(const std::string &symbolName, const DSType &type,
+HandleOrError SymbolTable::newHandle(SymbolKey key, const DSType &type,
                                      FieldAttribute attribute) {
     if(this->cur().inGlobalScope() && &this->cur() != &this->root()) {
         assert(this->root().inGlobalScope());
-        auto handle = this->root().lookupHandle(symbolName);
+        auto handle = this->root().lookupHandle(key);
         if(handle && hasFlag(handle->attr(), FieldAttribute::BUILTIN)) {
             return Err(SymbolError::DEFINED);
         }
     }
-    return this->cur().newHandle(symbolName, type, attribute);
+    return this->cur().newHandle(key, type, attribute);
 }
 
 unsigned int SymbolTable::getTermHookIndex() {
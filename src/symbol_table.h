@@ -18,16 +18,99 @@
 #define YDSH_SYMBOL_TABLE_H
 
 #include <cassert>
+#include <deque>
 #include <functional>
 
 #include "type_pool.h"
 #include "misc/resource.hpp"
+#include "misc/hash.hpp"
+#include "misc/flat_map.hpp"
 
 namespace ydsh {
 
+/**
+ * intern symbol names. interned name has stable id.
+ */
+class SymbolPool {
+private:
+    CStringHashMap<unsigned int> idMap;
+
+    /**
+     * element address is not changed after push_back
+     */
+    std::deque<std::string> names;
+
+public:
+    static constexpr unsigned int NOT_FOUND = static_cast<unsigned int>(-1);
+
+    NON_COPYABLE(SymbolPool);
+
+    SymbolPool() = default;
+
+    unsigned int intern(const char *name) {
+        auto iter = this->idMap.find(name);
+        if(iter != this->idMap.end()) {
+            return iter->second;
+        }
+        unsigned int id = this->names.size();
+        this->names.emplace_back(name);
+        this->idMap.emplace(this->names.back().c_str(), id);
+        return id;
+    }
+
+    /**
+     *
+     * @param name
+     * @return
+     * if not interned, return NOT_FOUND
+     */
+    unsigned int lookup(const char *name) const {
+        auto iter = this->idMap.find(name);
+        return iter != this->idMap.end() ? iter->second : NOT_FOUND;
+    }
+
+    const char *get(unsigned int id) const {
+        return this->names[id].c_str();
+    }
+};
+
+enum class SymbolKind : unsigned int {
+    VAR,    // variable, function, scoped import module
+    UDC,    // user-defined command
+    MOD,    // module holder (id is module id)
+};
+
+/**
+ * key of scope entry. pair of symbol kind and symbol id
+ * (so, not need to concatenate symbol prefix for user-defined command or module)
+ */
+class SymbolKey {
+private:
+    unsigned int value;
+
+public:
+    SymbolKey(SymbolKind kind, unsigned int id) : value(id << 2u | static_cast<unsigned int>(kind)) {}
+
+    explicit SymbolKey(unsigned int value) : value(value) {}
+
+    SymbolKind kind() const {
+        return static_cast<SymbolKind>(this->value & 0x3u);
+    }
+
+    unsigned int id() const {
+        return this->value >> 2u;
+    }
+
+    unsigned int raw() const {
+        return this->value;
+    }
+};
+
+using HandleMap = FlatIntMap<FieldHandle>;
+
 class Scope {
 protected:
-    std::unordered_map<std::string, FieldHandle> handleMap;
+    HandleMap handleMap;
 
     ~Scope() = default;
 
@@ -37,7 +120,7 @@ public:
     Scope() = default;
     Scope(Scope&&) = default;
 
-    const std::unordered_map<std::string, FieldHandle> &getHandleMap() const {
+    const HandleMap &getHandleMap() const {
         return this->handleMap;
     }
 
@@ -50,10 +133,10 @@ public:
     }
 
 protected:
-    const FieldHandle *lookup(const std::string &symbolName) const {
-        auto iter = this->handleMap.find(symbolName);
-        if(iter != this->handleMap.end() && iter->second) {
-            return &iter->second;
+    const FieldHandle *lookup(SymbolKey key) const {
+        auto *handle = this->handleMap.find(key.raw());
+        if(handle != nullptr && *handle) {
+            return handle;
         }
         return nullptr;
     }
@@ -102,7 +185,7 @@ private:
      * add FieldHandle. if adding success, increment curVarIndex.
      * return null if found duplicated handle.
      */
-    HandleOrError add(const std::string &symbolName, FieldHandle handle);
+    HandleOrError add(SymbolKey key, FieldHandle handle);
 };
 
 class GlobalScope : public Scope {
@@ -114,25 +197,22 @@ private:
 public:
     NON_COPYABLE(GlobalScope);
 
-    explicit GlobalScope(unsigned int &gvarCount);
+    GlobalScope(SymbolPool &pool, unsigned int &gvarCount);
     GlobalScope(GlobalScope &&) = default;
     ~GlobalScope() = default;
 
 private:
-    HandleOrError addNew(const std::string &symbolName, const DSType &type,
+    HandleOrError addNew(SymbolKey key, const DSType &type,
                          FieldAttribute attribute, unsigned short modID);
 
     /**
      * before call it, reset gvarCount
      */
     void abort() {
-        for(auto iter = this->handleMap.begin(); iter != this->handleMap.end();) {
-            if(iter->second && iter->second.getIndex() >= this->gvarCount) {
-                iter = this->handleMap.erase(iter);
-            } else {
-                ++iter;
-            }
-        }
+        const unsigned int count = this->gvarCount;
+        this->handleMap.removeIf([count](const HandleMap::value_type &e) {
+            return e.second && e.second.getIndex() >= count;
+        });
     }
 };
 
@@ -159,8 +239,8 @@ private:
 public:
     NON_COPYABLE(ModuleScope);
 
-    explicit ModuleScope(unsigned int &gvarCount, unsigned short modID = 0) :
-            modID(modID), builtin(modID == 0), globalScope(gvarCount) {
+    ModuleScope(SymbolPool &pool, unsigned int &gvarCount, unsigned short modID = 0) :
+            modID(modID), builtin(modID == 0), globalScope(pool, gvarCount) {
         this->maxVarIndexStack.push_back(0);
     }
 
@@ -175,16 +255,16 @@ public:
     /**
      * return null, if not found.
      */
-    const FieldHandle *lookupHandle(const std::string &symbolName) const;
+    const FieldHandle *lookupHandle(SymbolKey key) const;
 
     /**
      * return null, if found duplicated handle.
      */
-    HandleOrError newHandle(const std::string &symbolName, const DSType &type, FieldAttribute attribute);
+    HandleOrError newHandle(SymbolKey key, const DSType &type, FieldAttribute attribute);
 
-    bool disallowShadowing(const std::string &symbolName) {
+    bool disallowShadowing(SymbolKey key) {
         assert(!this->inGlobalScope());
-        return static_cast<bool>(this->scopes.back().add(symbolName, FieldHandle()));
+        return static_cast<bool>(this->scopes.back().add(key, FieldHandle()));
     }
 
     void setBuiltin(bool set) {
@@ -214,11 +294,12 @@ public:
     /**
      *
      * @param type
+     * @param pool
      * @return
      * if detect symbol name conflict, return conflicted symbol name.
      * if has no conflict, return null
      */
-    const char *import(const ModType &type);
+    const char *import(const ModType &type, const SymbolPool &pool);
 
 
     /**
@@ -257,13 +338,12 @@ class SymbolTable;
 class ModType : public DSType {
 private:
     unsigned short modID;
-    std::unordered_map<std::string, FieldHandle> handleMap;
+    HandleMap handleMap;
 
     friend class ModuleScope;
 
 public:
-    ModType(unsigned int id, DSType &superType, unsigned short modID,
-            const std::unordered_map<std::string, FieldHandle> &handleMap);
+    ModType(unsigned int id, DSType &superType, unsigned short modID, const HandleMap &handleMap);
 
     ~ModType() override = default;
 
@@ -275,6 +355,10 @@ public:
         return toModName(this->modID);
     }
 
+    const HandleMap &getHandleMap() const {
+        return this->handleMap;
+    }
+
     const FieldHandle *lookupFieldHandle(SymbolTable &symbolTable, const std::string &fieldName) const override;
 
     static std::string toModName(unsigned short modID);
@@ -323,9 +407,11 @@ private:
 
 class SymbolTable {
 private:
+    SymbolPool symbolPool;
     ModuleLoader modLoader;
     unsigned int oldGvarCount{0};
     unsigned int gvarCount{0};
+    unsigned int builtinVarCount{0};
     ModuleScope rootModule;
     ModuleScope *curModule;
 
@@ -336,7 +422,7 @@ private:
 public:
     NON_COPYABLE(SymbolTable);
 
-    SymbolTable() : rootModule(this->gvarCount), curModule(&this->rootModule) {}
+    SymbolTable() : rootModule(this->symbolPool, this->gvarCount), curModule(&this->rootModule) {}
 
     ~SymbolTable() = default;
 
@@ -357,6 +443,14 @@ private:
         return this->rootModule;
     }
 
+    SymbolKey toKey(SymbolKind kind, const std::string &symbolName) {
+        return SymbolKey(kind, this->symbolPool.intern(symbolName.c_str()));
+    }
+
+    const FieldHandle *lookupHandle(SymbolKey key) const;
+
+    HandleOrError newHandle(SymbolKey key, const DSType &type, FieldAttribute attribute);
+
 public:
     // for module scope
 
@@ -388,13 +482,32 @@ public:
      */
     ModResult tryToLoadModule(const char *scriptDir, const char *modPath, FilePtr &filePtr);
 
+    /**
+     * resolve full path of module in the same search order as tryToLoadModule,
+     * but not load it (not change module loading state)
+     * @param scriptDir
+     * may be null
+     * @param modPath
+     * @return
+     * if module is not found or already loaded, return empty string
+     */
+    std::string resolveModulePath(const char *scriptDir, const char *modPath) const;
+
     /**
      * create new module scope and assign it to curModule
      * @return
      */
     ModuleScope createModuleScope() {
         auto id = ++this->modLoader.modIDCount;
-        return ModuleScope(this->gvarCount, id);
+        return ModuleScope(this->symbolPool, this->gvarCount, id);
+    }
+
+    /**
+     * get module id assigned by next createModuleScope()
+     * @return
+     */
+    unsigned short nextModID() const {
+        return this->modLoader.modIDCount + 1;
     }
 
     /**
@@ -405,7 +518,7 @@ public:
     ModType &createModType(const std::string &fullpath);
 
     const char *import(const ModType &type) {
-        return this->cur().import(type);
+        return this->cur().import(type, this->symbolPool);
     }
 
     // for FieldHandle lookup
@@ -413,19 +526,49 @@ public:
     /**
      * return null, if not found.
      */
-    const FieldHandle *lookupHandle(const std::string &symbolName) const;
+    const FieldHandle *lookupHandle(const std::string &symbolName) const {
+        unsigned int id = this->symbolPool.lookup(symbolName.c_str());
+        if(id == SymbolPool::NOT_FOUND) {  // not interned symbol is not defined
+            return nullptr;
+        }
+        return this->lookupHandle(SymbolKey(SymbolKind::VAR, id));
+    }
 
     /**
      * return null, if found duplicated handle.
      */
-    HandleOrError newHandle(const std::string &symbolName, const DSType &type, FieldAttribute attribute);
+    HandleOrError newHandle(const std::string &symbolName, const DSType &type, FieldAttribute attribute) {
+        return this->newHandle(this->toKey(SymbolKind::VAR, symbolName), type, attribute);
+    }
 
     bool disallowShadowing(const std::string &symbolName) {
-        return this->cur().disallowShadowing(symbolName);
+        return this->cur().disallowShadowing(this->toKey(SymbolKind::VAR, symbolName));
+    }
+
+    /**
+     *
+     * @param key
+     * @return
+     * if key is module, return null
+     */
+    const char *getSymbolName(SymbolKey key) const {
+        return key.kind() == SymbolKind::MOD ? nullptr : this->symbolPool.get(key.id());
+    }
+
+    const SymbolPool &getSymbolPool() const {
+        return this->symbolPool;
     }
 
     void closeBuiltin() {
         this->root().setBuiltin(false);
+        this->builtinVarCount = this->gvarCount;
+    }
+
+    /**
+     * number of global variables defined before closeBuiltin()
+     */
+    unsigned int getBuiltinVarCount() const {
+        return this->builtinVarCount;
     }
 
     /**
@@ -443,26 +586,26 @@ public:
      */
     HandleOrError registerUdc(const std::string &cmdName, const DSType &type) {
         assert(this->root().inGlobalScope());
-        std::string name = CMD_SYMBOL_PREFIX;
-        name += cmdName;
-        return this->root().newHandle(name, type, FieldAttribute::READ_ONLY);
+        return this->root().newHandle(this->toKey(SymbolKind::UDC, cmdName), type, FieldAttribute::READ_ONLY);
     }
 
     /**
      * if not found, return null.
      */
     const FieldHandle *lookupUdc(const char *cmdName) const {
-        std::string name = CMD_SYMBOL_PREFIX;
-        name += cmdName;
-        return this->root().lookupHandle(name);
+        unsigned int id = this->symbolPool.lookup(cmdName);
+        if(id == SymbolPool::NOT_FOUND) {
+            return nullptr;
+        }
+        return this->root().lookupHandle(SymbolKey(SymbolKind::UDC, id));
     }
 
     const FieldHandle *lookupModHandle(const ModType &type) const {
-        return this->root().lookupHandle(type.toName());
+        return this->root().lookupHandle(SymbolKey(SymbolKind::MOD, type.getModID()));
     }
 
     HandleOrError newModHandle(const ModType &type) {
-        return this->root().newHandle(type.toName(), type, FieldAttribute::READ_ONLY);
+        return this->root().newHandle(SymbolKey(SymbolKind::MOD, type.getModID()), type, FieldAttribute::READ_ONLY);
     }
 
     const FieldHandle *lookupField(DSType &recvType, const std::string &fieldName);
@@ -547,6 +690,10 @@ public:
         return this->cur().global();
     }
 
+    const GlobalScope &rootGlobalScope() const {
+        return this->root().global();
+    }
+
     const BlockScope &curScope() const {
         return this->cur().curScope();
     }
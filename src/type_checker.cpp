@@ -300,7 +300,7 @@ HandleOrFuncType TypeChecker::resolveCallee(VarNode &recvNode) {
     return static_cast<FunctionType *>(const_cast<DSType *>(&type));
 }
 
-void TypeChecker::checkTypeArgsNode(Node &node, const MethodHandle *handle, std::vector<std::unique_ptr<Node>> &argNodes) {
+void TypeChecker::checkTypeArgsNode(Node &node, const MethodHandle *handle, NodeVector<Node> &argNodes) {
     unsigned int argSize = argNodes.size();
     // check param size
     unsigned int paramSize = handle->getParamSize();
@@ -353,7 +353,7 @@ protected:
     HandleOrFuncType resolveCallee(VarNode &recvNode);
 
     // helper for argument type checking
-    void checkTypeArgsNode(Node &node, const MethodHandle *handle, std::vector<std::unique_ptr<Node>> &argNodes);
+    void checkTypeArgsNode(Node &node, const MethodHandle *handle, NodeVector<Node> &argNodes);
 
     void checkTypeAsMethodCall(ApplyNode &node, const MethodHandle *handle);
 
@@ -16,6 +16,7 @@
 
 #include <pwd.h>
 #include <libgen.h>
+#include <sys/ioctl.h>
 
 #include <cstdlib>
 #include <cerrno>
@@ -157,13 +158,13 @@ bool VM::checkAssertion(DSState &state) {
 const char *VM::loadEnv(DSState &state, bool hasDefault) {
     DSValue dValue;
     if(hasDefault) {
-        dValue = state.stack.pop();
+        dValue = state.stack.pop().materialize();
     }
-    auto nameObj = state.stack.pop();
-    const char *name = nameObj.asStrRef().data();
+    auto nameObj = state.stack.pop().materialize();
+    const char *name = nameObj.asCStr();
     const char *env = getenv(name);
     if(env == nullptr && hasDefault) {
-        setenv(name, dValue.asStrRef().data(), 1);
+        setenv(name, dValue.asCStr(), 1);
         env = getenv(name);
     }
 
@@ -238,74 +239,130 @@ bool VM::prepareUserDefinedCommandCall(DSState &state, const DSCode *code, DSVal
 
 /* for substitution */
 
-static DSValue readAsStr(int fd) {
-    char buf[256];
-    std::string str;
+/**
+ * read all data from fd. read size is determined by FIONREAD
+ * @param fd
+ * @param buf
+ * append read data
+ */
+static void readAllFromFD(int fd, std::string &buf) {
+    constexpr int MIN_READ_SIZE = 16 * 1024;
+
     while(true) {
-        int readSize = read(fd, buf, arraySize(buf));
-        if(readSize == -1 && (errno == EAGAIN || errno == EINTR)) {
+        int readSize = 0;
+        if(ioctl(fd, FIONREAD, &readSize) == -1 || readSize < MIN_READ_SIZE) {
+            readSize = MIN_READ_SIZE;
+        }
+        if(buf.size() + readSize > StringObject::MAX_SIZE) {
+            readSize = StringObject::MAX_SIZE - buf.size();
+            if(readSize == 0) {
+                break;
+            }
+        }
+
+        const size_t oldSize = buf.size();
+        buf.resize(oldSize + readSize);
+        ssize_t ret = read(fd, &buf[oldSize], readSize);
+        buf.resize(oldSize + (ret > 0 ? ret : 0));
+        if(ret == -1 && (errno == EAGAIN || errno == EINTR)) {
             continue;
         }
-        if(readSize <= 0) {
+        if(ret <= 0) {
             break;
         }
-        str.append(buf, readSize);
     }
+}
 
-    // remove last newlines
+static void removeLastNewlines(std::string &str) {
     for(; !str.empty() && str.back() == '\n'; str.pop_back());
+}
 
+static DSValue readAsStr(int fd) {
+    std::string str;
+    readAllFromFD(fd, str);
+    removeLastNewlines(str);
     return DSValue::createStr(std::move(str));
 }
 
+class FieldSepFinder {
+private:
+    const char *ifs;
+    unsigned int ifsSize;
+    bool table[256];
+
+public:
+    FieldSepFinder(const char *ifs, unsigned int ifsSize) : ifs(ifs), ifsSize(ifsSize), table() {
+        for(unsigned int i = 0; i < ifsSize; i++) {
+            this->table[static_cast<unsigned char>(ifs[i])] = true;
+        }
+    }
+
+    /**
+     * find first field separator
+     * @param begin
+     * @param end
+     * @return
+     * if not found, return end
+     */
+    const char *operator()(const char *begin, const char *end) const {
+        if(this->ifsSize == 0) {
+            return end;
+        }
+        if(this->ifsSize == 1) {
+            auto *ptr = static_cast<const char *>(memchr(begin, this->ifs[0], end - begin));
+            return ptr != nullptr ? ptr : end;
+        }
+        for(; begin != end && !this->table[static_cast<unsigned char>(*begin)]; ++begin);
+        return begin;
+    }
+};
+
 static DSValue readAsStrArray(const DSState &state, int fd) {
     auto ifsRef = state.getGlobal(BuiltinVarOffset::IFS).asStrRef();
     const char *ifs = ifsRef.data();
     const unsigned ifsSize = ifsRef.size();
+    const FieldSepFinder findSep(ifs, ifsSize);
     unsigned int skipCount = 1;
 
-    char buf[256];
-    std::string str;
+    std::string buf;
+    readAllFromFD(fd, buf);
+    removeLastNewlines(buf);
+
     auto obj = DSValue::create<ArrayObject>(state.symbolTable.get(TYPE::StringArray));
     auto &array = typeAs<ArrayObject>(obj);
 
-    while(true) {
-        int readSize = read(fd, buf, arraySize(buf));
-        if(readSize == -1 && (errno == EINTR || errno == EAGAIN)) {
-            continue;
-        }
-        if(readSize <= 0) {
-            break;
+    const char *end = buf.data() + buf.size();
+    StringRef field("");
+    for(const char *ptr = buf.data(); ptr != end;) {
+        // consume field (non-separator characters)
+        const char *sep = findSep(ptr, end);
+        if(sep != ptr) {
+            field = StringRef(ptr, sep - ptr);
+            skipCount = 0;
+            ptr = sep;
+            if(ptr == end) {
+                break;
+            }
         }
 
-        for(int i = 0; i < readSize; i++) {
-            int ch = buf[i];
-            bool fieldSep = isFieldSep(ifsSize, ifs, ch);
-            if(fieldSep && skipCount > 0) {
-                if(isSpace(ch)) {
-                    continue;
-                }
-                if(--skipCount == 1) {
-                    continue;
-                }
+        // consume separator
+        int ch = *(ptr++);
+        if(skipCount > 0) {
+            if(isSpace(ch)) {
+                continue;
             }
-            skipCount = 0;
-            if(fieldSep) {
-                array.append(DSValue::createStr(std::move(str)));
-                str = "";
-                skipCount = isSpace(ch) ? 2 : 1;
+            if(--skipCount == 1) {
                 continue;
             }
-            str += static_cast<char>(ch);
         }
+        array.append(DSValue::createStr(field));
+        field = StringRef("");
+        skipCount = isSpace(ch) ? 2 : 1;
     }
 
-    // remove last newline
-    for(; !str.empty() && str.back() == '\n'; str.pop_back());
-
     // append remain
-    if(!str.empty() || !hasSpace(ifsSize, ifs)) {
-        array.append(DSValue::createStr(std::move(str)));
+    if(!field.empty() || !hasSpace(ifsSize, ifs)) {
+        array.append(DSValue::createStr(field));
     }
 
     return obj;
@@ -493,7 +550,35 @@ static void raiseCmdError(DSState &state, const char *cmdName, int errnum) {
     }
 }
 
+/**
+ * if true, external command can be spawned without fork.
+ * (not change process group and not pass fd to command arguments)
+ */
+static bool canSpawn(const DSState &state, const DSValue &redirConfig) {
+    if(state.isJobControl()) {
+        return false;
+    }
+    return !redirConfig || !typeAs<RedirObject>(redirConfig).hasPassingFD();
+}
+
 int VM::forkAndExec(DSState &state, const char *filePath, char *const *argv, DSValue &&redirConfig) {
+    state.outBuffer.flush();
+    if(canSpawn(state, redirConfig)) {
+        auto proc = Proc::spawn(filePath, argv);
+        redirConfig = nullptr;  // restore redirconfig
+        if(proc.pid() == -1) {
+            int errnum = errno;
+            if(errnum == ENOENT) {  // remove cached path
+                state.pathCache.removePath(argv[0]);
+            }
+            raiseCmdError(state, argv[0], errnum);
+            return 1;
+        }
+        int status = proc.wait(Proc::BLOCKING);
+        state.jobTable.updateStatus();
+        return status;
+    }
+
     // setup self pipe
     int selfpipe[2];
     if(pipe(selfpipe) < 0) {
@@ -558,6 +643,9 @@ bool VM::callCommand(DSState &state, CmdResolver resolver, DSValue &&argvObj, DS
     auto &array = typeAs<ArrayObject>(argvObj);
     auto cmd = resolver(state, str(array.getValues()[0]));
 
+    // directory entries may be changed by any kind of command (including spawned external command)
+    state.globCache.clear();
+
     switch(cmd.kind) {
     case Command::USER_DEFINED:
     case Command::BUILTIN_S: {
@@ -567,7 +655,14 @@ bool VM::callCommand(DSState &state, CmdResolver resolver, DSValue &&argvObj, DS
         return prepareUserDefinedCommandCall(state, cmd.udc, std::move(argvObj), std::move(redirConfig), attr);
     }
     case Command::BUILTIN: {
+        const bool buffered = isBufferedBuiltin(cmd.builtinCmd);
+        if(!buffered) {
+            state.outBuffer.flush();    // keep output order
+        }
         int status = cmd.builtinCmd(state, array);
+        if(buffered) {
+            state.outBuffer.sync();
+        }
         flushStdFD();
         if(state.hasError()) {
             return false;
@@ -644,6 +739,7 @@ bool VM::callBuiltinCommand(DSState &state, DSValue &&argvObj, DSValue &&redir,
         }
 
         // show command description
+        state.outBuffer.flush();
         unsigned int successCount = 0;
         for(; index < argc; index++) {
             const char *commandName = str(arrayObj.getValues()[index]);
@@ -736,6 +832,7 @@ void VM::callBuiltinExec(DSState &state, DSValue &&array, DSValue &&redir) {
         }
 
         char *envp[] = {nullptr};
+        state.outBuffer.flush();
         xexecve(filePath, argv2, clearEnv ? envp : nullptr, redir);
         PERROR(argvObj, "%s", str(argvObj.getValues()[index]));
         exit(1);
@@ -856,7 +953,7 @@ void VM::addCmdArg(DSState &state, bool skipEmptyStr) {
         if(skipEmptyStr && value.asStrRef().empty()) {
             return;
         }
-        argv.append(std::move(value));
+        argv.append(value.materialize());
         return;
     }
 
@@ -877,19 +974,34 @@ void VM::addCmdArg(DSState &state, bool skipEmptyStr) {
         if(element.asStrRef().empty()) {
             continue;
         }
-        argv.append(element);
+        argv.append(element.materialize());
     }
 }
 
+/**
+ * glob pattern fragment resolved from DSValue on calling thread.
+ * not refer DSValue, so can be shared with glob worker threads
+ */
+struct GlobFragment {
+    std::string value;
+
+    /**
+     * if false, this fragment is glob meta character
+     */
+    bool isStr;
+
+    GlobMeta meta;
+};
+
 class GlobIter {
 private:
-    const DSValue *cur;
+    const GlobFragment *cur;
     const char *ptr{nullptr};
 
 public:
-    explicit GlobIter(const DSValue &value) : cur(&value) {
-        if(this->cur->hasStrRef()) {
-            this->ptr = this->cur->asStrRef().begin();
+    explicit GlobIter(const GlobFragment &frag) : cur(&frag) {
+        if(this->cur->isStr) {
+            this->ptr = this->cur->value.c_str();
         }
     }
 
@@ -914,14 +1026,14 @@ public:
         }
         if(!this->ptr) {
             this->cur++;
-            if(this->cur->hasStrRef()) {
-                this->ptr = this->cur->asStrRef().begin();
+            if(this->cur->isStr) {
+                this->ptr = this->cur->value.c_str();
             }
         }
         return *this;
     }
 
-    const DSValue *getIter() const {
+    const GlobFragment *getIter() const {
         return this->cur;
     }
 };
@@ -929,12 +1041,12 @@ public:
 struct DSValueGlobMeta {
     static bool isAny(GlobIter iter) {
         auto &v = *iter.getIter();
-        return v.kind() == DSValueKind::GLOB_META && v.asGlobMeta() == GlobMeta::ANY;
+        return !v.isStr && v.meta == GlobMeta::ANY;
     }
 
     static bool isZeroOrMore(GlobIter iter) {
         auto &v = *iter.getIter();
-        return v.kind() == DSValueKind::GLOB_META && v.asGlobMeta() == GlobMeta::ZERO_OR_MORE;
+        return !v.isStr && v.meta == GlobMeta::ZERO_OR_MORE;
     }
 
     static void preExpand(std::string &path) {
@@ -963,6 +1075,29 @@ static void raiseGlobbingError(DSState &state, const VMState &st, unsigned int s
     raiseError(state, TYPE::GlobbingError, std::move(value));
 }
 
+bool VM::interpolate(DSState &state, const unsigned int size) {
+    size_t totalSize = 0;
+    for(unsigned int i = 0; i < size; i++) {
+        totalSize += state.stack.peekByOffset(i).asStrRef().size();
+    }
+    if(totalSize > StringObject::MAX_SIZE) {
+        raiseError(state, TYPE::OutOfRangeError, std::string("reach String size limit"));
+        return false;
+    }
+
+    std::string value;
+    value.reserve(totalSize);
+    for(unsigned int i = size; i > 0; i--) {
+        auto ref = state.stack.peekByOffset(i - 1).asStrRef();
+        value.append(ref.data(), ref.size());
+    }
+    for(unsigned int i = 0; i < size; i++) {
+        state.stack.popNoReturn();
+    }
+    state.stack.push(DSValue::createStr(std::move(value)));
+    return true;
+}
+
 bool VM::addGlobbingPath(DSState &state, const unsigned int size, bool tilde) {
     /**
      * stack layout
@@ -977,9 +1112,6 @@ bool VM::addGlobbingPath(DSState &state, const unsigned int size, bool tilde) {
      * | argv | redir |
      * +------+-------+
      */
-    GlobIter begin(state.stack.peekByOffset(size));
-    GlobIter end(state.stack.peek());
-
     // check if glob path fragments have null character
     for(unsigned int i = 0; i < size; i++) {
         auto &v = state.stack.peekByOffset(size - i);
@@ -992,6 +1124,27 @@ bool VM::addGlobbingPath(DSState &state, const unsigned int size, bool tilde) {
         }
     }
 
+    /**
+     * resolve fragments before globbing (glob may run on worker threads, so not touch DSValue)
+     * last fragment (empty string) is end of fragments
+     */
+    std::vector<GlobFragment> fragments(size + 1);
+    for(unsigned int i = 0; i < size; i++) {
+        auto &v = state.stack.peekByOffset(size - i);
+        auto &frag = fragments[i];
+        frag.isStr = v.hasStrRef();
+        if(frag.isStr) {
+            auto ref = v.asStrRef();
+            frag.value.assign(ref.data(), ref.size());
+        } else {
+            assert(v.kind() == DSValueKind::GLOB_META);
+            frag.meta = v.asGlobMeta();
+        }
+    }
+    fragments[size].isStr = true;
+    GlobIter begin(fragments[0]);
+    GlobIter end(fragments[size]);
+
     auto &argv = state.stack.peekByOffset(size + 2);
     const unsigned int oldSize = typeAs<ArrayObject>(argv).size();
     auto appender = [&](std::string &&path) {
@@ -1004,7 +1157,8 @@ bool VM::addGlobbingPath(DSState &state, const unsigned int size, bool tilde) {
     if(hasFlag(state.runtimeOption, RuntimeOption::DOTGLOB)) {
         setFlag(option, WildMatchOption::DOTGLOB);
     }
-    unsigned int ret = glob<DSValueGlobMeta>(begin, end, appender, option);
+    DirEntryCache *cache = hasFlag(state.runtimeOption, RuntimeOption::GLOBCACHE) ? &state.globCache : nullptr;
+    unsigned int ret = glob<DSValueGlobMeta>(begin, end, appender, option, cache);
     if(ret || hasFlag(state.runtimeOption, RuntimeOption::NULLGLOB)) {
         typeAs<ArrayObject>(argv).sortAsStrArray(oldSize);
         for(unsigned int i = 0; i <= size; i++) {
@@ -1061,6 +1215,10 @@ bool VM::checkVMEvent(DSState &state) {
         }
     }
 
+    if(hasFlag(DSState::eventDesc, VMEvent::PROFILE) && state.profiler) {
+        state.profiler->fetch(state.stack);
+    }
+
     if(state.hook != nullptr) {
         assert(hasFlag(DSState::eventDesc, VMEvent::HOOK));
         auto op = static_cast<OpCode>(GET_CODE(state)[state.stack.pc()]);
@@ -1069,6 +1227,29 @@ bool VM::checkVMEvent(DSState &state) {
     return true;
 }
 
+#if defined(USE_THREADED_CODE) && (defined(__GNUC__) || defined(__clang__))
+#define VM_THREADED_CODE
+#endif
+
+#ifdef VM_THREADED_CODE
+/**
+ * direct threaded code.
+ * each instruction handler fetches next opcode and directly jumps to its label.
+ * (avoid range check of switch statement and share of indirect branch)
+ */
+#define vmdispatch(V) goto *dispatchTable[static_cast<unsigned char>(V)];
+
+#define vmcase(code) L_ ## code:
+
+#define vmnext \
+    do { \
+        if(!empty(DSState::eventDesc)) { \
+            TRY(checkVMEvent(state)); \
+        } \
+        op = static_cast<OpCode>(GET_CODE(state)[state.stack.pc()++]); \
+        vmdispatch(op) \
+    } while(false)
+#else
 #define vmdispatch(V) switch(V)
 
 #if 0
@@ -1078,11 +1259,68 @@ bool VM::checkVMEvent(DSState &state) {
 #endif
 
 #define vmnext continue
+#endif
+
 #define vmerror goto EXCEPT
 
 #define TRY(E) do { if(!(E)) { vmerror; } } while(false)
 
+/**
+ * for typed arithmetic op. same semantics as corresponding native method (see. builtin.h)
+ */
+#define INT_ARITH_OP(FUNC) \
+    do { \
+        int64_t right = state.stack.pop().asInt(); \
+        int64_t left = state.stack.pop().asInt(); \
+        int64_t ret; \
+        if(FUNC(left, right, ret)) { \
+            raiseError(state, TYPE::ArithmeticError, "integer overflow"); \
+            vmerror; \
+        } \
+        state.stack.push(DSValue::createInt(ret)); \
+    } while(false)
+
+#define INT_DIV_OP(OP, MSG) \
+    do { \
+        int64_t right = state.stack.pop().asInt(); \
+        int64_t left = state.stack.pop().asInt(); \
+        if(right == 0) { \
+            raiseError(state, TYPE::ArithmeticError, MSG); \
+            vmerror; \
+        } \
+        state.stack.push(DSValue::createInt(left OP right)); \
+    } while(false)
+
+#define INT_BIT_OP(OP) \
+    do { \
+        auto right = static_cast<uint64_t>(state.stack.pop().asInt()); \
+        auto left = static_cast<uint64_t>(state.stack.pop().asInt()); \
+        state.stack.push(DSValue::createInt(left OP right)); \
+    } while(false)
+
+#define FLOAT_ARITH_OP(OP) \
+    do { \
+        double right = state.stack.pop().asFloat(); \
+        double left = state.stack.pop().asFloat(); \
+        state.stack.push(DSValue::createFloat(left OP right)); \
+    } while(false)
+
+#define COMPARE_OP(AS, OP) \
+    do { \
+        auto right = state.stack.pop(); \
+        auto left = state.stack.pop(); \
+        state.stack.push(DSValue::createBool(left.AS() OP right.AS())); \
+    } while(false)
+
 bool VM::mainLoop(DSState &state) {
+#ifdef VM_THREADED_CODE
+    static const void *dispatchTable[] = {
+#define GEN_LABEL(CODE, N, S) &&L_ ## CODE,
+            OPCODE_LIST(GEN_LABEL)
+#undef GEN_LABEL
+    };
+#endif
+
     OpCode op;
     while(true) {
         if(!empty(DSState::eventDesc)) {
@@ -1113,6 +1351,7 @@ bool VM::mainLoop(DSState &state) {
             value += " = ";
             value.append(ref.data(), ref.size());
             value += "\n";
+            state.outBuffer.flush();
             fwrite(value.c_str(), sizeof(char), value.size(), stdout);
             fflush(stdout);
             state.stack.popNoReturn();
@@ -1248,8 +1487,8 @@ bool VM::mainLoop(DSState &state) {
             vmnext;
         }
         vmcase(STORE_ENV) {
-            DSValue value = state.stack.pop();
-            DSValue name = state.stack.pop();
+            DSValue value = state.stack.pop().materialize();
+            DSValue name = state.stack.pop().materialize();
 
             setenv(str(name), str(value), 1);//FIXME: check return value and throw
             vmnext;
@@ -1282,6 +1521,12 @@ bool VM::mainLoop(DSState &state) {
             state.stack.push(std::move(left));
             vmnext;
         }
+        vmcase(INTERP_N) {
+            unsigned int size = read8(GET_CODE(state), state.stack.pc());
+            state.stack.pc()++;
+            TRY(interpolate(state, size));
+            vmnext;
+        }
         vmcase(APPEND_ARRAY) {
             DSValue v = state.stack.pop();
             typeAs<ArrayObject>(state.stack.peek()).append(std::move(v));
@@ -1430,6 +1675,126 @@ bool VM::mainLoop(DSState &state) {
             state.stack.push(DSValue::createBool(v1 != v2));
             vmnext;
         }
+        vmcase(ADD_INT) {
+            INT_ARITH_OP(sadd_overflow);
+            vmnext;
+        }
+        vmcase(SUB_INT) {
+            INT_ARITH_OP(ssub_overflow);
+            vmnext;
+        }
+        vmcase(MUL_INT) {
+            INT_ARITH_OP(smul_overflow);
+            vmnext;
+        }
+        vmcase(DIV_INT) {
+            INT_DIV_OP(/, "zero division");
+            vmnext;
+        }
+        vmcase(MOD_INT) {
+            INT_DIV_OP(%, "zero modulo");
+            vmnext;
+        }
+        vmcase(AND_INT) {
+            INT_BIT_OP(&);
+            vmnext;
+        }
+        vmcase(OR_INT) {
+            INT_BIT_OP(|);
+            vmnext;
+        }
+        vmcase(XOR_INT) {
+            INT_BIT_OP(^);
+            vmnext;
+        }
+        vmcase(EQ_INT) {
+            COMPARE_OP(asInt, ==);
+            vmnext;
+        }
+        vmcase(NE_INT) {
+            COMPARE_OP(asInt, !=);
+            vmnext;
+        }
+        vmcase(LT_INT) {
+            COMPARE_OP(asInt, <);
+            vmnext;
+        }
+        vmcase(GT_INT) {
+            COMPARE_OP(asInt, >);
+            vmnext;
+        }
+        vmcase(LE_INT) {
+            COMPARE_OP(asInt, <=);
+            vmnext;
+        }
+        vmcase(GE_INT) {
+            COMPARE_OP(asInt, >=);
+            vmnext;
+        }
+        vmcase(ADD_FLOAT) {
+            FLOAT_ARITH_OP(+);
+            vmnext;
+        }
+        vmcase(SUB_FLOAT) {
+            FLOAT_ARITH_OP(-);
+            vmnext;
+        }
+        vmcase(MUL_FLOAT) {
+            FLOAT_ARITH_OP(*);
+            vmnext;
+        }
+        vmcase(DIV_FLOAT) {
+            FLOAT_ARITH_OP(/);
+            vmnext;
+        }
+        vmcase(EQ_FLOAT) {
+            COMPARE_OP(asFloat, ==);
+            vmnext;
+        }
+        vmcase(NE_FLOAT) {
+            COMPARE_OP(asFloat, !=);
+            vmnext;
+        }
+        vmcase(LT_FLOAT) {
+            COMPARE_OP(asFloat, <);
+            vmnext;
+        }
+        vmcase(GT_FLOAT) {
+            COMPARE_OP(asFloat, >);
+            vmnext;
+        }
+        vmcase(LE_FLOAT) {
+            COMPARE_OP(asFloat, <=);
+            vmnext;
+        }
+        vmcase(GE_FLOAT) {
+            COMPARE_OP(asFloat, >=);
+            vmnext;
+        }
+        vmcase(EQ_STR) {
+            COMPARE_OP(asStrRef, ==);
+            vmnext;
+        }
+        vmcase(NE_STR) {
+            COMPARE_OP(asStrRef, !=);
+            vmnext;
+        }
+        vmcase(LT_STR) {
+            COMPARE_OP(asStrRef, <);
+            vmnext;
+        }
+        vmcase(GT_STR) {
+            COMPARE_OP(asStrRef, >);
+            vmnext;
+        }
+        vmcase(LE_STR) {
+            COMPARE_OP(asStrRef, <=);
+            vmnext;
+        }
+        vmcase(GE_STR) {
+            COMPARE_OP(asStrRef, >=);
+            vmnext;
+        }
         vmcase(FORK) {
             TRY(forkAndEval(state));
             vmnext;
@@ -1447,6 +1812,9 @@ bool VM::mainLoop(DSState &state) {
             vmnext;
         }
         vmcase(NEW_CMD) {
+            if(hasFlag(state.runtimeOption, RuntimeOption::GLOBCACHE)) {
+                state.globCache.clear();
+            }
             auto v = state.stack.pop();
             auto obj = DSValue::create<ArrayObject>(state.symbolTable.get(TYPE::StringArray));
             auto &argv = typeAs<ArrayObject>(obj);
@@ -1584,6 +1952,34 @@ bool VM::mainLoop(DSState &state) {
             state.stack.reclaimLocals(offset, size);
             vmnext;
         }
+        vmcase(LOAD_LOCAL2) {
+            unsigned char index1 = read8(GET_CODE(state), state.stack.pc());
+            state.stack.pc()++;
+            unsigned char index2 = read8(GET_CODE(state), state.stack.pc());
+            state.stack.pc()++;
+
+            state.stack.loadLocal(index1);
+            state.stack.loadLocal(index2);
+            vmnext;
+        }
+        vmcase(INC_LOCAL)
+        vmcase(DEC_LOCAL) {
+            unsigned char index = read8(GET_CODE(state), state.stack.pc());
+            state.stack.pc()++;
+            unsigned char v = read8(GET_CODE(state), state.stack.pc());
+            state.stack.pc()++;
+
+            int64_t left = state.stack.getLocal(index).asInt();
+            int64_t ret;
+            bool overflow = op == OpCode::INC_LOCAL ? sadd_overflow(left, static_cast<int64_t>(v), ret)
+                                                    : ssub_overflow(left, static_cast<int64_t>(v), ret);
+            if(overflow) {
+                raiseError(state, TYPE::ArithmeticError, "integer overflow");
+                vmerror;
+            }
+            state.stack.setLocal(index, DSValue::createInt(ret));
+            vmnext;
+        }
         }
 
         EXCEPT:
@@ -1645,6 +2041,7 @@ DSValue VM::startEval(DSState &state, EvalOP op, DSError *dsError) {
 
     // run main loop
     const auto ret = mainLoop(state);
+    state.outBuffer.flush();
     /**
      * if return form subshell, subshellLevel is greater than old.
      */
@@ -1665,6 +2062,7 @@ DSValue VM::startEval(DSState &state, EvalOP op, DSError *dsError) {
     auto kind = handleUncaughtException(state, thrown, dsError);
     if(subshell || !hasFlag(op, EvalOP::SKIP_TERM) || !ret) {
         callTermHook(state, kind, std::move(thrown));
+        state.outBuffer.flush();
     }
 
     if(subshell) {
@@ -28,20 +28,26 @@
 #include "core.h"
 #include "job.h"
 #include "misc/noncopyable.h"
+#include "misc/glob.hpp"
 #include "state.h"
+#include "profiler.h"
 
 namespace ydsh {
 
 enum class CompileOption : unsigned short {
     ASSERT      = 1u << 0u,
     INTERACTIVE = 1u << 1u,
+    MODULE_CACHE = 1u << 2u,
+    PEEPHOLE    = 1u << 3u,
+    PARALLEL_LOAD = 1u << 4u,
 };
 
 #define EACH_RUNTIME_OPTION(OP) \
     OP(TRACE_EXIT, (1u << 0u), "traceonexit") \
     OP(MONITOR   , (1u << 1u), "monitor") \
     OP(NULLGLOB  , (1u << 2u), "nullglob") \
-    OP(DOTGLOB   , (1u << 3u), "dotglob")
+    OP(DOTGLOB   , (1u << 3u), "dotglob") \
+    OP(GLOBCACHE , (1u << 4u), "globcache")
 
 // set/unset via 'shctl' command
 enum class RuntimeOption : unsigned short {
@@ -51,9 +57,10 @@ enum class RuntimeOption : unsigned short {
 };
 
 enum class VMEvent : unsigned int {
-    HOOK   = 1u << 0u,
-    SIGNAL = 1u << 1u,
-    MASK   = 1u << 2u,
+    HOOK    = 1u << 0u,
+    SIGNAL  = 1u << 1u,
+    MASK    = 1u << 2u,
+    PROFILE = 1u << 3u,
 };
 
 enum class EvalOP : unsigned int {
@@ -93,7 +100,7 @@ public:
      */
     DSValue prompt;
 
-    CompileOption compileOption{CompileOption::ASSERT};
+    CompileOption compileOption{CompileOption::ASSERT | CompileOption::PEEPHOLE};
 
     RuntimeOption runtimeOption{};
 
@@ -106,6 +113,27 @@ public:
      */
     FilePathCache pathCache;
 
+    /**
+     * cache directory entries during globbing of single command line (if enabled globcache).
+     * cleared at command creation and fork.
+     */
+    DirEntryCache globCache;
+
+    /**
+     * read-ahead buffers for read/readarray command
+     */
+    FDReadBuffers readBuffers;
+
+    /**
+     * buffered standard output of echo builtin
+     */
+    StdoutBuffer outBuffer;
+
+    /**
+     * candidates of last interactive completion
+     */
+    CompletionCache compCache;
+
     unsigned int lineNum{1};
 
     /**
@@ -120,6 +148,11 @@ public:
 
     JobTable jobTable;
 
+    /**
+     * if not null, profiling is enabled (see. DSState_startProfile)
+     */
+    std::unique_ptr<Profiler> profiler;
+
     /**
      * for OP_STR.
      */
@@ -327,6 +360,10 @@ private:
      * | stack top | param1(receiver) | ~ | paramN |
      * +-----------+------------------+   +--------+
      *             | offset           |   |        |
+     *
+     * currently, all methods are native (MethodHandle::isNative()) and statically bound to CALL_NATIVE2,
+     * so CALL_METHOD is never emitted. if user-defined methods are supported,
+     * resolved code should be cached at each call site (keyed by receiver type id)
      */
     static bool prepareMethodCall(DSState &state, unsigned short index, unsigned short paramSize) {
         const unsigned int actualParamSize = paramSize + 1; // include receiver
@@ -380,6 +417,16 @@ private:
      */
     static bool addGlobbingPath(DSState &state, unsigned int size, bool tilde);
 
+    /**
+     * concatenate top N string values at once (allocate result string only once).
+     * @param state
+     * @param size
+     * number of string values
+     * @return
+     * if reach string size limit, return false.
+     */
+    static bool interpolate(DSState &state, unsigned int size);
+
     static bool kickSignalHandler(DSState &state, int sigNum, DSValue &&func);
 
     static bool checkVMEvent(DSState &state);
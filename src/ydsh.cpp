@@ -28,6 +28,7 @@
 #include "logger.h"
 #include "frontend.h"
 #include "codegen.h"
+#include "module_cache.h"
 #include "misc/files.h"
 
 using namespace ydsh;
@@ -61,6 +62,8 @@ private:
     NodeDumper uastDumper;
     NodeDumper astDumper;
     ByteCodeGenerator codegen;
+    FILE *optStatsFile;
+    std::unique_ptr<ModuleCache> modCache;
 
 public:
     Compiler(const DSState &state, SymbolTable &symbolTable, Lexer &&lexer) :
@@ -69,7 +72,9 @@ public:
             reporter(newReporter()),
             uastDumper(state.dumpTarget.files[DS_DUMP_KIND_UAST].get(), symbolTable),
             astDumper(state.dumpTarget.files[DS_DUMP_KIND_AST].get(), symbolTable),
-            codegen(symbolTable, hasFlag(state.compileOption, CompileOption::ASSERT)) {
+            codegen(symbolTable, hasFlag(state.compileOption, CompileOption::ASSERT),
+                    hasFlag(state.compileOption, CompileOption::PEEPHOLE)),
+            optStatsFile(state.dumpTarget.files[DS_DUMP_KIND_OPT_STATS].get()) {
         this->frontEnd.setErrorReporter(this->reporter);
         if(this->uastDumper) {
             this->frontEnd.setUASTDumper(this->uastDumper);
@@ -77,6 +82,13 @@ public:
         if(this->astDumper) {
             this->frontEnd.setASTDumper(this->astDumper);
         }
+        if(hasFlag(state.compileOption, CompileOption::MODULE_CACHE) && !this->frontEnd.frontEndOnly()
+            && !this->uastDumper && !this->astDumper && this->optStatsFile == nullptr) {
+            this->modCache = std::make_unique<ModuleCache>(hasFlag(state.compileOption, CompileOption::ASSERT),
+                                                           hasFlag(state.compileOption, CompileOption::PEEPHOLE));
+            this->frontEnd.setModuleCache(*this->modCache);
+        }
+        this->frontEnd.setParallelLoad(hasFlag(state.compileOption, CompileOption::PARALLEL_LOAD));
     }
 
     unsigned int lineNum() const {
@@ -109,11 +121,27 @@ int Compiler::operator()(DSError *dsError, CompiledCode &code) {
         switch(ret.status) {
         case FrontEnd::ENTER_MODULE:
             this->codegen.enterModule(this->frontEnd.getCurrentLexer());
+            if(this->modCache) {
+                this->modCache->enterModule(this->frontEnd.getSymbolTable(),
+                                            this->frontEnd.getCurrentLexer().getSourceName().c_str());
+            }
             break;
-        case FrontEnd::EXIT_MODULE:
-            this->codegen.exitModule(cast<SourceNode>(*ret.node));
+        case FrontEnd::EXIT_MODULE: {
+            auto &srcNode = cast<SourceNode>(*ret.node);
+            if(!this->modCache) {
+                this->codegen.exitModule(srcNode);
+            } else if(auto func = this->modCache->takeLoadedFunc()) {
+                this->codegen.loadModule(srcNode, std::move(func));
+            } else {
+                this->modCache->exitModule(this->frontEnd.getSymbolTable(), srcNode, this->codegen.exitModule(srcNode));
+            }
             break;
+        }
         case FrontEnd::IN_MODULE:
+            if(this->modCache && isa<TypeAliasNode>(*ret.node)) {
+                auto &aliasNode = cast<TypeAliasNode>(*ret.node);
+                this->modCache->addAlias(aliasNode.getAlias(), aliasNode.getTargetTypeNode().getType());
+            }
             this->codegen.generate(ret.node.get());
             break;
         default:
@@ -123,6 +151,10 @@ int Compiler::operator()(DSError *dsError, CompiledCode &code) {
     this->frontEnd.teardownASTDump();
     if(!this->frontEnd.frontEndOnly()) {
         code = this->codegen.finalize();
+        if(this->optStatsFile != nullptr) {
+            fprintf(this->optStatsFile, "### dump optimization stats ###\n");
+            this->codegen.getOptStats().dump(this->optStatsFile);
+        }
     }
     return 0;
 }
@@ -135,6 +167,8 @@ static int compile(DSState &state, Lexer &&lexer, DSError *dsError, CompiledCode
 }
 
 static int evalScript(DSState &state, Lexer &&lexer, DSError *dsError) {
+    state.compCache.clear();    // completion candidates may be changed after evaluation
+
     CompiledCode code;
     int ret = compile(state, std::move(lexer), dsError, code);
     if(!code) {
@@ -191,6 +225,12 @@ static void initBuiltinVar(DSState &state) {
             *state.symbolTable.createMapType(state.symbolTable.get(TYPE::String),
                     state.symbolTable.get(TYPE::String)).take()));
 
+    /**
+     * holding lines read by readarray command.
+     * must be Array_Object
+     */
+    bindVariable(state, "MAPFILE", DSValue::create<ArrayObject>(state.symbolTable.get(TYPE::StringArray)));
+
     /**
      * process id of current process.
      * must be Int_Object
@@ -455,6 +495,30 @@ int DSState_setDumpTarget(DSState *st, DSDumpKind kind, const char *target) {
     return 0;
 }
 
+int DSState_startProfile(DSState *st, DSProfileMode mode, unsigned int interval) {
+    if(st->profiler) {
+        return -1;
+    }
+    st->profiler = Profiler::start(mode, interval);
+    return st->profiler ? 0 : -1;
+}
+
+int DSState_stopProfile(DSState *st, const char *target) {
+    if(!st->profiler) {
+        return -1;
+    }
+    auto profiler = std::move(st->profiler);
+    if(target == nullptr) {
+        return 0;
+    }
+    FilePtr file(strlen(target) == 0 ? fdopen(fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0), "w") : fopen(target, "we"));
+    if(!file) {
+        return -1;
+    }
+    profiler->dump(file.get());
+    return 0;
+}
+
 unsigned short DSState_option(const DSState *st) {
     unsigned short option = 0;
 
@@ -465,6 +529,15 @@ unsigned short DSState_option(const DSState *st) {
     if(hasFlag(st->compileOption, CompileOption::INTERACTIVE)) {
         setFlag(option, DS_OPTION_INTERACTIVE);
     }
+    if(hasFlag(st->compileOption, CompileOption::MODULE_CACHE)) {
+        setFlag(option, DS_OPTION_MODULE_CACHE);
+    }
+    if(hasFlag(st->compileOption, CompileOption::PEEPHOLE)) {
+        setFlag(option, DS_OPTION_PEEPHOLE);
+    }
+    if(hasFlag(st->compileOption, CompileOption::PARALLEL_LOAD)) {
+        setFlag(option, DS_OPTION_PARALLEL_LOAD);
+    }
 
     // get runtime option
     if(hasFlag(st->runtimeOption, RuntimeOption::TRACE_EXIT)) {
@@ -484,6 +557,15 @@ void DSState_setOption(DSState *st, unsigned short optionSet) {
     if(hasFlag(optionSet, DS_OPTION_INTERACTIVE)) {
         setFlag(st->compileOption, CompileOption::INTERACTIVE);
     }
+    if(hasFlag(optionSet, DS_OPTION_MODULE_CACHE)) {
+        setFlag(st->compileOption, CompileOption::MODULE_CACHE);
+    }
+    if(hasFlag(optionSet, DS_OPTION_PEEPHOLE)) {
+        setFlag(st->compileOption, CompileOption::PEEPHOLE);
+    }
+    if(hasFlag(optionSet, DS_OPTION_PARALLEL_LOAD)) {
+        setFlag(st->compileOption, CompileOption::PARALLEL_LOAD);
+    }
 
     // set runtime option
     if(hasFlag(optionSet, DS_OPTION_TRACE_EXIT)) {
@@ -503,6 +585,15 @@ void DSState_unsetOption(DSState *st, unsigned short optionSet) {
     if(hasFlag(optionSet, DS_OPTION_INTERACTIVE)) {
         unsetFlag(st->compileOption, CompileOption::INTERACTIVE);
     }
+    if(hasFlag(optionSet, DS_OPTION_MODULE_CACHE)) {
+        unsetFlag(st->compileOption, CompileOption::MODULE_CACHE);
+    }
+    if(hasFlag(optionSet, DS_OPTION_PEEPHOLE)) {
+        unsetFlag(st->compileOption, CompileOption::PEEPHOLE);
+    }
+    if(hasFlag(optionSet, DS_OPTION_PARALLEL_LOAD)) {
+        unsetFlag(st->compileOption, CompileOption::PARALLEL_LOAD);
+    }
 
     // unset runtime option
     if(hasFlag(optionSet, DS_OPTION_TRACE_EXIT)) {
@@ -571,7 +662,7 @@ int DSState_loadAndEval(DSState *st, const char *sourceName, DSError *e) {
 
     // read data
     assert(filePtr);
-    ByteBuffer buf;
+    SourceBuffer buf;
     sourceName = sourceName == nullptr ? "(stdin)" : sourceName;
     if(!readAll(filePtr, buf)) {
         reportFileError(sourceName, true, e);
@@ -653,6 +744,14 @@ static constexpr unsigned int featureBit() {
 #ifdef USE_SAFE_CAST
     setFlag(featureBit, DS_FEATURE_SAFE_CAST);
 #endif
+
+#ifdef USE_THREADED_CODE
+    setFlag(featureBit, DS_FEATURE_THREADED_CODE);
+#endif
+
+#ifdef USE_OBJECT_POOL
+    setFlag(featureBit, DS_FEATURE_OBJECT_POOL);
+#endif
     return featureBit;
 }
 
@@ -675,7 +774,7 @@ unsigned int DSState_completionOp(DSState *st, DSCompletionOp op, unsigned int i
         }
 
         auto old = st->getGlobal(BuiltinVarOffset::EXIT_STATUS);
-        completeLine(*st, *value, index);
+        completeLine(*st, *value, index, true);
         st->setGlobal(BuiltinVarOffset::EXIT_STATUS, std::move(old));
         break;
     }
@@ -685,7 +784,7 @@ unsigned int DSState_completionOp(DSState *st, DSCompletionOp op, unsigned int i
         }
         *value = nullptr;
         if(index < compreply.getValues().size()) {
-            *value = compreply.getValues()[index].asStrRef().data();
+            *value = compreply.getValues()[index].asCStr();
         }
         break;
     case DS_COMP_SIZE:
@@ -693,6 +792,11 @@ unsigned int DSState_completionOp(DSState *st, DSCompletionOp op, unsigned int i
     case DS_COMP_CLEAR:
         compreply.refValues().clear();
         break;
+    case DS_COMP_TIME:
+        return st->compCache.getElapsed();
+    case DS_COMP_BUDGET:
+        st->compCache.setBudget(index);
+        break;
     }
     return 0;
 }
@@ -763,10 +867,11 @@ unsigned int DSState_lineEditOp(DSState *st, DSLineEditOp op, int index, const c
             return 0;
         }
         if(op == DS_EDIT_PROMPT) {
-            st->prompt = st->editOpReply;
-            *buf = st->prompt.asStrRef().data();
+            st->prompt = st->editOpReply.materialize();
+            *buf = st->prompt.asCStr();
         } else {
-            *buf = st->editOpReply.asStrRef().data();
+            st->editOpReply = st->editOpReply.materialize();
+            *buf = st->editOpReply.asCStr();
         }
         break;
     default:
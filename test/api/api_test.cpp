@@ -6,6 +6,7 @@
 #include <ydsh/ydsh.h>
 #include <config.h>
 #include <misc/fatal.h>
+#include <misc/resource.hpp>
 #include <constant.h>
 
 #include <pwd.h>
@@ -225,12 +226,95 @@ TEST_F(APITest, complete) {
     }
 }
 
+static std::vector<std::string> complete(DSState *state, const char *line) {
+    DSState_completionOp(state, DS_COMP_INVOKE, strlen(line), &line);
+    std::vector<std::string> ret;
+    unsigned int size = DSState_completionOp(state, DS_COMP_SIZE, 0, nullptr);
+    for(unsigned int i = 0; i < size; i++) {
+        const char *value = nullptr;
+        DSState_completionOp(state, DS_COMP_GET, i, &value);
+        ret.emplace_back(value);
+    }
+    DSState_completionOp(state, DS_COMP_CLEAR, 0, nullptr);
+    return ret;
+}
+
+TEST_F(APITest, completeCache) {
+    const char *src = "ccc_aaa1() {}; ccc_aaa2() {}; ccc_bbb() {}";
+    DSState_eval(this->state, nullptr, src, strlen(src), nullptr);
+
+    auto ret = complete(this->state, "ccc_");
+    ASSERT_EQ(3u, ret.size());
+    ASSERT_EQ("ccc_aaa1", ret[0]);
+    ASSERT_EQ("ccc_aaa2", ret[1]);
+    ASSERT_EQ("ccc_bbb", ret[2]);
+
+    // narrow cached candidates
+    ret = complete(this->state, "ccc_a");
+    ASSERT_EQ(2u, ret.size());
+    ASSERT_EQ("ccc_aaa1", ret[0]);
+    ASSERT_EQ("ccc_aaa2", ret[1]);
+
+    ret = complete(this->state, "ccc_aaa2");
+    ASSERT_EQ(1u, ret.size());
+    ASSERT_EQ("ccc_aaa2", ret[0]);
+
+    ret = complete(this->state, "ccc_b");
+    ASSERT_EQ(1u, ret.size());
+    ASSERT_EQ("ccc_bbb", ret[0]);
+
+    // clear cache after evaluation
+    ret = complete(this->state, "ccc_a");
+    ASSERT_EQ(2u, ret.size());
+    src = "ccc_abc() {}";
+    DSState_eval(this->state, nullptr, src, strlen(src), nullptr);
+    ret = complete(this->state, "ccc_ab");
+    ASSERT_EQ(1u, ret.size());
+    ASSERT_EQ("ccc_abc", ret[0]);
+
+    // time budget
+    DSState_completionOp(this->state, DS_COMP_BUDGET, 0, nullptr);
+    complete(this->state, "echo ");
+    ASSERT_TRUE(DSState_completionOp(this->state, DS_COMP_TIME, 0, nullptr) < 60u * 1000 * 1000);
+}
+
 TEST_F(APITest, option) {
-    ASSERT_EQ(DS_OPTION_ASSERT, DSState_option(this->state));
+    ASSERT_EQ(DS_OPTION_ASSERT | DS_OPTION_PEEPHOLE, DSState_option(this->state));
     DSState_unsetOption(this->state, DS_OPTION_ASSERT);
+    ASSERT_EQ(DS_OPTION_PEEPHOLE, DSState_option(this->state));
+    DSState_unsetOption(this->state, DS_OPTION_PEEPHOLE);
     ASSERT_EQ(0, DSState_option(this->state));
 }
 
+TEST_F(APITest, profile) {
+    ASSERT_EQ(-1, DSState_stopProfile(this->state, nullptr));
+    ASSERT_EQ(0, DSState_startProfile(this->state, DS_PROFILE_EXACT, 0));
+    ASSERT_EQ(-1, DSState_startProfile(this->state, DS_PROFILE_SAMPLE, 0));
+
+    std::string src = R"(
+function fact($n : Int) : Int { return $n < 2 ? 1 : $n * $fact($n - 1); }
+assert $fact(10) == 3628800
+)";
+    int r = DSState_eval(this->state, "target.ds", src.c_str(), src.size(), nullptr);
+    ASSERT_EQ(0, r);
+
+    std::string fileName = this->getTempDirName();
+    fileName += "/profile.txt";
+    ASSERT_EQ(0, DSState_stopProfile(this->state, fileName.c_str()));
+    ASSERT_EQ(-1, DSState_stopProfile(this->state, nullptr));
+
+    std::string content;
+    ASSERT_TRUE(ydsh::readAll(ydsh::createFilePtr(fopen, fileName.c_str(), "r"), content));
+    ASSERT_THAT(content, ::testing::HasSubstr("### opcode profile ###\n"));
+    ASSERT_THAT(content, ::testing::HasSubstr("RETURN_V"));
+    ASSERT_THAT(content, ::testing::ContainsRegex("  +10 +[0-9]+ +[0-9]+  function fact \\(target\\.ds\\)\n"));
+    ASSERT_THAT(content, ::testing::HasSubstr("  <toplevel> (target.ds)\n"));
+
+    // sampling mode
+    ASSERT_EQ(0, DSState_startProfile(this->state, DS_PROFILE_SAMPLE, 100));
+    ASSERT_EQ(0, DSState_stopProfile(this->state, nullptr));
+}
+
 TEST_F(APITest, status) {
     int s = DSState_getExitStatus(this->state);
     ASSERT_EQ(0, s);
@@ -442,6 +526,115 @@ TEST_F(APITest, module5) {
                     "ydsh: [semantic error] module not found: `freijjfeir'"));
 }
 
+TEST_F(APITest, moduleCache) {
+    std::string cacheDir = this->getTempDirName();
+    cacheDir += "/cache";
+    setenv("YDSH_MODULE_CACHE_DIR", cacheDir.c_str(), 1);
+
+    auto fileName = this->createTempFile("cached.ds", R"(
+alias CacheTarget = [String : (Int, Float)]
+var CACHED_VALUE : CacheTarget = ["a" : (1, 3.14)]
+function cachedFunc($s : String) : Int {
+    return case $s {
+        'hello' => 1
+        'world' => $s =~ $/^w.*d$/ ? 2 : 0
+        else => 3
+    }
+}
+cached_cmd() { echo cached: $@; }
+)");
+
+    for(unsigned int i = 0; i < 2; i++) {
+        DSState *st = DSState_create();
+        DSState_setOption(st, DS_OPTION_MODULE_CACHE);
+        int r = DSState_loadModule(st, fileName.c_str(), 0, nullptr);
+        ASSERT_EQ(0, r);
+        if(i == 0) {
+            ASSERT_EQ(1, ydsh::getFileList(cacheDir.c_str()).size());
+        }
+
+        std::string src = R"EOF(
+var v : CacheTarget = $CACHED_VALUE
+assert $v["a"]._0 == 1
+assert $cachedFunc("hello") == 1 && $cachedFunc("world") == 2 && $cachedFunc("a") == 3
+assert "$(cached_cmd 12)" == "cached: 12"
+)EOF";
+        r = DSState_eval(st, "(string)", src.c_str(), src.size(), nullptr);
+        DSState_delete(&st);
+        ASSERT_EQ(0, r);
+    }
+
+    // broken cache is treated as cache miss (compile from source)
+    auto cacheFiles = ydsh::getFileList(cacheDir.c_str());
+    ASSERT_EQ(1, cacheFiles.size());
+    struct stat st1; //NOLINT
+    ASSERT_EQ(0, stat(cacheFiles[0].c_str(), &st1));
+    ASSERT_EQ(0, truncate(cacheFiles[0].c_str(), st1.st_size - 8));
+    {
+        DSState *st = DSState_create();
+        DSState_setOption(st, DS_OPTION_MODULE_CACHE);
+        int r = DSState_loadModule(st, fileName.c_str(), 0, nullptr);
+        ASSERT_EQ(0, r);
+        std::string src = R"EOF(assert "$(cached_cmd 34)" == "cached: 34")EOF";
+        r = DSState_eval(st, "(string)", src.c_str(), src.size(), nullptr);
+        DSState_delete(&st);
+        ASSERT_EQ(0, r);
+    }
+    unsetenv("YDSH_MODULE_CACHE_DIR");
+}
+
+TEST_F(APITest, parallelLoad) {
+    this->createTempFile("common.ds", "var COMMON = 'common'\n");
+    this->createTempFile("lib1.ds", "source $SCRIPT_DIR/common.ds\nvar LIB1 = $COMMON + '1'\n");
+    this->createTempFile("lib2.ds", "source $SCRIPT_DIR/common.ds as c\nvar LIB2 = $c.COMMON + '2'\n");
+    this->createTempFile("broken.ds", "var BROKEN = 1\nvar b = (\n");
+    auto fileName = this->createTempFile("main.ds", R"(
+source $SCRIPT_DIR/lib1.ds
+source $SCRIPT_DIR/lib2.ds
+assert $LIB1 == 'common1'
+assert $LIB2 == 'common2'
+)");
+    auto brokenName = this->createTempFile("main2.ds", "source $SCRIPT_DIR/lib1.ds\nsource $SCRIPT_DIR/broken.ds\n");
+
+    for(unsigned int i = 0; i < 2; i++) {
+        DSState *st = DSState_create();
+        if(i == 1) {
+            DSState_setOption(st, DS_OPTION_PARALLEL_LOAD);
+        }
+        int r = DSState_loadModule(st, fileName.c_str(), DS_MOD_FULLPATH, nullptr);
+        DSState_delete(&st);
+        ASSERT_EQ(0, r);
+
+        // parse error in module is reported at the same position
+        st = DSState_create();
+        if(i == 1) {
+            DSState_setOption(st, DS_OPTION_PARALLEL_LOAD);
+        }
+        DSError e;
+        r = DSState_loadModule(st, brokenName.c_str(), DS_MOD_FULLPATH, &e);
+        DSState_delete(&st);
+        ASSERT_EQ(1, r);
+        ASSERT_EQ(DS_ERROR_KIND_PARSE_ERROR, e.kind);
+        ASSERT_NE(std::string::npos, std::string(e.fileName).find("broken.ds"));
+        ASSERT_EQ(2, e.lineNum);
+        DSError_release(&e);
+    }
+
+    // with module cache (modules having fresh cache are not prefetched)
+    std::string cacheDir = this->getTempDirName();
+    cacheDir += "/cache";
+    setenv("YDSH_MODULE_CACHE_DIR", cacheDir.c_str(), 1);
+    for(unsigned int i = 0; i < 2; i++) {
+        DSState *st = DSState_create();
+        DSState_setOption(st, DS_OPTION_MODULE_CACHE | DS_OPTION_PARALLEL_LOAD);
+        int r = DSState_loadModule(st, fileName.c_str(), DS_MOD_FULLPATH, nullptr);
+        DSState_delete(&st);
+        ASSERT_EQ(0, r);
+        ASSERT_FALSE(ydsh::getFileList(cacheDir.c_str()).empty());
+    }
+    unsetenv("YDSH_MODULE_CACHE_DIR");
+}
+
 struct Executor {
     std::string str;
     bool jobctrl;
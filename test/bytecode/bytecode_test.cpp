@@ -303,6 +303,185 @@ TEST(writer, label2) {
     ASSERT_EQ(0x00, writer.codeBuffer[7]);
 }
 
+struct PeepholeTest : public ::testing::Test {
+    PeepholeStats stats;
+    CodeBuffer code;
+    std::vector<DSValue> constBuffer;
+    std::vector<unsigned int> jumpTables;
+    FlexBuffer<LineNumEntry> lineNumEntries;
+    std::vector<ExceptionEntry> exceptEntries;
+
+    void append(OpCode op) {
+        this->code += static_cast<unsigned char>(op);
+    }
+
+    void append(OpCode op, unsigned char v) {
+        this->append(op);
+        this->code += v;
+    }
+
+    void append(OpCode op, unsigned char v1, unsigned char v2) {
+        this->append(op, v1);
+        this->code += v2;
+    }
+
+    void appendJump(OpCode op, unsigned int target) {
+        const unsigned int index = this->code.size();
+        this->append(op);
+        if(op == OpCode::GOTO) {
+            this->code.assign(4, 0);
+            write32(this->code.get() + index + 1, target);
+        } else {
+            this->code.assign(2, 0);
+            write16(this->code.get() + index + 1, target - index);
+        }
+    }
+
+    bool optimize() {
+        PeepholeOptimizer optimizer(this->stats);
+        return optimizer(this->code, this->constBuffer, this->jumpTables, this->lineNumEntries, this->exceptEntries);
+    }
+
+    void expect(std::initializer_list<unsigned char> list) {
+        ASSERT_EQ(list.size(), this->code.size());
+        unsigned int index = 0;
+        for(auto &e : list) {
+            ASSERT_EQ(e, this->code[index]);
+            index++;
+        }
+    }
+
+    unsigned int count(PeepholeRule rule) const {
+        return this->stats.ruleCount[static_cast<unsigned int>(rule)];
+    }
+};
+
+#define OP(O) static_cast<unsigned char>(OpCode::O)
+
+TEST_F(PeepholeTest, local) {
+    this->append(OpCode::LOAD_LOCAL, 0);
+    this->append(OpCode::LOAD_LOCAL, 1);
+    this->append(OpCode::ADD_INT);
+    this->append(OpCode::POP);
+    this->append(OpCode::LOAD_LOCAL, 2);
+    this->append(OpCode::PUSH_INT, 1);
+    this->append(OpCode::SUB_INT);
+    this->append(OpCode::STORE_LOCAL, 2);
+    this->append(OpCode::RETURN);
+    this->lineNumEntries.push_back({0, 1});
+    this->lineNumEntries.push_back({10, 2});
+
+    ASSERT_TRUE(this->optimize());
+    ASSERT_NO_FATAL_FAILURE(this->expect({
+        OP(LOAD_LOCAL2), 0, 1,
+        OP(ADD_INT),
+        OP(POP),
+        OP(DEC_LOCAL), 2, 1,
+        OP(RETURN),
+    }));
+    ASSERT_EQ(2u, this->lineNumEntries.size());
+    ASSERT_EQ(0u, this->lineNumEntries[0].address);
+    ASSERT_EQ(1u, this->lineNumEntries[0].lineNum);
+    ASSERT_EQ(5u, this->lineNumEntries[1].address);
+    ASSERT_EQ(2u, this->lineNumEntries[1].lineNum);
+    ASSERT_EQ(1u, this->count(PeepholeRule::LOAD_LOCAL2));
+    ASSERT_EQ(1u, this->count(PeepholeRule::DEC_LOCAL));
+    ASSERT_EQ(14u, this->stats.oldSize);
+    ASSERT_EQ(9u, this->stats.newSize);
+}
+
+TEST_F(PeepholeTest, jump) {
+    this->append(OpCode::LOAD_LOCAL, 0);    // 0
+    this->appendJump(OpCode::BRANCH, 12);   // 2
+    this->append(OpCode::DUP);              // 5
+    this->append(OpCode::POP);              // 6
+    this->appendJump(OpCode::GOTO, 17);     // 7
+    this->appendJump(OpCode::GOTO, 17);     // 12
+    this->append(OpCode::RETURN);           // 17
+    this->exceptEntries.push_back({
+        .type = nullptr,
+        .begin = 0,
+        .end = 17,
+        .dest = 17,
+        .localOffset = 0,
+        .localSize = 0,
+    });
+
+    ASSERT_TRUE(this->optimize());
+    ASSERT_NO_FATAL_FAILURE(this->expect({
+        OP(LOAD_LOCAL), 0,
+        OP(BRANCH), 0, 8,
+        OP(GOTO), 0, 0, 0, 10,
+        OP(RETURN),
+    }));
+    ASSERT_EQ(0u, this->exceptEntries[0].begin);
+    ASSERT_EQ(10u, this->exceptEntries[0].end);
+    ASSERT_EQ(10u, this->exceptEntries[0].dest);
+    ASSERT_EQ(1u, this->count(PeepholeRule::JUMP_THREAD));
+    ASSERT_EQ(1u, this->count(PeepholeRule::DUP_POP));
+    ASSERT_EQ(1u, this->count(PeepholeRule::GOTO_NEXT));
+}
+
+TEST_F(PeepholeTest, branch) {
+    this->append(OpCode::PUSH_FALSE);       // 0
+    this->appendJump(OpCode::BRANCH, 8);    // 1
+    this->append(OpCode::PUSH_TRUE);        // 4
+    this->appendJump(OpCode::BRANCH, 8);    // 5
+    this->append(OpCode::RETURN);           // 8
+
+    ASSERT_TRUE(this->optimize());
+    ASSERT_NO_FATAL_FAILURE(this->expect({OP(RETURN)}));
+    ASSERT_EQ(2u, this->count(PeepholeRule::CONST_BRANCH));
+    ASSERT_EQ(1u, this->count(PeepholeRule::GOTO_NEXT));
+}
+
+TEST_F(PeepholeTest, boundary) {
+    this->appendJump(OpCode::BRANCH, 5);    // 0
+    this->append(OpCode::LOAD_LOCAL, 0);    // 3
+    this->append(OpCode::LOAD_LOCAL, 1);    // 5
+    this->append(OpCode::DUP);              // 7
+    this->append(OpCode::POP);              // 8
+    this->append(OpCode::RETURN);           // 9
+    this->exceptEntries.push_back({
+        .type = nullptr,
+        .begin = 0,
+        .end = 8,
+        .dest = 9,
+        .localOffset = 0,
+        .localSize = 0,
+    });
+
+    // not merge jump target
+    ASSERT_TRUE(this->optimize());
+    ASSERT_NO_FATAL_FAILURE(this->expect({
+        OP(BRANCH), 0, 5,
+        OP(LOAD_LOCAL), 0,
+        OP(LOAD_LOCAL), 1,
+        OP(DUP),
+        OP(POP),
+        OP(RETURN),
+    }));
+    ASSERT_EQ(0u, this->count(PeepholeRule::LOAD_LOCAL2));
+    ASSERT_EQ(0u, this->count(PeepholeRule::DUP_POP));
+}
+
+TEST_F(PeepholeTest, reclaim) {
+    this->append(OpCode::RECLAIM_LOCAL, 3, 2);
+    this->append(OpCode::RECLAIM_LOCAL, 1, 2);
+    this->append(OpCode::RECLAIM_LOCAL, 6, 1);
+    this->append(OpCode::RETURN);
+
+    ASSERT_TRUE(this->optimize());
+    ASSERT_NO_FATAL_FAILURE(this->expect({
+        OP(RECLAIM_LOCAL), 1, 4,
+        OP(RECLAIM_LOCAL), 6, 1,
+        OP(RETURN),
+    }));
+    ASSERT_EQ(1u, this->count(PeepholeRule::MERGE_RECLAIM));
+}
+
+#undef OP
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
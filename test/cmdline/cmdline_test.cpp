@@ -204,10 +204,10 @@ DSCode: top level
   code size: 12
   max stack depth: 1
   number of local variable: 0
-  number of global variable: 52
+  number of global variable: 53
 Code:
    0: PUSH_INT  34
-   2: STORE_GLOBAL  51
+   2: STORE_GLOBAL  52
    5: PUSH_INT  34
    7: CALL_NATIVE2  1  %s
   10: POP
@@ -228,11 +228,11 @@ DSCode: top level
   code size: 26
   max stack depth: 3
   number of local variable: 0
-  number of global variable: 52
+  number of global variable: 53
 Code:
    0: LOAD_CONST  2
-   2: STORE_GLOBAL  51
-   5: LOAD_GLOBAL  51
+   2: STORE_GLOBAL  52
+   5: LOAD_GLOBAL  52
    8: PUSH_INT  1
   10: CALL_FUNC  1
   12: ENTER_FINALLY  8
@@ -268,6 +268,75 @@ Exception Table:
 )", getCwd().c_str(), getCwd().c_str());
     const char *s = "function f($a : Any) : Boolean { return $a is Array<Int>; }; try { $f(1) } finally {3}";
     ASSERT_NO_FATAL_FAILURE(this->expect(ds("--dump-code", "-c", s), 0, msg));
+
+    // typed instruction and constant folding
+    msg = format(R"(### dump compiled code ###
+Source File: (string)
+DSCode: top level
+  code size: 16
+  max stack depth: 2
+  number of local variable: 0
+  number of global variable: 53
+Code:
+   0: PUSH_INT  34
+   2: STORE_GLOBAL  52
+   5: LOAD_GLOBAL  52
+   8: PUSH_INT  1
+  10: ADD_INT
+  11: PUSH_INT  28
+  13: LT_INT
+  14: POP
+  15: RETURN
+Constant Pool:
+  0: String (string)
+  1: String %s
+Line Number Table:
+  lineNum: 1, address: 10
+Exception Table:
+
+)", getCwd().c_str());
+    ASSERT_NO_FATAL_FAILURE(this->expect(ds("--dump-code", "-c", "var a = 34; $a + 1 < 10 * 3 + -2"), 0, msg));
+
+    // peephole optimization
+    msg = format(R"(### dump compiled code ###
+Source File: (string)
+DSCode: top level
+  code size: 6
+  max stack depth: 1
+  number of local variable: 0
+  number of global variable: 53
+Code:
+  0: LOAD_CONST  2
+  2: STORE_GLOBAL  52
+  5: RETURN
+Constant Pool:
+  0: String (string)
+  1: String %s
+  2: (Int) -> Int function(f)
+Line Number Table:
+Exception Table:
+
+DSCode: function f
+  code size: 12
+  max stack depth: 2
+  number of local variable: 2
+Code:
+   0: LOAD_LOCAL  0
+   2: STORE_LOCAL  1
+   4: INC_LOCAL  1  1
+   7: LOAD_LOCAL2  0  1
+  10: ADD_INT
+  11: RETURN_V
+Constant Pool:
+  0: String (string)
+  1: String %s
+Line Number Table:
+  lineNum: 1, address: 4
+Exception Table:
+
+)", getCwd().c_str(), getCwd().c_str());
+    s = "function f($a : Int) : Int { var b = $a; $b++; return $a + $b; }";
+    ASSERT_NO_FATAL_FAILURE(this->expect(ds("--dump-code", "-c", s), 0, msg));
 }
 
 TEST_F(CmdlineTest, parse_only) {
@@ -444,10 +513,14 @@ TEST_F(CmdlineTest, logger) {
     if(useLogging) {
         ASSERT_NO_FATAL_FAILURE(this->expect(ds("-c", cmd.c_str()), 0, "USE_LOGGING\n"));
 
-        auto builder = ds("-c", "sh -c true").addEnv("YDSH_DUMP_EXEC", "on");
+        auto builder = ds("-c", "exec sh -c true").addEnv("YDSH_DUMP_EXEC", "on");
         const char *re = ".+\\(xexecve\\).+";
         ASSERT_NO_FATAL_FAILURE(this->expectRegex(std::move(builder), 0, "", re));
 
+        builder = ds("-c", "sh -c true").addEnv("YDSH_DUMP_EXEC", "on");
+        re = ".+\\(spawn\\).+";
+        ASSERT_NO_FATAL_FAILURE(this->expectRegex(std::move(builder), 0, "", re));
+
         // specify appender
         builder = ds("-c", "var a = 0; exit $a")
                 .addEnv("YDSH_TRACE_TOKEN", "on")
@@ -6,6 +6,7 @@
 
 #include <misc/glob.hpp>
 #include <misc/string_ref.hpp>
+#include <misc/files.h>
 
 #ifndef GLOB_TEST_WORK_DIR
 #error "require EXEC_TEST_DIR"
@@ -63,9 +64,9 @@ public:
         return globBase<StrMetaChar>(dir, pattern, pattern + strlen(pattern), appender, option);
     }
 
-    unsigned int testGlob(const char *pattern, WildMatchOption option = {}) {
+    unsigned int testGlob(const char *pattern, WildMatchOption option = {}, DirEntryCache *cache = nullptr) {
         Appender appender(this->ret);
-        return glob<StrMetaChar>(pattern, pattern + strlen(pattern), appender, option);
+        return glob<StrMetaChar>(pattern, pattern + strlen(pattern), appender, option, cache);
     }
 };
 
@@ -130,6 +131,41 @@ TEST_F(GlobTest, pattern2) {
     ASSERT_EQ(WildMatchResult::DOTDOT, matchPatternRaw("huga", ".."));    // always match
 }
 
+static GlobSegmentKind compileSegment(const char *p) {
+    return GlobSegment<const char *>::compile<StrMetaChar>(p, p + strlen(p)).getKind();
+}
+
+TEST_F(GlobTest, segment) {
+    ASSERT_EQ(GlobSegmentKind::EMPTY, compileSegment(""));
+    ASSERT_EQ(GlobSegmentKind::EMPTY, compileSegment("/hoge"));
+    ASSERT_EQ(GlobSegmentKind::LITERAL, compileSegment("hoge"));
+    ASSERT_EQ(GlobSegmentKind::LITERAL, compileSegment(".."));
+    ASSERT_EQ(GlobSegmentKind::LITERAL, compileSegment("hoge/*"));
+    ASSERT_EQ(GlobSegmentKind::PREFIX, compileSegment("*"));
+    ASSERT_EQ(GlobSegmentKind::PREFIX, compileSegment("**/"));
+    ASSERT_EQ(GlobSegmentKind::PREFIX, compileSegment("lib*"));
+    ASSERT_EQ(GlobSegmentKind::SUFFIX, compileSegment("*.so"));
+    ASSERT_EQ(GlobSegmentKind::SUFFIX, compileSegment("***.so/hoge"));
+    ASSERT_EQ(GlobSegmentKind::PREFIX_SUFFIX, compileSegment("lib*.so"));
+    ASSERT_EQ(GlobSegmentKind::GENERAL, compileSegment("lib*.so*"));
+    ASSERT_EQ(GlobSegmentKind::GENERAL, compileSegment("lib?.so"));
+    ASSERT_EQ(GlobSegmentKind::GENERAL, compileSegment("?"));
+
+    const char *p = "lib*.so";
+    auto segment = GlobSegment<const char *>::compile<StrMetaChar>(p, p + strlen(p));
+    ASSERT_TRUE(segment.match("libfoo.so", {}));
+    ASSERT_TRUE(segment.match("lib.so", {}));
+    ASSERT_FALSE(segment.match("lib.s", {}));
+    ASSERT_FALSE(segment.match("libso", {}));
+    ASSERT_FALSE(segment.match("xlib.so", {}));
+
+    p = "*.conf";
+    segment = GlobSegment<const char *>::compile<StrMetaChar>(p, p + strlen(p));
+    ASSERT_TRUE(segment.match("a.conf", {}));
+    ASSERT_FALSE(segment.match(".conf", {}));
+    ASSERT_TRUE(segment.match(".conf", WildMatchOption::DOTGLOB));
+}
+
 // test `globBase' api
 
 TEST_F(GlobTest, base_invalid) {    // invalid base dir
@@ -372,6 +408,80 @@ TEST_F(GlobTest, glob) {
     ASSERT_EQ(0, ret.size());
 }
 
+TEST_F(GlobTest, cache) {
+    DirEntryCache cache;
+    ASSERT_TRUE(cache.empty());
+
+    auto s = testGlob("bbb/*", {}, &cache);
+    ASSERT_EQ(2, s);
+    ASSERT_EQ(2, ret.size());
+    ASSERT_EQ("bbb/AA21", ret[0]);
+    ASSERT_EQ("bbb/b21", ret[1]);
+    ASSERT_FALSE(cache.empty());
+
+    // reuse entries
+    s = testGlob("bbb/*", WildMatchOption::DOTGLOB, &cache);
+    ASSERT_EQ(3, s);
+    ASSERT_EQ(3, ret.size());
+    ASSERT_EQ("bbb/.hidden", ret[0]);
+    ASSERT_EQ("bbb/AA21", ret[1]);
+    ASSERT_EQ("bbb/b21", ret[2]);
+
+    s = testGlob("*/*/*", {}, &cache);
+    ASSERT_EQ(2, s);
+    ASSERT_EQ(2, ret.size());
+    ASSERT_EQ("bbb/b21/A321", ret[0]);
+    ASSERT_EQ("bbb/b21/D", ret[1]);
+
+    cache.clear();
+    ASSERT_TRUE(cache.empty());
+}
+
+struct GlobParallelTest : public ::testing::Test, public TempFileFactory {
+    std::vector<std::string> ret; // result paths
+
+    GlobParallelTest() {
+        // create enough directories for concurrent expansion
+        for(unsigned int i = 0; i < GLOB_PARALLEL_THRESHOLD * 4; i++) {
+            std::string dir = this->getTempDirName();
+            dir += "/dir";
+            dir += std::to_string(i);
+            mkdir(dir.c_str(), 0755);
+            this->createTempFile(("dir" + std::to_string(i) + "/a.o").c_str(), "");
+            this->createTempFile(("dir" + std::to_string(i) + "/b.c").c_str(), "");
+        }
+    }
+
+    unsigned int testGlob(const std::string &pattern, DirEntryCache *cache = nullptr) {
+        Appender appender(this->ret);
+        return glob<StrMetaChar>(pattern.c_str(), pattern.c_str() + pattern.size(), appender, {}, cache);
+    }
+};
+
+TEST_F(GlobParallelTest, base) {
+    const unsigned int size = GLOB_PARALLEL_THRESHOLD * 4;
+    std::string pattern = this->getTempDirName();
+    pattern += "/*/*.o";
+    auto s = testGlob(pattern);
+    ASSERT_EQ(size, s);
+    ASSERT_EQ(size, ret.size());
+    for(auto &e : ret) {
+        ASSERT_EQ('o', e.back());
+    }
+
+    DirEntryCache cache;
+    s = testGlob(pattern, &cache);
+    ASSERT_EQ(size, s);
+    s = testGlob(pattern, &cache);
+    ASSERT_EQ(size, s);
+
+    pattern = this->getTempDirName();
+    pattern += "/dir?/";
+    s = testGlob(pattern);
+    ASSERT_EQ(10, s);
+    ASSERT_EQ(std::string(this->getTempDirName()) + "/dir0/", ret[0]);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
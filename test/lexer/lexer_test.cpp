@@ -1879,6 +1879,66 @@ TEST(LineNumTest, case4) {
     ASSERT_EQ(5u, table.lookup(13));
 }
 
+TEST(LineNumTest, lazy) {
+    const char *text = "echo 1\necho 2\n\necho 3";
+    Lexer lexer("(string)", ByteBuffer(text, text + strlen(text)), nullptr);
+    ASSERT_EQ(1u, lexer.getMaxLineNum());   // not read yet
+    ASSERT_EQ(1u, lexer.getLineNumByPos(0));
+    ASSERT_EQ(1u, lexer.getLineNumByPos(6));
+    ASSERT_EQ(2u, lexer.getLineNumByPos(7));
+    ASSERT_EQ(4u, lexer.getLineNumByPos(16));
+    ASSERT_EQ(3u, lexer.getLineNumByPos(14));   // already scanned
+
+    Token t;
+    while(lexer.nextToken(t) != TokenKind::EOS);
+    ASSERT_EQ(5u, lexer.getMaxLineNum());
+}
+
+TEST(MappedFileTest, base) {
+    TempFileFactory factory;
+    std::string content(MappedFile::MIN_SIZE, 'a');
+    content += "\n# comment\necho hello";
+    auto fileName = factory.createTempFile("large.ds", content);
+
+    {
+        auto filePtr = createFilePtr(fopen, fileName.c_str(), "rbe");
+        ASSERT_TRUE(filePtr);
+        SourceBuffer buf;
+        ASSERT_TRUE(readAll(filePtr, buf));
+        ASSERT_TRUE(buf.isMapped());
+        ASSERT_EQ(content.size() + 2, buf.size());    // append newline and null
+        ASSERT_EQ('o', buf[content.size() - 1]);
+        ASSERT_EQ('\n', buf[content.size()]);
+        ASSERT_EQ('\0', buf[content.size() + 1]);
+        ASSERT_EQ(static_cast<off_t>(content.size()), lseek(fileno(filePtr.get()), 0, SEEK_CUR));
+
+        Lexer lexer(fileName.c_str(), std::move(buf), nullptr);
+        ASSERT_EQ(3u, lexer.getLineNumByPos(content.size() - 1));
+    }
+
+    // not beginning of file (ex. shared stdin)
+    {
+        auto filePtr = createFilePtr(fopen, fileName.c_str(), "rbe");
+        ASSERT_TRUE(filePtr);
+        ASSERT_EQ(0, fseek(filePtr.get(), 10, SEEK_SET));
+        SourceBuffer buf;
+        ASSERT_TRUE(readAll(filePtr, buf));
+        ASSERT_FALSE(buf.isMapped());
+        ASSERT_EQ(content.size() - 10, buf.size());
+    }
+
+    // small file
+    fileName = factory.createTempFile("small.ds", "echo hello\n");
+    {
+        auto filePtr = createFilePtr(fopen, fileName.c_str(), "rbe");
+        ASSERT_TRUE(filePtr);
+        SourceBuffer buf;
+        ASSERT_TRUE(readAll(filePtr, buf));
+        ASSERT_FALSE(buf.isMapped());
+        ASSERT_EQ(11u, buf.size());
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
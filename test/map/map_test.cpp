@@ -0,0 +1,230 @@
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <misc/ordered_map.hpp>
+#include <misc/flat_map.hpp>
+
+using namespace ydsh;
+
+struct StrHash {
+    std::size_t operator()(const std::string &key) const {
+        return std::hash<std::string>()(key);
+    }
+};
+
+/**
+ * for hash collision
+ */
+struct BadHash {
+    std::size_t operator()(const std::string &key) const {
+        return key.size();
+    }
+};
+
+struct StrEq {
+    bool operator()(const std::string &x, const std::string &y) const {
+        return x == y;
+    }
+};
+
+template <typename Hash>
+using StrMap = OrderedHashMap<std::string, int, Hash, StrEq>;
+
+template <typename Map>
+static std::string keys(const Map &map) {
+    std::string ret;
+    for(auto &e : map) {
+        if(!ret.empty()) {
+            ret += ",";
+        }
+        ret += e.first;
+    }
+    return ret;
+}
+
+TEST(MapTest, base) {
+    StrMap<StrHash> map;
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.end(), map.find("a"));
+
+    auto ret = map.insert("c", 3);
+    ASSERT_TRUE(ret.second);
+    ASSERT_EQ(0, ret.first);
+    ret = map.insert("a", 1);
+    ASSERT_TRUE(ret.second);
+    ASSERT_EQ(1, ret.first);
+    ret = map.insert("b", 2);
+    ASSERT_TRUE(ret.second);
+    ASSERT_EQ(2, ret.first);
+    ret = map.insert("a", 100);
+    ASSERT_FALSE(ret.second);
+    ASSERT_EQ(1, ret.first);
+    ASSERT_EQ(1, map.at(1).second);
+
+    ASSERT_EQ(3, map.size());
+    ASSERT_EQ("c,a,b", keys(map));
+    ASSERT_EQ(2, map.find("b")->second);
+
+    // remove
+    unsigned int next = map.erase(map.findIndex("a"));
+    ASSERT_EQ(2, next);
+    ASSERT_EQ(2, map.size());
+    ASSERT_EQ("c,b", keys(map));
+    ASSERT_EQ(map.end(), map.find("a"));
+    ASSERT_EQ(map.endIndex(), map.findIndex("a"));
+    ASSERT_EQ(2, map.findIndex("b"));   // not changed entry index
+    ASSERT_EQ(2, map.nextIndex(1));
+
+    next = map.erase(map.findIndex("b"));
+    ASSERT_EQ(map.endIndex(), next);
+    ASSERT_EQ("c", keys(map));
+
+    ret = map.insert("a", 10);
+    ASSERT_TRUE(ret.second);
+    ASSERT_EQ("c,a", keys(map));
+
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ("", keys(map));
+}
+
+template <typename Hash>
+static void testMany() {
+    StrMap<Hash> map;
+    const int size = 2000;
+    for(int i = 0; i < size; i++) {
+        ASSERT_TRUE(map.insert(std::to_string(i), int(i)).second);
+    }
+    ASSERT_EQ(size, map.size());
+
+    // remove even numbers
+    for(int i = 0; i < size; i += 2) {
+        unsigned int index = map.findIndex(std::to_string(i));
+        ASSERT_NE(map.endIndex(), index);
+        map.erase(index);
+    }
+    ASSERT_EQ(size / 2, map.size());
+    for(int i = 0; i < size; i++) {
+        auto iter = map.find(std::to_string(i));
+        if(i % 2 == 0) {
+            ASSERT_EQ(map.end(), iter);
+        } else {
+            ASSERT_NE(map.end(), iter);
+            ASSERT_EQ(i, iter->second);
+        }
+    }
+
+    // insert after removal (compact removed entries)
+    for(int i = size; i < size * 2; i++) {
+        ASSERT_TRUE(map.insert(std::to_string(i), int(i)).second);
+    }
+    ASSERT_EQ(size / 2 + size, map.size());
+    int prev = -1;
+    unsigned int count = 0;
+    for(auto &e : map) {
+        ASSERT_LT(prev, e.second);  // keep insertion order
+        ASSERT_TRUE(e.second % 2 == 1 || e.second >= size);
+        prev = e.second;
+        count++;
+    }
+    ASSERT_EQ(map.size(), count);
+    for(int i = 0; i < size * 2; i++) {
+        bool found = map.find(std::to_string(i)) != map.end();
+        ASSERT_EQ(i % 2 == 1 || i >= size, found);
+    }
+}
+
+TEST(MapTest, many) {
+    ASSERT_NO_FATAL_FAILURE(testMany<StrHash>());
+}
+
+TEST(MapTest, collision) {
+    ASSERT_NO_FATAL_FAILURE(testMany<BadHash>());
+}
+
+TEST(FlatMapTest, base) {
+    FlatIntMap<int> map;
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(nullptr, map.find(1));
+    ASSERT_TRUE(map.begin() == map.end());
+
+    auto ret = map.insert(1, 10);
+    ASSERT_TRUE(ret.second);
+    ASSERT_EQ(10, *ret.first);
+    ret = map.insert(0, 0);
+    ASSERT_TRUE(ret.second);
+    ret = map.insert(1, 100);
+    ASSERT_FALSE(ret.second);
+    ASSERT_EQ(10, *ret.first);
+    ASSERT_EQ(2u, map.size());
+    ASSERT_EQ(10, *map.find(1));
+    ASSERT_EQ(0, *map.find(0));
+    ASSERT_EQ(nullptr, map.find(2));
+
+    map.clear();
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(nullptr, map.find(1));
+}
+
+TEST(FlatMapTest, many) {
+    FlatIntMap<int> map;
+    const int size = 20000;
+    for(int i = 0; i < size; i++) {
+        ASSERT_TRUE(map.insert(i * 4, i).second);
+    }
+    ASSERT_EQ(static_cast<unsigned int>(size), map.size());
+    for(int i = 0; i < size; i++) {
+        auto *v = map.find(i * 4);
+        ASSERT_TRUE(v != nullptr);
+        ASSERT_EQ(i, *v);
+        ASSERT_EQ(nullptr, map.find(i * 4 + 1));
+    }
+    ASSERT_LE(map.maxProbeLength(), 16u);
+
+    map.removeIf([](const FlatIntMap<int>::value_type &e) {
+        return e.second % 2 == 0;
+    });
+    ASSERT_EQ(static_cast<unsigned int>(size / 2), map.size());
+    unsigned int count = 0;
+    for(auto &e : map) {
+        ASSERT_EQ(1, e.second % 2);
+        ASSERT_EQ(e.first, static_cast<unsigned int>(e.second * 4));
+        count++;
+    }
+    ASSERT_EQ(map.size(), count);
+
+    auto copied = map;
+    ASSERT_EQ(map.size(), copied.size());
+    ASSERT_EQ(1, *copied.find(4));
+    ASSERT_EQ(nullptr, copied.find(0));
+}
+
+TEST(FlatMapTest, probe) {
+    // symbol key layout (id << 2 | kind). low bits of key are mostly same
+    for(unsigned int kind = 0; kind < 3; kind++) {
+        FlatIntMap<int> map;
+        for(unsigned int i = 0; i < 5000; i++) {
+            ASSERT_TRUE(map.insert(i << 2u | kind, 0).second);
+            if(i % 100 == 0) {
+                ASSERT_LE(map.maxProbeLength(), 16u);
+            }
+        }
+    }
+
+    // mixed kind
+    FlatIntMap<int> map;
+    for(unsigned int i = 0; i < 5000; i++) {
+        for(unsigned int kind = 0; kind < 3; kind++) {
+            ASSERT_TRUE(map.insert(i << 2u | kind, 0).second);
+        }
+    }
+    ASSERT_LE(map.maxProbeLength(), 16u);
+
+    // multiple of large power of 2
+    map.clear();
+    for(unsigned int i = 0; i < 1000; i++) {
+        ASSERT_TRUE(map.insert(i << 8u, 0).second);
+    }
+    ASSERT_LE(map.maxProbeLength(), 16u);
+}
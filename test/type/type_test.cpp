@@ -62,10 +62,10 @@ struct TypeFactory<BaseType<Name>> {
     }
 };
 
-static void addElement(std::vector<std::unique_ptr<TypeNode>> &) {}
+static void addElement(NodeVector<TypeNode> &) {}
 
 template <typename First, typename ... E>
-void addElement(std::vector<std::unique_ptr<TypeNode>> &types, First &&, E&& ...rest) {
+void addElement(NodeVector<TypeNode> &types, First &&, E&& ...rest) {
     auto e = TypeFactory<First>{}();
     types.push_back(std::move(e));
     addElement(types, std::forward<E>(rest)...);
@@ -74,7 +74,7 @@ void addElement(std::vector<std::unique_ptr<TypeNode>> &types, First &&, E&& ...
 template <const char *&Name, unsigned int N, typename ...P>
 struct TypeFactory<TypeTemp<Name, N, P...>> {
     std::unique_ptr<TypeNode> operator()() const {
-        std::vector<std::unique_ptr<TypeNode>> types;
+        NodeVector<TypeNode> types;
         addElement(types, P()...);
         return std::make_unique<ReifiedTypeNode>(
                 std::make_unique<BaseTypeNode>(Token{0, 1}, std::string(Name)),
@@ -82,10 +82,10 @@ struct TypeFactory<TypeTemp<Name, N, P...>> {
     }
 };
 
-static void addParam(std::vector<std::unique_ptr<TypeNode>> &) {}
+static void addParam(NodeVector<TypeNode> &) {}
 
 template <typename First, typename ... P>
-void addParam(std::vector<std::unique_ptr<TypeNode>> &types, First &&, P && ...rest) {
+void addParam(NodeVector<TypeNode> &types, First &&, P && ...rest) {
     auto e = TypeFactory<First>{}();
     types.push_back(std::move(e));
     addParam(types, std::forward<P>(rest)...);
@@ -95,7 +95,7 @@ template <typename R, typename ...P>
 struct TypeFactory<Func_t<R, P...>> {
     std::unique_ptr<TypeNode> operator()() const {
         auto ret = TypeFactory<R>{}();
-        std::vector<std::unique_ptr<TypeNode>> types;
+        NodeVector<TypeNode> types;
         addParam(types, P()...);
         return std::make_unique<FuncTypeNode>(0, std::move(ret), std::move(types), Token {0,0});
     }
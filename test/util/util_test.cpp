@@ -1,7 +1,11 @@
 #include "gtest/gtest.h"
 
+#include <unordered_set>
+
 #include <misc/flag_util.hpp>
 #include <misc/num_util.hpp>
+#include <misc/hash.hpp>
+#include <misc/arena.hpp>
 
 using namespace ydsh;
 
@@ -498,6 +502,67 @@ TEST(NumTest, int32) {
     ASSERT_EQ(0, ret.first);
 }
 
+TEST(HashTest, base) {
+    // every length path (empty, 1~3, 4~16, 17~48, and larger)
+    std::string str;
+    std::unordered_set<uint64_t> values;
+    for(unsigned int i = 0; i < 200; i++) {
+        uint64_t hash = WyHash::compute(str.data(), str.size());
+        ASSERT_EQ(hash, WyHash::compute(str.c_str(), str.c_str() + str.size()));
+        ASSERT_EQ(hash, CStringHash()(str.c_str()));
+        values.insert(hash);
+        str += static_cast<char>('a' + i % 26);
+    }
+    ASSERT_EQ(200, values.size());
+
+    // seed
+    ASSERT_NE(WyHash::compute("hello", 5, 0), WyHash::compute("hello", 5, 1));
+
+    // only last byte is different
+    std::string str2 = str;
+    str2.back() = '@';
+    ASSERT_NE(WyHash::compute(str.data(), str.size()), WyHash::compute(str2.data(), str2.size()));
+}
+
+TEST(ArenaTest, base) {
+    Arena::Owner owner;
+    Arena *arena = owner.get();
+
+    std::vector<void *> ptrs;
+    for(unsigned int i = 0; i < 1000; i++) {
+        unsigned int size = i % 3 == 0 ? 100000 : i % 64 + 1;   // include larger block than chunk
+        void *ptr = Arena::allocate(arena, size);
+        memset(ptr, static_cast<int>(i), size);
+        ASSERT_EQ(0, reinterpret_cast<uintptr_t>(ptr) % alignof(std::max_align_t));
+        ptrs.push_back(ptr);
+    }
+    ASSERT_EQ(1000, arena->getLiveCount());
+    for(auto &ptr : ptrs) {
+        Arena::release(ptr);
+    }
+    ASSERT_EQ(0, arena->getLiveCount());
+
+    // reuse after reset
+    void *ptr = Arena::allocate(arena, 16);
+    ASSERT_EQ(1, arena->getLiveCount());
+    Arena::release(ptr);
+
+    // fallback to malloc
+    ptr = Arena::allocate(nullptr, 32);
+    memset(ptr, 0, 32);
+    Arena::release(ptr);
+}
+
+TEST(ArenaTest, detach) {
+    void *ptr;
+    {
+        Arena::Owner owner;
+        ptr = Arena::allocate(owner.get(), 32);
+    }
+    memset(ptr, 0, 32);   // still valid after owner destruction
+    Arena::release(ptr);    // free arena
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -367,6 +367,33 @@ TEST_F(JobTableTest, attach) {
     ASSERT_EQ(getEndIter(jobTable), begin);
 }
 
+static bool isSlice(const DSValue &value) {
+    return value.isObject() && value.get()->getKind() == DSObject::StringSlice;
+}
+
+TEST(StringSliceTest, base) {
+    auto parent = DSValue::createStr(std::string(4096, 'a'));
+    ASSERT_FALSE(isSlice(parent));
+
+    // large slice shares buffer of parent
+    auto slice = DSValue::createStrSlice(parent, 0, 1024);
+    ASSERT_TRUE(isSlice(slice));
+    ASSERT_EQ(1024u, slice.asStrRef().size());
+
+    // small slice of large parent is copied (not pin parent)
+    auto small = DSValue::createStrSlice(parent, 100, 100 + 200);
+    ASSERT_FALSE(isSlice(small));
+    ASSERT_EQ(std::string(200, 'a'), small.asStrRef().toString());
+
+    // slice of slice also checks size of original parent
+    small = DSValue::createStrSlice(slice, 0, 200);
+    ASSERT_FALSE(isSlice(small));
+
+    // shorter than MIN_SIZE
+    small = DSValue::createStrSlice(slice, 0, 63);
+    ASSERT_FALSE(isSlice(small));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
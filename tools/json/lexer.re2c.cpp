@@ -21,8 +21,6 @@
 
 #define REACH_EOS() do { if(this->isEnd()) { goto EOS; } else { ERROR(); } } while(false)
 
-#define UPDATE_LN() this->updateNewline(startPos)
-
 #define SKIP() goto INIT
 
 #define ERROR() do { RET(INVALID); } while(false)
@@ -68,7 +66,7 @@ JSONTokenKind Lexer::nextToken(Token &token) {
       ","                    { RET(COMMA); }
       ":"                    { RET(COLON); }
 
-      [ \t\r\n]+             { UPDATE_LN(); SKIP(); }
+      [ \t\r\n]+             { SKIP(); }
       "\000"                 { REACH_EOS(); }
 
       *                      { RET(INVALID); }